@@ -0,0 +1,441 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ *
+ * @file AggregatedSparseMatrix.h
+ * @author Gabriele Canesi
+ * @brief File contenente la definizione della classe AggregatedSparseMatrix, SparseMatrix che mantiene aggiornati
+ * conteggi, somme e risultati di evaluate durante le scritture
+ */
+
+#ifndef AGGREGATED_SPARSE_MATRIX_H
+#define AGGREGATED_SPARSE_MATRIX_H
+#include "SparseMatrix.h"
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief SparseMatrix con aggregati aggiornati a ogni scrittura.
+ *
+ * Mantiene il numero di elementi memorizzati per ogni riga e colonna, le somme di riga e di colonna (solo per T
+ * aritmetico) e i contatori dei predicati registrati con register_predicate. Tutte le letture degli aggregati
+ * costano O(1); set ed erase costano una ricerca in più nella tabella hash e una chiamata per ogni predicato
+ * registrato. Il costo ricade solo su chi usa questa classe: SparseMatrix resta invariata.
+ *
+ * Le somme sono aggiornate per differenza: con T in virgola mobile possono accumulare errori di arrotondamento
+ * rispetto a una somma calcolata da capo.
+ *
+ * Oltre a set ed erase mantengono gli aggregati anche erase_if, assign e reserve, inoltrati alla matrice
+ * sottostante; la visita con begin() ed end() è in sola lettura. Le altre operazioni (conversioni, prodotti,
+ * viste) si fanno sulla matrice restituita da matrix(), che non è modificabile dall'esterno.
+ *
+ * @tparam T Il tipo di dato memorizzato all'interno della matrice
+ * @tparam Alloc L'allocatore della matrice
+ * @tparam Index Il tipo degli indici memorizzati, come in SparseMatrix
+ */
+template<typename T, typename Alloc = std::allocator<T>, typename Index = long>
+class AggregatedSparseMatrix {
+public:
+
+    /**
+     * @typedef matrix_type
+     * @brief La matrice sottostante
+     */
+    typedef SparseMatrix<T, Alloc, Index> matrix_type;
+
+    /**
+     * @typedef size_type
+     * @brief Lo stesso tipo usato da SparseMatrix per indici e dimensioni
+     */
+    typedef typename matrix_type::size_type size_type;
+
+    /**
+     * @typedef element
+     * @brief Gli elementi visitati da begin() ed end()
+     */
+    typedef typename matrix_type::element element;
+
+    /**
+     * @typedef const_iterator
+     * @brief Iteratore in sola lettura sugli elementi memorizzati
+     */
+    typedef typename matrix_type::const_iterator const_iterator;
+
+    /**
+     * @typedef predicate_id
+     * @brief Identificativo di un predicato registrato
+     */
+    typedef typename std::vector<size_type>::size_type predicate_id;
+
+    /**
+     * @brief Costruttore che prende in input la dimensione della matrice e il valore di default
+     *
+     * @param n numero di righe
+     * @param m numero di colonne
+     * @param default_value valore di default
+     * @param alloc l'allocatore da usare
+     * @throws invalid_matrix_dimension_exception se le dimensioni non sono valide
+     */
+    AggregatedSparseMatrix(size_type n, size_type m, const T &default_value, const Alloc &alloc = Alloc()) :
+            m_matrix(n, m, default_value, alloc), m_row_nnz(n, 0), m_column_nnz(m, 0) {
+        init_sums(is_arithmetic());
+    }
+
+    /**
+     * @brief Costruisce gli aggregati di una matrice esistente con una sola visita dei suoi elementi
+     *
+     * La matrice viene copiata (in copy-on-write) e la rimozione dei valori di default viene disattivata nella
+     * copia.
+     * @param other la matrice di partenza
+     */
+    explicit AggregatedSparseMatrix(const matrix_type &other) : m_matrix(other),
+                                                                          m_row_nnz(other.rows(), 0),
+                                                                          m_column_nnz(other.columns(), 0) {
+        m_matrix.set_prune_defaults(false);
+        init_sums(is_arithmetic());
+        const_iterator it, end = m_matrix.end();
+        for(it = m_matrix.begin(); it != end; ++it){
+            // Non ci sono ancora predicati registrati
+            apply(it->row(), it->column(), 1, stage_sum(nullptr, &it->value(), is_arithmetic()), nullptr);
+        }
+    }
+
+    /**
+     * @brief Inserisce o sovrascrive il valore alla posizione specificata, aggiornando gli aggregati
+     *
+     * I predicati registrati vengono valutati prima di modificare la matrice: se uno di loro, o la scrittura,
+     * lancia un'eccezione, matrice e aggregati restano invariati.
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @param data il valore da inserire
+     * @throws matrix_out_of_bounds_exception se gli indici non rientrano nella matrice
+     */
+    void set(size_type i, size_type j, const T &data){
+        const T &current = m_matrix(i, j);
+        const T *old = &current == &m_matrix.default_value() ? nullptr : &current;
+        std::vector<int> deltas(m_predicates.size());
+        for(predicate_id p = 0; p < m_predicates.size(); ++p){
+            deltas[p] = (m_predicates[p](data) ? 1 : 0) - (old != nullptr && m_predicates[p](*old) ? 1 : 0);
+        }
+        const sum_type sum = stage_sum(old, &data, is_arithmetic());
+        m_matrix.set(i, j, data);
+        apply(i, j, old == nullptr ? 1 : 0, sum, deltas.empty() ? nullptr : &deltas[0]);
+    }
+
+    /**
+     * @brief Rimuove l'elemento alla posizione specificata, aggiornando gli aggregati
+     *
+     * Come set, non modifica nulla se un predicato lancia un'eccezione.
+     * @return true se l'elemento era memorizzato
+     * @throws matrix_out_of_bounds_exception se gli indici non rientrano nella matrice
+     */
+    bool erase(size_type i, size_type j){
+        const T &current = m_matrix(i, j);
+        if(&current == &m_matrix.default_value()){
+            return false;
+        }
+        std::vector<int> deltas(m_predicates.size());
+        for(predicate_id p = 0; p < m_predicates.size(); ++p){
+            deltas[p] = m_predicates[p](current) ? -1 : 0;
+        }
+        const sum_type sum = stage_sum(&current, nullptr, is_arithmetic());
+        m_matrix.erase(i, j);
+        apply(i, j, -1, sum, deltas.empty() ? nullptr : &deltas[0]);
+        return true;
+    }
+
+    /**
+     * @brief Rimuove tutti gli elementi per cui pred restituisce true, aggiornando gli aggregati
+     *
+     * Gli aggregati di ogni elemento vengono aggiornati subito prima della sua rimozione, che non lancia
+     * eccezioni: se pred o un predicato registrato lanciano un'eccezione, gli elementi già rimossi restano rimossi
+     * e gli aggregati corrispondono al contenuto della matrice. Questo vale se lo spostamento di T non lancia
+     * eccezioni: altrimenti la compattazione dei nodi può perdere elementi senza aggiornare gli aggregati.
+     * @param pred funtore (const element&) -> bool
+     * @return il numero di elementi rimossi
+     * @see SparseMatrix::erase_if
+     */
+    template<typename Pred>
+    size_type erase_if(Pred pred){
+        std::vector<int> deltas(m_predicates.size());
+        return m_matrix.erase_if([&](const element &e) -> bool {
+            if(!pred(e)){
+                return false;
+            }
+            for(predicate_id p = 0; p < m_predicates.size(); ++p){
+                deltas[p] = m_predicates[p](e.value()) ? -1 : 0;
+            }
+            apply(e.row(), e.column(), -1, stage_sum(&e.value(), nullptr, is_arithmetic()),
+                  deltas.empty() ? nullptr : &deltas[0]);
+            return true;
+        });
+    }
+
+    /**
+     * @brief Sostituisce il contenuto della matrice con un intervallo di triple e ricalcola gli aggregati
+     *
+     * Il nuovo contenuto e i suoi aggregati vengono preparati a parte e scambiati solo alla fine: se una tripla
+     * non è valida o un predicato lancia un'eccezione, matrice e aggregati restano invariati. Il costo è quello di
+     * SparseMatrix::assign più una visita del risultato per ogni predicato registrato.
+     * @see SparseMatrix::assign
+     */
+    template<typename InputIt, typename Combine>
+    void assign(InputIt first, InputIt last, Combine combine){
+        matrix_type staged(m_matrix);
+        staged.assign(first, last, combine);
+        AggregatedSparseMatrix result(staged);
+        for(predicate_id p = 0; p < m_predicates.size(); ++p){
+            result.register_predicate(m_predicates[p]);
+        }
+        swap(result);
+    }
+
+    /**
+     * @brief Sostituisce il contenuto della matrice con un intervallo di triple; a parità di posizione vince
+     * l'ultima
+     */
+    template<typename InputIt>
+    void assign(InputIt first, InputIt last){
+        assign(first, last, last_wins());
+    }
+
+    /**
+     * @brief Prepara la matrice a contenere almeno n elementi
+     * @see SparseMatrix::reserve
+     */
+    void reserve(size_type n){
+        m_matrix.reserve(n);
+    }
+
+    /**
+     * @brief Scambia contenuto, aggregati e predicati con un'altra matrice
+     */
+    void swap(AggregatedSparseMatrix &other) noexcept {
+        m_matrix.swap(other.m_matrix);
+        m_row_nnz.swap(other.m_row_nnz);
+        m_column_nnz.swap(other.m_column_nnz);
+        m_row_sum.swap(other.m_row_sum);
+        m_column_sum.swap(other.m_column_sum);
+        m_predicates.swap(other.m_predicates);
+        m_predicate_counts.swap(other.m_predicate_counts);
+        m_default_matches.swap(other.m_default_matches);
+    }
+
+    /**
+     * @brief Iteratore al primo elemento memorizzato
+     */
+    const_iterator begin() const {
+        return m_matrix.begin();
+    }
+
+    /**
+     * @brief Iteratore alla fine degli elementi memorizzati
+     */
+    const_iterator end() const {
+        return m_matrix.end();
+    }
+
+    /**
+     * @brief operatore per ottenere il valore alla posizione specificata
+     * @see SparseMatrix::operator()
+     */
+    const T& operator()(size_type i, size_type j) const {
+        return m_matrix(i, j);
+    }
+
+    /**
+     * @brief La matrice sottostante
+     */
+    const matrix_type& matrix() const {
+        return m_matrix;
+    }
+
+    /**
+     * @brief getter per il numero di righe della matrice
+     */
+    size_type rows() const {
+        return m_matrix.rows();
+    }
+
+    /**
+     * @brief getter per il numero di colonne della matrice
+     */
+    size_type columns() const {
+        return m_matrix.columns();
+    }
+
+    /**
+     * @brief getter per il numero di elementi memorizzati
+     */
+    size_type inserted_items() const {
+        return m_matrix.inserted_items();
+    }
+
+    /**
+     * @brief getter per il valore di default
+     */
+    const T& default_value() const {
+        return m_matrix.default_value();
+    }
+
+    /**
+     * @brief numero di elementi memorizzati nella riga i
+     * @throws matrix_out_of_bounds_exception se i non è una riga della matrice
+     */
+    size_type row_nnz(size_type i) const {
+        check_row(i);
+        return m_row_nnz[i];
+    }
+
+    /**
+     * @brief numero di elementi memorizzati nella colonna j
+     * @throws matrix_out_of_bounds_exception se j non è una colonna della matrice
+     */
+    size_type column_nnz(size_type j) const {
+        check_column(j);
+        return m_column_nnz[j];
+    }
+
+    /**
+     * @brief somma dei valori logici della riga i, comprese le celle che valgono il default
+     * @throws matrix_out_of_bounds_exception se i non è una riga della matrice
+     */
+    T row_sum(size_type i) const {
+        static_assert(std::is_arithmetic<T>::value, "Le somme sono mantenute solo per i tipi aritmetici");
+        check_row(i);
+        return m_row_sum[i] + default_value() * static_cast<T>(columns() - m_row_nnz[i]);
+    }
+
+    /**
+     * @brief somma dei valori logici della colonna j, comprese le celle che valgono il default
+     * @throws matrix_out_of_bounds_exception se j non è una colonna della matrice
+     */
+    T column_sum(size_type j) const {
+        static_assert(std::is_arithmetic<T>::value, "Le somme sono mantenute solo per i tipi aritmetici");
+        check_column(j);
+        return m_column_sum[j] + default_value() * static_cast<T>(rows() - m_column_nnz[j]);
+    }
+
+    /**
+     * @brief Registra un predicato, il cui conteggio verrà mantenuto da set ed erase
+     *
+     * La registrazione visita una volta gli elementi memorizzati; da quel momento evaluate(id) costa O(1). Il
+     * predicato viene copiato e deve dare sempre lo stesso risultato sullo stesso valore.
+     * @param P il predicato, funtore (const T&) -> bool
+     * @return l'identificativo da passare a evaluate
+     */
+    template<typename Pred>
+    predicate_id register_predicate(Pred P){
+        size_type count = 0;
+        const_iterator it, end = m_matrix.end();
+        for(it = m_matrix.begin(); it != end; ++it){
+            if(P(it->value())){
+                ++count;
+            }
+        }
+        const bool default_matches = P(default_value());
+        std::function<bool(const T&)> predicate(P);
+        // Dopo le reserve gli inserimenti non possono fallire, quindi i tre vettori restano della stessa lunghezza
+        m_predicates.reserve(m_predicates.size() + 1);
+        m_predicate_counts.reserve(m_predicate_counts.size() + 1);
+        m_default_matches.reserve(m_default_matches.size() + 1);
+        m_predicates.push_back(std::move(predicate));
+        m_predicate_counts.push_back(count);
+        m_default_matches.push_back(default_matches);
+        return m_predicates.size() - 1;
+    }
+
+    /**
+     * @brief Numero di elementi logici che soddisfano il predicato registrato, come evaluate(matrix(), P)
+     * @param id l'identificativo restituito da register_predicate
+     */
+    size_type evaluate(predicate_id id) const {
+        size_type result = m_predicate_counts[id];
+        if(m_default_matches[id]){
+            result += rows() * columns() - inserted_items();
+        }
+        return result;
+    }
+
+    /**
+     * @brief numero di predicati registrati
+     */
+    predicate_id predicate_count() const {
+        return m_predicates.size();
+    }
+
+private:
+    typedef typename std::is_arithmetic<T>::type is_arithmetic;
+
+    /**
+     * @brief Tipo della variazione di una somma: T per i tipi aritmetici, un segnaposto altrimenti
+     */
+    typedef typename std::conditional<std::is_arithmetic<T>::value, T, char>::type sum_type;
+
+    matrix_type m_matrix; ///< La matrice sottostante
+    std::vector<size_type> m_row_nnz; ///< Elementi memorizzati per riga
+    std::vector<size_type> m_column_nnz; ///< Elementi memorizzati per colonna
+    std::vector<T> m_row_sum; ///< Somma dei valori memorizzati per riga; vuoto se T non è aritmetico
+    std::vector<T> m_column_sum; ///< Somma dei valori memorizzati per colonna; vuoto se T non è aritmetico
+    std::vector<std::function<bool(const T&)> > m_predicates; ///< I predicati registrati
+    std::vector<size_type> m_predicate_counts; ///< Elementi memorizzati che soddisfano ciascun predicato
+    std::vector<bool> m_default_matches; ///< true se il valore di default soddisfa il predicato
+
+    void init_sums(std::true_type){
+        m_row_sum.assign(m_row_nnz.size(), T());
+        m_column_sum.assign(m_column_nnz.size(), T());
+    }
+
+    void init_sums(std::false_type){}
+
+    /**
+     * @brief variazione delle somme quando il valore memorizzato passa da old a data
+     * @param old il valore precedente, nullptr se la posizione non era memorizzata
+     * @param data il nuovo valore, nullptr se la posizione viene rimossa
+     */
+    static sum_type stage_sum(const T *old, const T *data, std::true_type){
+        return (data == nullptr ? T() : *data) - (old == nullptr ? T() : *old);
+    }
+
+    static sum_type stage_sum(const T *, const T *, std::false_type){
+        return sum_type();
+    }
+
+    /**
+     * @brief applica agli aggregati le variazioni preparate prima di modificare la matrice. Non lancia eccezioni.
+     * @param nnz variazione del numero di elementi memorizzati in (i, j): 1, 0 oppure -1
+     * @param sum variazione delle somme
+     * @param deltas variazione di ogni contatore dei predicati, o nullptr se non ci sono predicati
+     */
+    void apply(size_type i, size_type j, int nnz, sum_type sum, const int *deltas) noexcept {
+        m_row_nnz[i] += nnz;
+        m_column_nnz[j] += nnz;
+        apply_sum(i, j, sum, is_arithmetic());
+        for(predicate_id p = 0; deltas != nullptr && p < m_predicate_counts.size(); ++p){
+            m_predicate_counts[p] += deltas[p];
+        }
+    }
+
+    void apply_sum(size_type i, size_type j, sum_type sum, std::true_type) noexcept {
+        m_row_sum[i] += sum;
+        m_column_sum[j] += sum;
+    }
+
+    void apply_sum(size_type, size_type, sum_type, std::false_type) noexcept {}
+
+    void check_row(size_type i) const {
+        if(i < 0 || i >= rows()){
+            throw matrix_out_of_bounds_exception("Gli indici specificati non rientrano nei limiti di dimensione della matrice.");
+        }
+    }
+
+    void check_column(size_type j) const {
+        if(j < 0 || j >= columns()){
+            throw matrix_out_of_bounds_exception("Gli indici specificati non rientrano nei limiti di dimensione della matrice.");
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,234 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ *
+ * @file BSRMatrix.h
+ * @author Gabriele Canesi
+ * @brief File contenente la definizione della classe BSRMatrix, rappresentazione compressa a blocchi densi di una
+ * SparseMatrix
+ */
+
+#ifndef BSR_MATRIX_H
+#define BSR_MATRIX_H
+#include "SparseMatrix.h"
+#include <algorithm>
+#include <vector>
+
+/**
+ * @brief Matrice sparsa immutabile in formato BSR (block compressed sparse row).
+ *
+ * La matrice è divisa in blocchi B x B; vengono memorizzati solo i blocchi che contengono almeno un elemento, ognuno
+ * come B * B valori contigui per righe. Per ogni riga di blocchi bi, i blocchi si trovano nelle posizioni
+ * [row_ptr[bi], row_ptr[bi + 1]) di col_idx, ordinati per colonna di blocco crescente. È adatta alle matrici in cui
+ * gli elementi arrivano a blocchi densi (per esempio dalle mesh agli elementi finiti): serve un solo indice per
+ * blocco invece di uno per elemento, e il prodotto per un vettore lavora su blocchi di dimensione nota a tempo di
+ * compilazione.
+ *
+ * Le posizioni di un blocco memorizzato che non erano presenti nella matrice di partenza contengono il valore di
+ * default, così come le posizioni dei blocchi di bordo che escono dalla matrice quando le dimensioni non sono
+ * multiple di B.
+ *
+ * @tparam T Il tipo di dato memorizzato all'interno della matrice
+ * @tparam B Il lato dei blocchi
+ */
+template<typename T, int B>
+class BSRMatrix {
+    static_assert(B > 0, "Il lato dei blocchi deve essere positivo");
+
+public:
+
+    /**
+     * @typedef size_type
+     * @brief Lo stesso tipo usato da SparseMatrix per indici e dimensioni
+     */
+    typedef typename SparseMatrix<T>::size_type size_type;
+
+    /**
+     * @brief Costruttore di default. Istanzia una matrice vuota.
+     */
+    BSRMatrix() : m_rows(0), m_columns(0), m_block_rows(0), m_block_columns(0), m_nnz(0), m_row_ptr(1, 0),
+                  m_default() {}
+
+    /**
+     * @brief Costruisce la rappresentazione a blocchi di una SparseMatrix.
+     *
+     * Gli elementi vengono ordinati con due counting sort stabili, prima per colonna di blocco e poi per riga di
+     * blocco, per un costo di O(nnz + righe di blocchi + colonne di blocchi) più la scrittura dei blocchi.
+     * @param other la matrice da comprimere
+     */
+    template<typename Alloc, typename Index>
+    explicit BSRMatrix(const SparseMatrix<T, Alloc, Index> &other) : m_rows(other.rows()),
+                                                                     m_columns(other.columns()),
+                                                                     m_block_rows((other.rows() + B - 1) / B),
+                                                                     m_block_columns((other.columns() + B - 1) / B),
+                                                                     m_nnz(other.inserted_items()),
+                                                                     m_row_ptr(m_block_rows + 1, 0),
+                                                                     m_default(other.default_value()) {
+        typedef typename SparseMatrix<T, Alloc, Index>::element element;
+        typename SparseMatrix<T, Alloc, Index>::const_iterator it, end = other.end();
+
+        // Primo passaggio: distribuzione per colonna di blocco
+        std::vector<size_type> column_ptr(m_block_columns + 1, 0);
+        std::vector<size_type> row_count(m_block_rows + 1, 0);
+        for(it = other.begin(); it != end; ++it){
+            ++column_ptr[it->column() / B + 1];
+            ++row_count[it->row() / B + 1];
+        }
+        for(size_type bj = 0; bj < m_block_columns; ++bj){
+            column_ptr[bj + 1] += column_ptr[bj];
+        }
+        for(size_type bi = 0; bi < m_block_rows; ++bi){
+            row_count[bi + 1] += row_count[bi];
+        }
+
+        std::vector<const element*> by_column(m_nnz);
+        for(it = other.begin(); it != end; ++it){
+            by_column[column_ptr[it->column() / B]++] = &(*it);
+        }
+
+        // Secondo passaggio, stabile: distribuzione per riga di blocco mantenendo l'ordine delle colonne
+        std::vector<const element*> sorted(m_nnz);
+        for(typename std::vector<const element*>::size_type k = 0; k < by_column.size(); ++k){
+            sorted[row_count[by_column[k]->row() / B]++] = by_column[k];
+        }
+        std::vector<const element*>().swap(by_column);
+
+        // Gli elementi dello stesso blocco ora sono consecutivi
+        size_type k = 0;
+        for(size_type bi = 0; bi < m_block_rows; ++bi){
+            // Dopo la distribuzione row_count[bi] indica la fine della riga di blocchi bi
+            const size_type row_end = row_count[bi];
+            while(k < row_end){
+                const size_type bj = sorted[k]->column() / B;
+                m_col_idx.push_back(bj);
+                m_values.resize(m_values.size() + B * B, m_default);
+                T *block = &m_values[m_values.size() - B * B];
+                for(; k < row_end && sorted[k]->column() / B == bj; ++k){
+                    block[(sorted[k]->row() % B) * B + sorted[k]->column() % B] = sorted[k]->value();
+                }
+            }
+            m_row_ptr[bi + 1] = static_cast<size_type>(m_col_idx.size());
+        }
+    }
+
+    /**
+     * @brief operatore per ottenere il valore alla posizione specificata
+     *
+     * La ricerca è binaria sulle colonne di blocco della riga di blocchi che contiene i.
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @return il reference costante al valore se appartiene a un blocco memorizzato, il valore di default altrimenti
+     */
+    const T& operator()(size_type i, size_type j) const {
+        if (i >= m_rows || j >= m_columns || i < 0 || j < 0){
+            throw matrix_out_of_bounds_exception("Gli indici specificati non rientrano nei limiti di dimensione della matrice.");
+        }
+
+        typename std::vector<size_type>::const_iterator first = m_col_idx.begin() + m_row_ptr[i / B];
+        typename std::vector<size_type>::const_iterator last = m_col_idx.begin() + m_row_ptr[i / B + 1];
+        typename std::vector<size_type>::const_iterator found = std::lower_bound(first, last, j / B);
+        if(found == last || *found != j / B){
+            return m_default;
+        }
+        return m_values[(found - m_col_idx.begin()) * B * B + (i % B) * B + j % B];
+    }
+
+    /**
+     * @brief getter per il numero di elementi memorizzati nella matrice di partenza
+     * @return numero di elementi memorizzati
+     */
+    size_type inserted_items() const {
+        return m_nnz;
+    }
+
+    /**
+     * @brief getter per il numero di blocchi memorizzati
+     * @return numero di blocchi memorizzati
+     */
+    size_type stored_blocks() const {
+        return static_cast<size_type>(m_col_idx.size());
+    }
+
+    /**
+     * @brief getter per il lato dei blocchi
+     * @return B
+     */
+    static int block_size() {
+        return B;
+    }
+
+    /**
+     * @brief getter per il numero di righe della matrice
+     * @return numero di righe della matrice
+     */
+    size_type rows() const {
+        return m_rows;
+    }
+
+    /**
+     * @brief getter per il numero di colonne della matrice
+     * @return numero di colonne della matrice
+     */
+    size_type columns() const {
+        return m_columns;
+    }
+
+    /**
+     * @brief getter per il numero di righe di blocchi, cioè rows() / B arrotondato per eccesso
+     */
+    size_type block_rows() const {
+        return m_block_rows;
+    }
+
+    /**
+     * @brief getter per il numero di colonne di blocchi, cioè columns() / B arrotondato per eccesso
+     */
+    size_type block_columns() const {
+        return m_block_columns;
+    }
+
+    /**
+     * @brief getter per il valore di default
+     * @return const reference al valore di default
+     */
+    const T& default_value() const {
+        return m_default;
+    }
+
+    /**
+     * @brief Array degli offset delle righe di blocchi, di dimensione block_rows() + 1
+     */
+    const size_type* row_pointers() const {
+        return &m_row_ptr[0];
+    }
+
+    /**
+     * @brief Array delle colonne di blocco dei blocchi memorizzati, di dimensione stored_blocks()
+     */
+    const size_type* column_indices() const {
+        return m_col_idx.empty() ? nullptr : &m_col_idx[0];
+    }
+
+    /**
+     * @brief Array dei valori dei blocchi, B * B per blocco in ordine di riga, di dimensione stored_blocks() * B * B
+     */
+    const T* values() const {
+        return m_values.empty() ? nullptr : &m_values[0];
+    }
+
+private:
+    size_type m_rows; ///< Numero di righe della matrice
+    size_type m_columns; ///< Numero di colonne della matrice
+    size_type m_block_rows; ///< Numero di righe di blocchi
+    size_type m_block_columns; ///< Numero di colonne di blocchi
+    size_type m_nnz; ///< Numero di elementi della matrice di partenza
+
+    std::vector<size_type> m_row_ptr; ///< Offset di inizio di ogni riga di blocchi, più la sentinella finale
+    std::vector<size_type> m_col_idx; ///< Colonna di blocco di ogni blocco
+    std::vector<T> m_values; ///< Valori dei blocchi, contigui
+
+    T m_default; ///< Valore di default
+};
+
+#endif
@@ -0,0 +1,399 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ *
+ * @file CSCMatrix.h
+ * @author Gabriele Canesi
+ * @brief File contenente la definizione della classe CSCMatrix, rappresentazione compressa per colonne di una
+ * SparseMatrix
+ */
+
+#ifndef CSC_MATRIX_H
+#define CSC_MATRIX_H
+#include "SparseMatrix.h"
+#include <vector>
+
+/**
+ * @brief Matrice sparsa immutabile in formato CSC (compressed sparse column).
+ *
+ * È la trasposta, in termini di layout, di CSRMatrix: per ogni colonna j gli elementi si trovano nelle posizioni
+ * [col_ptr[j], col_ptr[j + 1]) di row_idx e values, ordinati per riga crescente. Visitare una colonna costa quindi
+ * quanto il numero di elementi della colonna.
+ *
+ * @tparam T Il tipo di dato memorizzato all'interno della matrice
+ */
+template<typename T>
+class CSCMatrix {
+public:
+
+    /**
+     * @typedef size_type
+     * @brief Lo stesso tipo usato da SparseMatrix per indici e dimensioni
+     */
+    typedef typename SparseMatrix<T>::size_type size_type;
+
+    /**
+     * @brief Vista su un elemento memorizzato nella matrice, con la stessa interfaccia di SparseMatrix::element
+     */
+    class entry {
+        friend class CSCMatrix;
+
+        size_type m_i; ///< Riga dell'elemento
+        size_type m_j; ///< Colonna dell'elemento
+        const T *m_value; ///< Puntatore al valore all'interno dell'array values
+
+    public:
+        /**
+         * @brief Costruttore di default
+         */
+        entry() : m_i(0), m_j(0), m_value(nullptr) {}
+
+        /**
+         * @brief getter per la riga dell'elemento
+         * @return valore della riga
+         */
+        size_type row() const {
+            return m_i;
+        }
+
+        /**
+         * @brief getter per la colonna dell'elemento
+         * @return valore della colonna
+         */
+        size_type column() const {
+            return m_j;
+        }
+
+        /**
+         * @brief getter per il valore effettivo
+         * @return const reference al valore
+         */
+        const T& value() const {
+            return *m_value;
+        }
+    };
+
+    /**
+     * @brief Costruttore di default. Istanzia una matrice vuota.
+     */
+    CSCMatrix() : m_rows(0), m_columns(0), m_col_ptr(1, 0), m_default() {}
+
+    /**
+     * @brief Costruisce la rappresentazione per colonne di una SparseMatrix.
+     *
+     * Gli elementi vengono ordinati con due counting sort stabili, prima per riga e poi per colonna, per un costo
+     * complessivo di O(nnz + rows + columns).
+     * @param other la matrice da comprimere
+     */
+    template<typename Alloc, typename Index>
+    explicit CSCMatrix(const SparseMatrix<T, Alloc, Index> &other) : m_rows(other.rows()),
+                                                                     m_columns(other.columns()),
+                                                                     m_col_ptr(other.columns() + 1, 0),
+                                                                     m_default(other.default_value()) {
+        typedef typename SparseMatrix<T, Alloc, Index>::element element;
+        typename SparseMatrix<T, Alloc, Index>::const_iterator it, end = other.end();
+
+        // Primo passaggio: distribuzione per riga
+        std::vector<size_type> row_ptr(m_rows + 1, 0);
+        for(it = other.begin(); it != end; ++it){
+            ++row_ptr[it->row() + 1];
+            ++m_col_ptr[it->column() + 1];
+        }
+        for(size_type i = 0; i < m_rows; ++i){
+            row_ptr[i + 1] += row_ptr[i];
+        }
+        for(size_type j = 0; j < m_columns; ++j){
+            m_col_ptr[j + 1] += m_col_ptr[j];
+        }
+
+        std::vector<const element*> by_row(other.inserted_items());
+        for(it = other.begin(); it != end; ++it){
+            by_row[row_ptr[it->row()]++] = &(*it);
+        }
+
+        // Secondo passaggio, stabile: distribuzione per colonna mantenendo l'ordine di riga
+        std::vector<size_type> next(m_col_ptr.begin(), m_col_ptr.end() - 1);
+        m_row_idx.resize(by_row.size());
+        std::vector<const element*> by_column(by_row.size());
+        for(typename std::vector<const element*>::size_type k = 0; k < by_row.size(); ++k){
+            size_type position = next[by_row[k]->column()]++;
+            by_column[position] = by_row[k];
+            m_row_idx[position] = by_row[k]->row();
+        }
+
+        m_values.reserve(by_column.size());
+        for(typename std::vector<const element*>::size_type k = 0; k < by_column.size(); ++k){
+            m_values.push_back(by_column[k]->value());
+        }
+    }
+
+    /**
+     * @brief operatore per ottenere il valore alla posizione specificata
+     *
+     * La ricerca è binaria sulle righe della colonna j.
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @return il reference costante al valore se memorizzato, il valore di default altrimenti
+     */
+    const T& operator()(size_type i, size_type j) const {
+        if (i >= m_rows || j >= m_columns || i < 0 || j < 0){
+            throw matrix_out_of_bounds_exception("Gli indici specificati non rientrano nei limiti di dimensione della matrice.");
+        }
+
+        typename std::vector<size_type>::const_iterator first = m_row_idx.begin() + m_col_ptr[j];
+        typename std::vector<size_type>::const_iterator last = m_row_idx.begin() + m_col_ptr[j + 1];
+        typename std::vector<size_type>::const_iterator found = std::lower_bound(first, last, i);
+        if(found == last || *found != i){
+            return m_default;
+        }
+        return m_values[found - m_row_idx.begin()];
+    }
+
+    /**
+     * @brief getter per il numero di elementi memorizzati
+     * @return numero di elementi memorizzati
+     */
+    size_type inserted_items() const {
+        return static_cast<size_type>(m_values.size());
+    }
+
+    /**
+     * @brief getter per il numero di righe della matrice
+     * @return numero di righe della matrice
+     */
+    size_type rows() const {
+        return m_rows;
+    }
+
+    /**
+     * @brief getter per il numero di colonne della matrice
+     * @return numero di colonne della matrice
+     */
+    size_type columns() const {
+        return m_columns;
+    }
+
+    /**
+     * @brief getter per il valore di default
+     * @return const reference al valore di default
+     */
+    const T& default_value() const {
+        return m_default;
+    }
+
+    /**
+     * @brief Array degli offset di colonna, di dimensione columns() + 1
+     */
+    const size_type* column_pointers() const {
+        return &m_col_ptr[0];
+    }
+
+    /**
+     * @brief Array delle righe degli elementi, di dimensione inserted_items()
+     */
+    const size_type* row_indices() const {
+        return m_row_idx.empty() ? nullptr : &m_row_idx[0];
+    }
+
+    /**
+     * @brief Array dei valori degli elementi, di dimensione inserted_items()
+     */
+    const T* values() const {
+        return m_values.empty() ? nullptr : &m_values[0];
+    }
+
+    /**
+     * @brief Forward const_iterator per CSCMatrix.
+     *
+     * Visita gli elementi in ordine di colonna e, all'interno della stessa colonna, di riga.
+     */
+    class const_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef entry                           value_type;
+        typedef ptrdiff_t                 difference_type;
+        typedef const entry*                    pointer;
+        typedef const entry&                    reference;
+
+        /**
+         * @brief costruttore di default
+         */
+        const_iterator() : m_matrix(nullptr), m_pos(0) {}
+
+        /**
+         * @brief operatore di dereferenziamento
+         * @return reference all'elemento puntato dall'iteratore
+         */
+        reference operator*() const {
+            return m_current;
+        }
+
+        /**
+         * @return puntatore all'elemento puntato dall'iteratore
+         */
+        pointer operator->() const {
+            return &m_current;
+        }
+
+        /**
+         * @brief operatore di post incremento
+         * @return l'iteratore allo stato antecedente la modifica
+         */
+        const_iterator operator++(int) {
+            const_iterator temp = *this;
+            ++*this;
+            return temp;
+        }
+
+        /**
+         * @brief operatore di preincremento
+         * @return l'iteratore al nuovo elemento
+         */
+        const_iterator& operator++() {
+            ++m_pos;
+            sync();
+            return *this;
+        }
+
+        /**
+         * @param other l'iteratore da confrontare
+         * @return true se this e other puntano allo stesso elemento
+         */
+        bool operator==(const const_iterator &other) const {
+            return m_matrix == other.m_matrix && m_pos == other.m_pos;
+        }
+
+        /**
+         * @param other l'iteratore da confrontare
+         * @return false se this e other puntano allo stesso elemento
+         */
+        bool operator!=(const const_iterator &other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const CSCMatrix *m_matrix; ///< Matrice visitata
+        size_type m_pos; ///< Posizione corrente negli array row_idx e values
+        entry m_current; ///< Vista sull'elemento corrente
+
+        friend class CSCMatrix;
+
+        const_iterator(const CSCMatrix *matrix, size_type column, size_type pos) : m_matrix(matrix), m_pos(pos) {
+            m_current.m_j = column;
+            sync();
+        }
+
+        /**
+         * @brief aggiorna la vista sull'elemento corrente, saltando le colonne vuote
+         */
+        void sync() {
+            if(m_pos < m_matrix->inserted_items()){
+                while(m_matrix->m_col_ptr[m_current.m_j + 1] <= m_pos){
+                    ++m_current.m_j;
+                }
+                m_current.m_i = m_matrix->m_row_idx[m_pos];
+                m_current.m_value = &m_matrix->m_values[m_pos];
+            }
+        }
+    };
+
+    /**
+     * @brief Intervallo degli elementi di una singola colonna, utilizzabile nei cicli for
+     */
+    class column_range {
+    public:
+        /**
+         * @return l'iteratore al primo elemento della colonna
+         */
+        const_iterator begin() const {
+            return m_begin;
+        }
+
+        /**
+         * @return l'iteratore che segue l'ultimo elemento della colonna
+         */
+        const_iterator end() const {
+            return m_end;
+        }
+
+        /**
+         * @return il numero di elementi memorizzati nella colonna
+         */
+        size_type size() const {
+            return m_end.m_pos - m_begin.m_pos;
+        }
+
+    private:
+        friend class CSCMatrix;
+
+        const_iterator m_begin;
+        const_iterator m_end;
+
+        column_range(const const_iterator &begin, const const_iterator &end) : m_begin(begin), m_end(end) {}
+    };
+
+    /**
+     * @return l'iteratore costante che punta al primo elemento della matrice
+     */
+    const_iterator begin() const {
+        return const_iterator(this, 0, 0);
+    }
+
+    /**
+     * @return l'iteratore che rappresenta l'elemento dopo la fine della matrice
+     */
+    const_iterator end() const {
+        return const_iterator(this, 0, inserted_items());
+    }
+
+    /**
+     * @brief Vista sugli elementi della colonna j, in ordine di riga crescente
+     * @param j indice della colonna
+     * @return l'intervallo degli elementi della colonna
+     */
+    column_range column(size_type j) const {
+        if(j < 0 || j >= m_columns){
+            throw matrix_out_of_bounds_exception("La colonna richiesta non appartiene alla matrice");
+        }
+        return column_range(const_iterator(this, j, m_col_ptr[j]), const_iterator(this, j, m_col_ptr[j + 1]));
+    }
+
+private:
+    size_type m_rows; ///< Numero di righe della matrice
+    size_type m_columns; ///< Numero di colonne della matrice
+
+    std::vector<size_type> m_col_ptr; ///< Offset di inizio di ogni colonna, più la sentinella finale
+    std::vector<size_type> m_row_idx; ///< Riga di ogni elemento
+    std::vector<T> m_values; ///< Valore di ogni elemento
+
+    T m_default; ///< Valore di default
+};
+
+
+/**
+ * @brief Versione di evaluate per CSCMatrix.
+ *
+ * @tparam T il tipo di dato della matrice
+ * @tparam Pred il tipo del funtore
+ * @param M la matrice da visitare
+ * @param P il predicato da testare
+ * @return il numero di elementi logici della matrice che soddisfano P
+ */
+template<typename T, typename Pred>
+typename CSCMatrix<T>::size_type evaluate(const CSCMatrix<T> &M, Pred P){
+    typename CSCMatrix<T>::size_type result = 0;
+    const T *values = M.values();
+    for(typename CSCMatrix<T>::size_type k = 0; k < M.inserted_items(); ++k){
+        if(P(values[k])){
+            ++result;
+        }
+    }
+    if(P(M.default_value())){
+        result += (M.rows() * M.columns() - M.inserted_items());
+    }
+
+    return result;
+}
+
+#endif
@@ -0,0 +1,464 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ *
+ * @file CSRMatrix.h
+ * @author Gabriele Canesi
+ * @brief File contenente la definizione della classe CSRMatrix, rappresentazione compressa per righe di una
+ * SparseMatrix
+ */
+
+#ifndef CSR_MATRIX_H
+#define CSR_MATRIX_H
+#include "SparseMatrix.h"
+#include <string>
+#include <vector>
+
+template<typename T>
+class MappedCSRMatrix;
+
+template<typename T, typename Alloc, typename Index>
+class TransposedView;
+
+/**
+ * @brief Matrice sparsa immutabile in formato CSR (compressed sparse row).
+ *
+ * Gli elementi sono memorizzati in tre array contigui: per ogni riga i, gli elementi si trovano nelle posizioni
+ * [row_ptr[i], row_ptr[i + 1]) di col_idx e values, ordinati per colonna crescente. Rispetto alla lista di nodi
+ * di SparseMatrix la lettura è molto più cache friendly, ma la matrice non può più essere modificata.
+ * Si ottiene tramite SparseMatrix::freeze().
+ *
+ * @tparam T Il tipo di dato memorizzato all'interno della matrice
+ */
+template<typename T>
+class CSRMatrix {
+public:
+
+    /**
+     * @typedef size_type
+     * @brief Lo stesso tipo usato da SparseMatrix per indici e dimensioni
+     */
+    typedef typename SparseMatrix<T>::size_type size_type;
+
+    /**
+     * @brief Vista su un elemento memorizzato nella matrice.
+     *
+     * Offre la stessa interfaccia di SparseMatrix::element (row(), column(), value()) senza copiare il valore.
+     */
+    class entry {
+        friend class CSRMatrix;
+
+        size_type m_i; ///< Riga dell'elemento
+        size_type m_j; ///< Colonna dell'elemento
+        const T *m_value; ///< Puntatore al valore all'interno dell'array values
+
+    public:
+        /**
+         * @brief Costruttore di default
+         */
+        entry() : m_i(0), m_j(0), m_value(nullptr) {}
+
+        /**
+         * @brief getter per la riga dell'elemento
+         * @return valore della riga
+         */
+        size_type row() const {
+            return m_i;
+        }
+
+        /**
+         * @brief getter per la colonna dell'elemento
+         * @return valore della colonna
+         */
+        size_type column() const {
+            return m_j;
+        }
+
+        /**
+         * @brief getter per il valore effettivo
+         * @return const reference al valore
+         */
+        const T& value() const {
+            return *m_value;
+        }
+    };
+
+    /**
+     * @brief Costruttore di default. Istanzia una matrice vuota.
+     */
+    CSRMatrix() : m_rows(0), m_columns(0), m_row_ptr(1, 0), m_default() {}
+
+    /**
+     * @brief Costruisce la rappresentazione compressa di una SparseMatrix.
+     *
+     * Gli elementi vengono distribuiti per riga con un counting sort e poi ordinati per colonna all'interno di ogni
+     * riga, quindi il costo è O(rows + nnz log nnz) nel caso peggiore.
+     * @param other la matrice da comprimere
+     */
+    template<typename Alloc, typename Index>
+    explicit CSRMatrix(const SparseMatrix<T, Alloc, Index> &other) : m_rows(other.rows()),
+                                                                     m_columns(other.columns()),
+                                                                     m_row_ptr(other.rows() + 1, 0),
+                                                                     m_default(other.default_value()) {
+        compress(other, false);
+    }
+
+    /**
+     * @brief Costruisce la rappresentazione compressa della trasposta di una SparseMatrix, cioè il layout CSC della
+     * matrice originale, senza costruire la trasposta come SparseMatrix.
+     *
+     * Il costo è lo stesso del costruttore da SparseMatrix.
+     * @param other la vista trasposta da comprimere
+     */
+    template<typename Alloc, typename Index>
+    explicit CSRMatrix(const TransposedView<T, Alloc, Index> &other) : m_rows(other.rows()),
+                                                                       m_columns(other.columns()),
+                                                                       m_row_ptr(other.rows() + 1, 0),
+                                                                       m_default(other.default_value()) {
+        compress(other.source(), true);
+    }
+
+    /**
+     * @brief operatore per ottenere il valore alla posizione specificata
+     *
+     * La ricerca è binaria sulle colonne della riga i.
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @return il reference costante al valore se memorizzato, il valore di default altrimenti
+     */
+    const T& operator()(size_type i, size_type j) const {
+        if (i >= m_rows || j >= m_columns || i < 0 || j < 0){
+            throw matrix_out_of_bounds_exception("Gli indici specificati non rientrano nei limiti di dimensione della matrice.");
+        }
+
+        typename std::vector<size_type>::const_iterator first = m_col_idx.begin() + m_row_ptr[i];
+        typename std::vector<size_type>::const_iterator last = m_col_idx.begin() + m_row_ptr[i + 1];
+        typename std::vector<size_type>::const_iterator found = std::lower_bound(first, last, j);
+        if(found == last || *found != j){
+            return m_default;
+        }
+        return m_values[found - m_col_idx.begin()];
+    }
+
+    /**
+     * @brief getter per il numero di elementi memorizzati
+     * @return numero di elementi memorizzati
+     */
+    size_type inserted_items() const {
+        return static_cast<size_type>(m_values.size());
+    }
+
+    /**
+     * @brief getter per il numero di righe della matrice
+     * @return numero di righe della matrice
+     */
+    size_type rows() const {
+        return m_rows;
+    }
+
+    /**
+     * @brief getter per il numero di colonne della matrice
+     * @return numero di colonne della matrice
+     */
+    size_type columns() const {
+        return m_columns;
+    }
+
+    /**
+     * @brief getter per il valore di default
+     * @return const reference al valore di default
+     */
+    const T& default_value() const {
+        return m_default;
+    }
+
+    /**
+     * @brief Array degli offset di riga, di dimensione rows() + 1
+     */
+    const size_type* row_pointers() const {
+        return &m_row_ptr[0];
+    }
+
+    /**
+     * @brief Array delle colonne degli elementi, di dimensione inserted_items()
+     */
+    const size_type* column_indices() const {
+        return m_col_idx.empty() ? nullptr : &m_col_idx[0];
+    }
+
+    /**
+     * @brief Array dei valori degli elementi, di dimensione inserted_items()
+     */
+    const T* values() const {
+        return m_values.empty() ? nullptr : &m_values[0];
+    }
+
+    /**
+     * @brief Salva la matrice nel formato binario descritto in mapped_file.h, riapribile con open_mapped
+     *
+     * Disponibile solo per i tipi T banalmente copiabili.
+     * @param path il percorso del file da scrivere
+     * @throws matrix_file_exception se il file non può essere scritto
+     */
+    void save(const std::string &path) const;
+
+    /**
+     * @brief Forward const_iterator per CSRMatrix.
+     *
+     * Visita gli elementi in ordine di riga e, all'interno della stessa riga, di colonna. Lavora direttamente sugli
+     * array della rappresentazione, quindi è usato anche da MappedCSRMatrix.
+     */
+    class const_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef entry                           value_type;
+        typedef ptrdiff_t                 difference_type;
+        typedef const entry*                    pointer;
+        typedef const entry&                    reference;
+
+        /**
+         * @brief costruttore di default
+         */
+        const_iterator() : m_row_ptr(nullptr), m_col_idx(nullptr), m_values(nullptr), m_nnz(0), m_pos(0) {}
+
+        /**
+         * @brief operatore di dereferenziamento
+         * @return reference all'elemento puntato dall'iteratore
+         */
+        reference operator*() const {
+            return m_current;
+        }
+
+        /**
+         * @return puntatore all'elemento puntato dall'iteratore
+         */
+        pointer operator->() const {
+            return &m_current;
+        }
+
+        /**
+         * @brief operatore di post incremento
+         * @return l'iteratore allo stato antecedente la modifica
+         */
+        const_iterator operator++(int) {
+            const_iterator temp = *this;
+            ++*this;
+            return temp;
+        }
+
+        /**
+         * @brief operatore di preincremento
+         * @return l'iteratore al nuovo elemento
+         */
+        const_iterator& operator++() {
+            ++m_pos;
+            sync();
+            return *this;
+        }
+
+        /**
+         * @param other l'iteratore da confrontare
+         * @return true se this e other puntano allo stesso elemento
+         */
+        bool operator==(const const_iterator &other) const {
+            return m_row_ptr == other.m_row_ptr && m_pos == other.m_pos;
+        }
+
+        /**
+         * @param other l'iteratore da confrontare
+         * @return false se this e other puntano allo stesso elemento
+         */
+        bool operator!=(const const_iterator &other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const size_type *m_row_ptr; ///< Offset di riga della matrice visitata
+        const size_type *m_col_idx; ///< Colonne degli elementi
+        const T *m_values; ///< Valori degli elementi
+        size_type m_nnz; ///< Numero di elementi memorizzati
+        size_type m_pos; ///< Posizione corrente negli array col_idx e values
+        entry m_current; ///< Vista sull'elemento corrente
+
+        friend class CSRMatrix;
+        friend class MappedCSRMatrix<T>;
+
+        const_iterator(const size_type *row_ptr, const size_type *col_idx, const T *values, size_type nnz,
+                       size_type row, size_type pos) : m_row_ptr(row_ptr), m_col_idx(col_idx), m_values(values),
+                                                       m_nnz(nnz), m_pos(pos) {
+            m_current.m_i = row;
+            sync();
+        }
+
+        /**
+         * @brief aggiorna la vista sull'elemento corrente, saltando le righe vuote
+         */
+        void sync() {
+            if(m_pos < m_nnz){
+                while(m_row_ptr[m_current.m_i + 1] <= m_pos){
+                    ++m_current.m_i;
+                }
+                m_current.m_j = m_col_idx[m_pos];
+                m_current.m_value = &m_values[m_pos];
+            }
+        }
+    };
+
+    /**
+     * @return l'iteratore costante che punta al primo elemento della matrice
+     */
+    const_iterator begin() const {
+        return make_iterator(0, 0);
+    }
+
+    /**
+     * @return l'iteratore che rappresenta l'elemento dopo la fine della matrice
+     */
+    const_iterator end() const {
+        return make_iterator(0, inserted_items());
+    }
+
+    /**
+     * @param i indice della riga
+     * @return l'iteratore al primo elemento della riga i
+     */
+    const_iterator row_begin(size_type i) const {
+        if(i < 0 || i >= m_rows){
+            throw matrix_out_of_bounds_exception("La riga richiesta non appartiene alla matrice");
+        }
+        return make_iterator(i, m_row_ptr[i]);
+    }
+
+    /**
+     * @param i indice della riga
+     * @return l'iteratore che segue l'ultimo elemento della riga i
+     */
+    const_iterator row_end(size_type i) const {
+        if(i < 0 || i >= m_rows){
+            throw matrix_out_of_bounds_exception("La riga richiesta non appartiene alla matrice");
+        }
+        return make_iterator(i, m_row_ptr[i + 1]);
+    }
+
+private:
+    size_type m_rows; ///< Numero di righe della matrice
+    size_type m_columns; ///< Numero di colonne della matrice
+
+    std::vector<size_type> m_row_ptr; ///< Offset di inizio di ogni riga, più la sentinella finale
+    std::vector<size_type> m_col_idx; ///< Colonna di ogni elemento
+    std::vector<T> m_values; ///< Valore di ogni elemento
+
+    T m_default; ///< Valore di default
+
+    /**
+     * @brief iteratore sulla posizione pos, con la ricerca della riga che parte da row
+     */
+    const_iterator make_iterator(size_type row, size_type pos) const {
+        return const_iterator(row_pointers(), column_indices(), values(), inserted_items(), row, pos);
+    }
+
+    /**
+     * @brief riga di e nella matrice compressa: quella di e, o la sua colonna se la matrice è trasposta
+     */
+    template<typename Element>
+    static size_type major_index(const Element &e, bool transposed){
+        return transposed ? e.column() : e.row();
+    }
+
+    /**
+     * @brief colonna di e nella matrice compressa
+     */
+    template<typename Element>
+    static size_type minor_index(const Element &e, bool transposed){
+        return transposed ? e.row() : e.column();
+    }
+
+    /**
+     * @brief Funtore di confronto per ordinare gli elementi di una riga per colonna
+     */
+    struct column_less {
+        bool transposed;
+
+        explicit column_less(bool transposed) : transposed(transposed) {}
+
+        template<typename Element>
+        bool operator()(const Element *a, const Element *b) const {
+            return minor_index(*a, transposed) < minor_index(*b, transposed);
+        }
+    };
+
+    /**
+     * @brief Riempie gli array a partire dagli elementi di other, o da quelli della sua trasposta
+     *
+     * Gli elementi vengono distribuiti per riga con un counting sort e poi ordinati per colonna all'interno di ogni
+     * riga, quindi il costo è O(rows + nnz log nnz) nel caso peggiore.
+     * @pre m_row_ptr contiene m_rows + 1 zeri
+     */
+    template<typename Alloc, typename Index>
+    void compress(const SparseMatrix<T, Alloc, Index> &other, bool transposed){
+        typedef typename SparseMatrix<T, Alloc, Index>::element element;
+        typename SparseMatrix<T, Alloc, Index>::const_iterator it, end = other.end();
+
+        for(it = other.begin(); it != end; ++it){
+            ++m_row_ptr[major_index(*it, transposed) + 1];
+        }
+        for(size_type i = 0; i < m_rows; ++i){
+            m_row_ptr[i + 1] += m_row_ptr[i];
+        }
+
+        std::vector<const element*> sorted(other.inserted_items());
+        std::vector<size_type> next(m_row_ptr.begin(), m_row_ptr.end() - 1);
+        for(it = other.begin(); it != end; ++it){
+            sorted[next[major_index(*it, transposed)]++] = &(*it);
+        }
+        for(size_type i = 0; i < m_rows; ++i){
+            std::sort(sorted.begin() + m_row_ptr[i], sorted.begin() + m_row_ptr[i + 1], column_less(transposed));
+        }
+
+        m_col_idx.reserve(sorted.size());
+        m_values.reserve(sorted.size());
+        for(typename std::vector<const element*>::size_type k = 0; k < sorted.size(); ++k){
+            m_col_idx.push_back(minor_index(*sorted[k], transposed));
+            m_values.push_back(sorted[k]->value());
+        }
+    }
+};
+
+template<typename T, typename Alloc, typename Index>
+CSRMatrix<T> SparseMatrix<T, Alloc, Index>::freeze() const {
+    return CSRMatrix<T>(*this);
+}
+
+
+/**
+ * @brief Versione di evaluate per CSRMatrix.
+ *
+ * Scorre direttamente l'array contiguo dei valori.
+ *
+ * @tparam T il tipo di dato della matrice
+ * @tparam Pred il tipo del funtore
+ * @param M la matrice da visitare
+ * @param P il predicato da testare
+ * @return il numero di elementi logici della matrice che soddisfano P
+ */
+template<typename T, typename Pred>
+typename CSRMatrix<T>::size_type evaluate(const CSRMatrix<T> &M, Pred P){
+    typename CSRMatrix<T>::size_type result = 0;
+    const T *values = M.values();
+    for(typename CSRMatrix<T>::size_type k = 0; k < M.inserted_items(); ++k){
+        if(P(values[k])){
+            ++result;
+        }
+    }
+    if(P(M.default_value())){
+        result += (M.rows() * M.columns() - M.inserted_items());
+    }
+
+    return result;
+}
+
+// Le funzioni di salvataggio richiedono CSRMatrix completa
+#include "MappedMatrix.h"
+
+#endif
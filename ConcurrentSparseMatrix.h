@@ -0,0 +1,257 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ *
+ * @file ConcurrentSparseMatrix.h
+ * @author Gabriele Canesi
+ * @brief File contenente la definizione della classe ConcurrentSparseMatrix, matrice sparsa in cui più thread
+ * possono inserire elementi contemporaneamente
+ */
+
+#ifndef CONCURRENT_SPARSE_MATRIX_H
+#define CONCURRENT_SPARSE_MATRIX_H
+#include "SparseMatrix.h"
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+/**
+ * @brief Matrice sparsa condivisibile tra più thread, divisa in shard di righe.
+ *
+ * La riga i appartiene allo shard i % shard_count(); ogni shard è una SparseMatrix con le dimensioni dell'intera
+ * matrice, protetta dal proprio mutex. Due thread che scrivono in righe di shard diversi non si contendono alcun
+ * lock, quindi con un numero di shard abbastanza più grande del numero di produttori l'inserimento scala con il
+ * numero di thread. Tutti i metodi pubblici sono thread safe.
+ *
+ * La matrice non si visita direttamente: snapshot() ne restituisce una copia coerente come SparseMatrix ordinaria.
+ *
+ * @tparam T Il tipo di dato memorizzato all'interno della matrice
+ * @tparam Alloc L'allocatore usato dagli shard e dalle copie
+ * @tparam Index Il tipo degli indici memorizzati negli shard e nelle copie
+ */
+template<typename T, typename Alloc = std::allocator<T>, typename Index = long>
+class ConcurrentSparseMatrix {
+public:
+
+    /**
+     * @typedef size_type
+     * @brief Lo stesso tipo usato da SparseMatrix per indici e dimensioni
+     */
+    typedef typename SparseMatrix<T, Alloc, Index>::size_type size_type;
+
+    /**
+     * @brief Costruttore che prende in input la dimensione della matrice, il valore di default e il numero di shard
+     *
+     * @param n numero di righe
+     * @param m numero di colonne
+     * @param default_value valore di default
+     * @param shards numero di shard. Con 0 vengono usati 8 shard per ogni thread hardware
+     * @param alloc l'allocatore da usare
+     * @throws invalid_matrix_dimension_exception se le dimensioni non sono valide
+     */
+    ConcurrentSparseMatrix(size_type n, size_type m, const T &default_value, unsigned shards = 0,
+                           const Alloc &alloc = Alloc()) : m_rows(n), m_columns(m), m_default(default_value),
+                                                           m_alloc(alloc) {
+        if(shards == 0){
+            shards = 8 * (std::thread::hardware_concurrency() == 0 ? 1 : std::thread::hardware_concurrency());
+        }
+        m_shard_count = shards;
+        m_shards.reset(new shard[shards]);
+        // La costruzione del primo shard controlla le dimensioni
+        for(unsigned s = 0; s < shards; ++s){
+            m_shards[s].data = SparseMatrix<T, Alloc, Index>(n, m, default_value, alloc);
+        }
+    }
+
+    /**
+     * @brief Inserisce o sovrascrive il valore alla posizione specificata
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @param data il valore da inserire
+     * @throws matrix_out_of_bounds_exception se gli indici non rientrano nella matrice
+     */
+    void set(size_type i, size_type j, const T &data){
+        shard &s = shard_of(i);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.data.set(i, j, data);
+    }
+
+    /**
+     * @brief Inserisce o sovrascrive il valore alla posizione specificata
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @param data il valore da inserire
+     * @return true se la posizione non era memorizzata, false se il valore è stato sovrascritto
+     * @throws matrix_out_of_bounds_exception se gli indici non rientrano nella matrice
+     */
+    bool insert_or_assign(size_type i, size_type j, const T &data){
+        shard &s = shard_of(i);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        size_type before = s.data.inserted_items();
+        s.data.set(i, j, data);
+        return s.data.inserted_items() > before;
+    }
+
+    /**
+     * @brief Inserisce o sovrascrive un intervallo di triple std::tuple (riga, colonna, valore)
+     *
+     * Le triple vengono prima raggruppate per shard, poi ogni shard interessato viene bloccato una sola volta per
+     * tutte le sue triple: conviene ai produttori che accumulano gli elementi in un buffer locale. Le triple sono
+     * applicate nell'ordine in cui compaiono, quindi per una posizione ripetuta vale l'ultima.
+     *
+     * Se una tripla è fuori dai limiti viene lanciata l'eccezione prima di modificare la matrice.
+     * @throws matrix_out_of_bounds_exception se una tripla non rientra nella matrice
+     */
+    template<typename InputIt>
+    void insert_or_assign(InputIt first, InputIt last){
+        std::vector<std::vector<InputIt> > groups(m_shard_count);
+        for(; first != last; ++first){
+            size_type i = static_cast<size_type>(std::get<0>(*first));
+            size_type j = static_cast<size_type>(std::get<1>(*first));
+            if(i < 0 || i >= m_rows || j < 0 || j >= m_columns){
+                throw matrix_out_of_bounds_exception("Gli indici specificati non rientrano nei limiti di dimensione della matrice.");
+            }
+            groups[static_cast<unsigned long>(i) % m_shard_count].push_back(first);
+        }
+        for(unsigned s = 0; s < m_shard_count; ++s){
+            if(!groups[s].empty()){
+                std::lock_guard<std::mutex> lock(m_shards[s].mutex);
+                m_shards[s].data.reserve(m_shards[s].data.inserted_items() +
+                                         static_cast<size_type>(groups[s].size()));
+                for(typename std::vector<InputIt>::size_type k = 0; k < groups[s].size(); ++k){
+                    m_shards[s].data.set(static_cast<size_type>(std::get<0>(*groups[s][k])),
+                                         static_cast<size_type>(std::get<1>(*groups[s][k])),
+                                         std::get<2>(*groups[s][k]));
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Rimuove l'elemento alla posizione specificata
+     * @return true se l'elemento era memorizzato
+     * @throws matrix_out_of_bounds_exception se gli indici non rientrano nella matrice
+     */
+    bool erase(size_type i, size_type j){
+        shard &s = shard_of(i);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.data.erase(i, j);
+    }
+
+    /**
+     * @brief Legge il valore alla posizione specificata
+     *
+     * Il valore viene restituito per copia, perché un riferimento non resterebbe valido dopo il rilascio del lock.
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @return il valore memorizzato, o il valore di default
+     * @throws matrix_out_of_bounds_exception se gli indici non rientrano nella matrice
+     */
+    T get(size_type i, size_type j) const {
+        shard &s = shard_of(i);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.data(i, j);
+    }
+
+    /**
+     * @brief numero di elementi memorizzati
+     *
+     * Gli shard vengono letti uno alla volta: se altri thread stanno inserendo il valore può non corrispondere a
+     * nessuno stato esatto della matrice.
+     */
+    size_type inserted_items() const {
+        size_type total = 0;
+        for(unsigned s = 0; s < m_shard_count; ++s){
+            std::lock_guard<std::mutex> lock(m_shards[s].mutex);
+            total += m_shards[s].data.inserted_items();
+        }
+        return total;
+    }
+
+    /**
+     * @brief Copia coerente del contenuto della matrice
+     *
+     * Tutti i lock vengono acquisiti, sempre nello stesso ordine, prima di iniziare la copia: il risultato è lo
+     * stato della matrice in un istante preciso, e le scritture concorrenti restano in attesa fino alla fine della
+     * copia. La memoria per tutti gli elementi viene riservata in anticipo.
+     * @return una SparseMatrix con le stesse dimensioni, lo stesso valore di default e gli stessi elementi
+     */
+    SparseMatrix<T, Alloc, Index> snapshot() const {
+        std::vector<std::unique_lock<std::mutex> > locks;
+        locks.reserve(m_shard_count);
+        size_type total = 0;
+        for(unsigned s = 0; s < m_shard_count; ++s){
+            locks.push_back(std::unique_lock<std::mutex>(m_shards[s].mutex));
+            total += m_shards[s].data.inserted_items();
+        }
+
+        SparseMatrix<T, Alloc, Index> result(m_rows, m_columns, m_default, m_alloc);
+        result.reserve(total);
+        for(unsigned s = 0; s < m_shard_count; ++s){
+            typename SparseMatrix<T, Alloc, Index>::const_iterator it, end = m_shards[s].data.end();
+            for(it = m_shards[s].data.begin(); it != end; ++it){
+                result.set(it->row(), it->column(), it->value());
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief getter per il numero di righe della matrice
+     */
+    size_type rows() const {
+        return m_rows;
+    }
+
+    /**
+     * @brief getter per il numero di colonne della matrice
+     */
+    size_type columns() const {
+        return m_columns;
+    }
+
+    /**
+     * @brief getter per il valore di default
+     */
+    const T& default_value() const {
+        return m_default;
+    }
+
+    /**
+     * @brief getter per il numero di shard
+     */
+    unsigned shard_count() const {
+        return m_shard_count;
+    }
+
+private:
+    /**
+     * @brief Una parte della matrice con il proprio lock
+     */
+    struct shard {
+        mutable std::mutex mutex; ///< Protegge data
+        SparseMatrix<T, Alloc, Index> data; ///< Gli elementi delle righe dello shard
+    };
+
+    size_type m_rows; ///< Numero di righe della matrice
+    size_type m_columns; ///< Numero di colonne della matrice
+    T m_default; ///< Valore di default
+    Alloc m_alloc; ///< Allocatore usato per le copie
+    unsigned m_shard_count; ///< Numero di shard
+    std::unique_ptr<shard[]> m_shards; ///< Gli shard
+
+    /**
+     * @brief lo shard che contiene la riga i; per una riga fuori dai limiti uno qualsiasi, che lancerà l'eccezione
+     */
+    shard& shard_of(size_type i) const {
+        return m_shards[static_cast<unsigned long>(i) % m_shard_count];
+    }
+
+    ConcurrentSparseMatrix(const ConcurrentSparseMatrix &);
+    ConcurrentSparseMatrix& operator=(const ConcurrentSparseMatrix &);
+};
+
+#endif
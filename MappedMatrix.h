@@ -0,0 +1,342 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ *
+ * @file MappedMatrix.h
+ * @author Gabriele Canesi
+ * @brief File contenente il salvataggio delle matrici nel formato binario e la classe MappedCSRMatrix, che legge un
+ * file salvato direttamente dalla memoria mappata
+ */
+
+#ifndef MAPPED_MATRIX_H
+#define MAPPED_MATRIX_H
+#include "CSRMatrix.h"
+#include "mapped_file.h"
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+/**
+ * @brief Famiglia del tipo T da scrivere nell'header
+ */
+template<typename T>
+std::uint32_t matrix_value_kind_of(){
+    if(std::is_floating_point<T>::value){
+        return value_floating;
+    }
+    return std::is_signed<T>::value ? value_signed : value_unsigned;
+}
+
+/**
+ * @brief Arrotonda offset al multiplo successivo di matrix_file_alignment
+ */
+inline std::uint64_t align_file_offset(std::uint64_t offset){
+    return (offset + matrix_file_alignment - 1) / matrix_file_alignment * matrix_file_alignment;
+}
+
+template<typename T>
+void CSRMatrix<T>::save(const std::string &path) const {
+    static_assert(std::is_trivially_copyable<T>::value, "Il formato binario richiede un tipo banalmente copiabile");
+
+    matrix_file_header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "SPMATRIX", sizeof(header.magic));
+    header.version = matrix_file_version;
+    header.layout = layout_csr;
+    header.value_size = sizeof(T);
+    header.value_kind = matrix_value_kind_of<T>();
+    header.index_size = sizeof(size_type);
+    header.rows = m_rows;
+    header.columns = m_columns;
+    header.nnz = inserted_items();
+
+    const std::uint64_t nnz = static_cast<std::uint64_t>(inserted_items());
+    header.default_offset = align_file_offset(sizeof(header));
+    header.pointers_offset = align_file_offset(header.default_offset + sizeof(T));
+    header.indices_offset = align_file_offset(header.pointers_offset + (m_rows + 1) * sizeof(size_type));
+    header.values_offset = align_file_offset(header.indices_offset + nnz * sizeof(size_type));
+
+    matrix_file_writer writer(path);
+    writer.write_section(header.default_offset, &m_default, sizeof(T));
+    writer.write_section(header.pointers_offset, row_pointers(), (m_rows + 1) * sizeof(size_type));
+    writer.write_section(header.indices_offset, column_indices(), nnz * sizeof(size_type));
+    writer.write_section(header.values_offset, values(), nnz * sizeof(T));
+    writer.finish(header);
+}
+
+template<typename T, typename Alloc, typename Index>
+void SparseMatrix<T, Alloc, Index>::save(const std::string &path) const {
+    freeze().save(path);
+}
+
+
+/**
+ * @brief Matrice sparsa in formato CSR in sola lettura, letta direttamente da un file mappato in memoria.
+ *
+ * L'apertura controlla l'header, che le sezioni stiano nel file e che il primo e l'ultimo offset di riga valgano 0
+ * e inserted_items(), quindi costa O(1) indipendentemente dalla dimensione della matrice: gli array non vengono
+ * copiati né convertiti e le pagine del file vengono caricate dal sistema operativo al primo accesso. Gli offset
+ * intermedi e le colonne non vengono controllati: prima di fidarsi di un file di provenienza non sicura bisogna
+ * chiamare verify(), altrimenti un file danneggiato può far leggere operator(), row_begin ed evaluate fuori dalla
+ * mappatura. L'interfaccia di lettura è la stessa di CSRMatrix. La matrice può essere spostata ma non copiata; i puntatori e
+ * gli iteratori restano validi finché la mappatura esiste.
+ *
+ * @tparam T Il tipo di dato memorizzato, banalmente copiabile e uguale a quello usato per salvare il file
+ */
+template<typename T>
+class MappedCSRMatrix {
+public:
+
+    /**
+     * @typedef size_type
+     * @brief Lo stesso tipo usato da SparseMatrix per indici e dimensioni
+     */
+    typedef typename CSRMatrix<T>::size_type size_type;
+
+    /**
+     * @typedef const_iterator
+     * @brief Lo stesso iteratore di CSRMatrix, che visita gli elementi in ordine di riga e di colonna
+     */
+    typedef typename CSRMatrix<T>::const_iterator const_iterator;
+
+    /**
+     * @brief Apre un file scritto con save
+     *
+     * @param path il percorso del file
+     * @throws matrix_file_exception se il file non può essere mappato, se l'header non è valido, se il primo o
+     * l'ultimo offset di riga non sono coerenti con il numero di elementi o se il file è stato salvato con un tipo
+     * di valore o di indice diverso
+     */
+    explicit MappedCSRMatrix(const std::string &path) : m_file(path) {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "Il formato binario richiede un tipo banalmente copiabile");
+
+        const matrix_file_header &header = check_matrix_header(m_file.data(), m_file.size());
+        if(header.layout != layout_csr){
+            throw matrix_file_exception("Il file non contiene una matrice in formato CSR");
+        }
+        if(header.value_size != sizeof(T) || header.value_kind != matrix_value_kind_of<T>()){
+            throw matrix_file_exception("Il tipo dei valori del file non corrisponde a quello richiesto");
+        }
+        if(header.index_size != sizeof(size_type)){
+            throw matrix_file_exception("Il tipo degli indici del file non è supportato su questo sistema");
+        }
+
+        m_rows = static_cast<size_type>(header.rows);
+        m_columns = static_cast<size_type>(header.columns);
+        m_nnz = static_cast<size_type>(header.nnz);
+        m_default = reinterpret_cast<const T*>(m_file.data() + header.default_offset);
+        m_row_ptr = reinterpret_cast<const size_type*>(m_file.data() + header.pointers_offset);
+        m_col_idx = reinterpret_cast<const size_type*>(m_file.data() + header.indices_offset);
+        m_values = reinterpret_cast<const T*>(m_file.data() + header.values_offset);
+        if(m_row_ptr[0] != 0 || m_row_ptr[m_rows] != m_nnz){
+            throw matrix_file_exception("Offset di riga non coerenti con il numero di elementi");
+        }
+    }
+
+    /**
+     * @brief Costruttore di spostamento
+     */
+    MappedCSRMatrix(MappedCSRMatrix &&other) noexcept : m_file(std::move(other.m_file)), m_rows(other.m_rows),
+                                                        m_columns(other.m_columns), m_nnz(other.m_nnz),
+                                                        m_default(other.m_default), m_row_ptr(other.m_row_ptr),
+                                                        m_col_idx(other.m_col_idx), m_values(other.m_values) {}
+
+    /**
+     * @brief Controlla l'integrità e la struttura di tutti i dati del file
+     *
+     * Ricalcola il checksum e lo confronta con quello dell'header, poi controlla che gli offset di riga siano non
+     * decrescenti e che le colonne di ogni riga siano crescenti e interne alla matrice: se restituisce true tutte
+     * le letture restano all'interno della mappatura, anche con un file costruito ad arte. Legge l'intero file,
+     * quindi costa O(dimensione del file).
+     * @return true se i dati non sono stati alterati e descrivono una matrice CSR valida
+     */
+    bool verify() const {
+        const matrix_file_header &header = *reinterpret_cast<const matrix_file_header*>(m_file.data());
+        if(matrix_checksum(m_file.data() + sizeof(header), m_file.size() - sizeof(header)) != header.data_checksum){
+            return false;
+        }
+        // Prima gli offset: con il primo a 0 e l'ultimo a m_nnz, non decrescenti significa interni agli array
+        for(size_type i = 0; i < m_rows; ++i){
+            if(m_row_ptr[i] > m_row_ptr[i + 1]){
+                return false;
+            }
+        }
+        for(size_type i = 0; i < m_rows; ++i){
+            for(size_type k = m_row_ptr[i]; k < m_row_ptr[i + 1]; ++k){
+                if(m_col_idx[k] < 0 || m_col_idx[k] >= m_columns ||
+                   (k > m_row_ptr[i] && m_col_idx[k] <= m_col_idx[k - 1])){
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief operatore per ottenere il valore alla posizione specificata
+     *
+     * La ricerca è binaria sulle colonne della riga i.
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @return il reference costante al valore se memorizzato, il valore di default altrimenti
+     */
+    const T& operator()(size_type i, size_type j) const {
+        if (i >= m_rows || j >= m_columns || i < 0 || j < 0){
+            throw matrix_out_of_bounds_exception("Gli indici specificati non rientrano nei limiti di dimensione della matrice.");
+        }
+
+        const size_type *first = m_col_idx + m_row_ptr[i];
+        const size_type *last = m_col_idx + m_row_ptr[i + 1];
+        const size_type *found = std::lower_bound(first, last, j);
+        if(found == last || *found != j){
+            return *m_default;
+        }
+        return m_values[found - m_col_idx];
+    }
+
+    /**
+     * @brief getter per il numero di elementi memorizzati
+     * @return numero di elementi memorizzati
+     */
+    size_type inserted_items() const {
+        return m_nnz;
+    }
+
+    /**
+     * @brief getter per il numero di righe della matrice
+     * @return numero di righe della matrice
+     */
+    size_type rows() const {
+        return m_rows;
+    }
+
+    /**
+     * @brief getter per il numero di colonne della matrice
+     * @return numero di colonne della matrice
+     */
+    size_type columns() const {
+        return m_columns;
+    }
+
+    /**
+     * @brief getter per il valore di default
+     * @return const reference al valore di default
+     */
+    const T& default_value() const {
+        return *m_default;
+    }
+
+    /**
+     * @brief Array degli offset di riga, di dimensione rows() + 1
+     */
+    const size_type* row_pointers() const {
+        return m_row_ptr;
+    }
+
+    /**
+     * @brief Array delle colonne degli elementi, di dimensione inserted_items()
+     */
+    const size_type* column_indices() const {
+        return m_col_idx;
+    }
+
+    /**
+     * @brief Array dei valori degli elementi, di dimensione inserted_items()
+     */
+    const T* values() const {
+        return m_values;
+    }
+
+    /**
+     * @return l'iteratore costante che punta al primo elemento della matrice
+     */
+    const_iterator begin() const {
+        return const_iterator(m_row_ptr, m_col_idx, m_values, m_nnz, 0, 0);
+    }
+
+    /**
+     * @return l'iteratore che rappresenta l'elemento dopo la fine della matrice
+     */
+    const_iterator end() const {
+        return const_iterator(m_row_ptr, m_col_idx, m_values, m_nnz, 0, m_nnz);
+    }
+
+    /**
+     * @param i indice della riga
+     * @return l'iteratore al primo elemento della riga i
+     */
+    const_iterator row_begin(size_type i) const {
+        if(i < 0 || i >= m_rows){
+            throw matrix_out_of_bounds_exception("La riga richiesta non appartiene alla matrice");
+        }
+        return const_iterator(m_row_ptr, m_col_idx, m_values, m_nnz, i, m_row_ptr[i]);
+    }
+
+    /**
+     * @param i indice della riga
+     * @return l'iteratore che segue l'ultimo elemento della riga i
+     */
+    const_iterator row_end(size_type i) const {
+        if(i < 0 || i >= m_rows){
+            throw matrix_out_of_bounds_exception("La riga richiesta non appartiene alla matrice");
+        }
+        return const_iterator(m_row_ptr, m_col_idx, m_values, m_nnz, i, m_row_ptr[i + 1]);
+    }
+
+private:
+    mapped_file m_file; ///< Il file mappato, che possiede la memoria di tutti gli array
+
+    size_type m_rows; ///< Numero di righe della matrice
+    size_type m_columns; ///< Numero di colonne della matrice
+    size_type m_nnz; ///< Numero di elementi memorizzati
+
+    const T *m_default; ///< Valore di default, all'interno del file
+    const size_type *m_row_ptr; ///< Offset di inizio di ogni riga, più la sentinella finale
+    const size_type *m_col_idx; ///< Colonna di ogni elemento
+    const T *m_values; ///< Valore di ogni elemento
+
+    MappedCSRMatrix(const MappedCSRMatrix &);
+    MappedCSRMatrix& operator=(const MappedCSRMatrix &);
+};
+
+/**
+ * @brief Apre senza copie una matrice salvata con save
+ *
+ * @tparam T il tipo dei valori usato per salvare il file
+ * @param path il percorso del file
+ * @return la vista in sola lettura sul file
+ * @throws matrix_file_exception se il file non è valido o contiene valori di un altro tipo
+ */
+template<typename T>
+MappedCSRMatrix<T> open_mapped(const std::string &path){
+    return MappedCSRMatrix<T>(path);
+}
+
+/**
+ * @brief Versione di evaluate per MappedCSRMatrix.
+ *
+ * @tparam T il tipo di dato della matrice
+ * @tparam Pred il tipo del funtore
+ * @param M la matrice da visitare
+ * @param P il predicato da testare
+ * @return il numero di elementi logici della matrice che soddisfano P
+ */
+template<typename T, typename Pred>
+typename MappedCSRMatrix<T>::size_type evaluate(const MappedCSRMatrix<T> &M, Pred P){
+    typename MappedCSRMatrix<T>::size_type result = 0;
+    const T *values = M.values();
+    for(typename MappedCSRMatrix<T>::size_type k = 0; k < M.inserted_items(); ++k){
+        if(P(values[k])){
+            ++result;
+        }
+    }
+    if(P(M.default_value())){
+        result += (M.rows() * M.columns() - M.inserted_items());
+    }
+
+    return result;
+}
+
+#endif
@@ -0,0 +1,303 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ *
+ * @file MatrixMarket.h
+ * @author Gabriele Canesi
+ * @brief File contenente la lettura e la scrittura di SparseMatrix nel formato testuale Matrix Market (.mtx)
+ */
+
+#ifndef MATRIX_MARKET_H
+#define MATRIX_MARKET_H
+#include "SparseMatrix.h"
+#include "market_io.h"
+#include "mapped_file.h"
+#include <cstring>
+#include <exception>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Legge un valore di una riga di dati e lo converte in T
+ * @return false se non c'è un numero valido
+ */
+template<typename T>
+bool parse_market_value(const char *&p, const char *end, market_field field, T &out){
+    if(field == market_integer){
+        long value;
+        if(!parse_market_long(p, end, value)){
+            return false;
+        }
+        out = static_cast<T>(value);
+        return true;
+    }
+    double value;
+    if(!parse_market_double(p, end, value)){
+        return false;
+    }
+    out = static_cast<T>(value);
+    return true;
+}
+
+/**
+ * @brief Funtore che analizza un blocco di righe di dati di un file Matrix Market
+ *
+ * Nel formato coordinate produce le triple (riga, colonna, valore) con indici a partire da 0, già duplicate per
+ * le matrici simmetriche; nel formato array produce i valori nell'ordine del file. Ogni blocco scrive solo nei
+ * propri vettori; un'eccezione viene salvata in error per essere rilanciata dal thread chiamante.
+ */
+template<typename T>
+struct market_parse_block {
+    typedef std::tuple<long, long, T> triplet;
+
+    const char *data;
+    const market_header *header;
+    std::vector<triplet> *triplets;
+    std::vector<T> *values;
+    long *lines;
+    std::exception_ptr *error;
+
+    market_parse_block(const char *data, const market_header *header, std::vector<triplet> *triplets,
+                       std::vector<T> *values, long *lines, std::exception_ptr *error) :
+            data(data), header(header), triplets(triplets), values(values), lines(lines), error(error) {}
+
+    void operator()(std::size_t begin, std::size_t end){
+        try{
+            parse(begin, end);
+        } catch(...){
+            *error = std::current_exception();
+        }
+    }
+
+    void parse(std::size_t begin, std::size_t end){
+        const char *p = data + begin, *stop = data + end;
+        long count = 0;
+        while(p != stop){
+            const char *line_end = static_cast<const char*>(std::memchr(p, '\n', stop - p));
+            if(line_end == nullptr){
+                line_end = stop;
+            }
+            skip_market_blanks(p, line_end);
+            if(p != line_end && *p != '%'){
+                parse_line(p, line_end);
+                ++count;
+            }
+            p = line_end == stop ? stop : line_end + 1;
+        }
+        *lines = count;
+    }
+
+    void parse_line(const char *p, const char *line_end){
+        T value = T(1);
+        if(header->format == market_array){
+            if(!parse_market_value(p, line_end, header->field, value)){
+                throw matrix_file_exception("Valore non valido nel file Matrix Market");
+            }
+            values->push_back(value);
+        } else {
+            long i, j;
+            if(!parse_market_long(p, line_end, i) || !parse_market_long(p, line_end, j) ||
+               (header->field != market_pattern && !parse_market_value(p, line_end, header->field, value))){
+                throw matrix_file_exception("Riga non valida nel file Matrix Market");
+            }
+            if(i < 1 || i > header->rows || j < 1 || j > header->columns){
+                throw matrix_file_exception("Indici fuori dai limiti nel file Matrix Market");
+            }
+            triplets->push_back(triplet(i - 1, j - 1, value));
+            if(header->symmetry != market_general && i != j){
+                triplets->push_back(triplet(j - 1, i - 1, header->symmetry == market_skew_symmetric ? -value : value));
+            }
+        }
+        skip_market_blanks(p, line_end);
+        if(p != line_end){
+            throw matrix_file_exception("Caratteri inattesi in una riga del file Matrix Market");
+        }
+    }
+};
+
+/**
+ * @brief Legge una matrice da un file Matrix Market
+ *
+ * Sono supportati i formati coordinate e array, i valori real, integer e pattern (che valgono 1) e le simmetrie
+ * general, symmetric e skew-symmetric. Il file viene mappato in memoria e il corpo diviso in blocchi di righe di
+ * dimensione simile, analizzati in parallelo con un parser numerico dedicato. Le triple ottenute vengono inserite
+ * con assign, in un'unica costruzione ordinata; le posizioni ripetute vengono sommate. Nel formato array i valori
+ * nulli non vengono memorizzati.
+ *
+ * @tparam T un tipo aritmetico; i file con valori real richiedono un tipo in virgola mobile
+ * @tparam Alloc l'allocatore della matrice restituita
+ * @tparam Index il tipo degli indici della matrice restituita
+ * @param path il percorso del file
+ * @param threads numero di thread da usare, compreso il chiamante. Con 0 viene usato
+ * std::thread::hardware_concurrency()
+ * @return la matrice letta, con valore di default T()
+ * @throws matrix_file_exception se il file non può essere letto o non è valido
+ * @throws invalid_matrix_dimension_exception se le dimensioni dichiarate non sono rappresentabili con Index
+ */
+template<typename T, typename Alloc = std::allocator<T>, typename Index = long>
+SparseMatrix<T, Alloc, Index> read_matrix_market(const std::string &path, unsigned threads = 0){
+    static_assert(std::is_arithmetic<T>::value, "Il formato Matrix Market richiede un tipo aritmetico");
+    typedef std::tuple<long, long, T> triplet;
+
+    mapped_file file(path);
+    const char *data = reinterpret_cast<const char*>(file.data());
+    const market_header header = parse_market_header(data, file.size());
+    if(header.field == market_real && std::is_integral<T>::value){
+        throw matrix_file_exception("Il file contiene valori reali, non rappresentabili con il tipo richiesto");
+    }
+
+    if(threads == 0){
+        threads = std::thread::hardware_concurrency();
+    }
+    if(threads == 0 || file.size() - header.body < (1 << 16)){
+        threads = 1;
+    }
+
+    std::vector<std::size_t> bounds = split_market_lines(data, header.body, file.size(), threads);
+    std::vector<std::vector<triplet> > triplets(threads);
+    std::vector<std::vector<T> > values(threads);
+    std::vector<long> lines(threads, 0);
+    std::vector<std::exception_ptr> errors(threads);
+
+    std::vector<std::thread> workers;
+    try{
+        for(unsigned t = 1; t < threads; ++t){
+            workers.push_back(std::thread(market_parse_block<T>(data, &header, &triplets[t], &values[t], &lines[t],
+                                                                &errors[t]), bounds[t], bounds[t + 1]));
+        }
+    } catch(...){
+        for(std::vector<std::thread>::size_type k = 0; k < workers.size(); ++k){
+            workers[k].join();
+        }
+        throw;
+    }
+    market_parse_block<T>(data, &header, &triplets[0], &values[0], &lines[0], &errors[0])(bounds[0], bounds[1]);
+    for(std::vector<std::thread>::size_type k = 0; k < workers.size(); ++k){
+        workers[k].join();
+    }
+
+    long total = 0;
+    for(unsigned t = 0; t < threads; ++t){
+        if(errors[t]){
+            std::rethrow_exception(errors[t]);
+        }
+        total += lines[t];
+    }
+    if(total != header.entries){
+        throw matrix_file_exception("Il numero di righe di dati non corrisponde a quello dichiarato");
+    }
+
+    std::vector<triplet> all;
+    if(header.format == market_coordinate){
+        if(threads == 1){
+            all.swap(triplets[0]);
+        } else {
+            for(unsigned t = 0; t < threads; ++t){
+                all.insert(all.end(), triplets[t].begin(), triplets[t].end());
+                std::vector<triplet>().swap(triplets[t]);
+            }
+        }
+    } else {
+        // Nel formato array la posizione di un valore dipende solo dal suo ordine nel file, per colonne
+        long i = header.symmetry == market_skew_symmetric ? 1 : 0, j = 0;
+        for(unsigned t = 0; t < threads; ++t){
+            for(typename std::vector<T>::size_type k = 0; k < values[t].size(); ++k){
+                const T &value = values[t][k];
+                if(value != T()){
+                    all.push_back(triplet(i, j, value));
+                    if(header.symmetry != market_general && i != j){
+                        all.push_back(triplet(j, i, header.symmetry == market_skew_symmetric ? -value : value));
+                    }
+                }
+                if(++i == header.rows){
+                    ++j;
+                    i = header.symmetry == market_general ? 0 : (header.symmetry == market_symmetric ? j : j + 1);
+                }
+            }
+        }
+    }
+
+    return SparseMatrix<T, Alloc, Index>(header.rows, header.columns, T(), all.begin(), all.end(), sum_duplicates());
+}
+
+/**
+ * @brief Scrive un valore con le cifre necessarie a rileggerlo senza perdite
+ */
+template<typename T>
+void write_market_value(market_writer &writer, const T &value){
+    if(std::is_integral<T>::value){
+        writer.write(static_cast<long>(value));
+    } else {
+        writer.write(static_cast<double>(value), sizeof(T) <= sizeof(float) ? 9 : 17);
+    }
+}
+
+/**
+ * @brief Scrive una matrice in un file Matrix Market
+ *
+ * Nel formato coordinate vengono scritti gli elementi memorizzati in ordine di riga e di colonna, usando l'indice
+ * ordinato della matrice; le posizioni assenti valgono 0, quindi il valore di default deve essere T(). Nel formato
+ * array vengono scritti tutti i valori logici, in ordine di colonna, con qualunque valore di default. L'output
+ * passa attraverso un buffer di 1 MiB.
+ *
+ * @tparam T un tipo aritmetico
+ * @tparam Alloc l'allocatore della matrice
+ * @tparam Index il tipo degli indici della matrice
+ * @param M la matrice da scrivere
+ * @param path il percorso del file
+ * @param format il formato del corpo del file
+ * @throws unsupported_default_value_exception nel formato coordinate, se il valore di default non è T()
+ * @throws matrix_file_exception se il file non può essere scritto
+ */
+template<typename T, typename Alloc, typename Index>
+void write_matrix_market(const SparseMatrix<T, Alloc, Index> &M, const std::string &path,
+                         market_format format = market_coordinate){
+    static_assert(std::is_arithmetic<T>::value, "Il formato Matrix Market richiede un tipo aritmetico");
+    if(format == market_coordinate && M.default_value() != T()){
+        throw unsupported_default_value_exception("Il formato coordinate richiede un valore di default nullo");
+    }
+
+    market_writer writer(path);
+    writer.write(format == market_coordinate ? "%%MatrixMarket matrix coordinate " : "%%MatrixMarket matrix array ");
+    writer.write(std::is_integral<T>::value ? "integer general\n" : "real general\n");
+    writer.write(static_cast<long>(M.rows()));
+    writer.put(' ');
+    writer.write(static_cast<long>(M.columns()));
+
+    if(format == market_coordinate){
+        writer.put(' ');
+        writer.write(static_cast<long>(M.inserted_items()));
+        writer.put('\n');
+        typename SparseMatrix<T, Alloc, Index>::ordered_iterator it, end = M.row_major_end();
+        for(it = M.row_major_begin(); it != end; ++it){
+            writer.write(static_cast<long>(it->row() + 1));
+            writer.put(' ');
+            writer.write(static_cast<long>(it->column() + 1));
+            writer.put(' ');
+            write_market_value(writer, it->value());
+            writer.put('\n');
+        }
+    } else {
+        writer.put('\n');
+        typename SparseMatrix<T, Alloc, Index>::ordered_iterator it = M.column_major_begin();
+        typename SparseMatrix<T, Alloc, Index>::ordered_iterator end = M.column_major_end();
+        for(typename SparseMatrix<T, Alloc, Index>::size_type j = 0; j < M.columns(); ++j){
+            for(typename SparseMatrix<T, Alloc, Index>::size_type i = 0; i < M.rows(); ++i){
+                if(it != end && it->row() == i && it->column() == j){
+                    write_market_value(writer, it->value());
+                    ++it;
+                } else {
+                    write_market_value(writer, M.default_value());
+                }
+                writer.put('\n');
+            }
+        }
+    }
+    writer.finish();
+}
+
+#endif
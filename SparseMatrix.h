@@ -14,7 +14,91 @@
 #include <algorithm>
 #include <limits>
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
+#include <ostream>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+template<typename T>
+class CSRMatrix;
+
+/**
+ * @brief Politica per i duplicati nella costruzione da triple: vince l'ultimo valore incontrato
+ */
+struct last_wins {
+    template<typename T>
+    const T& operator()(const T &, const T &incoming) const {
+        return incoming;
+    }
+};
+
+/**
+ * @brief Politica per i duplicati nella costruzione da triple: i valori vengono sommati
+ */
+struct sum_duplicates {
+    template<typename T>
+    T operator()(const T &accumulated, const T &incoming) const {
+        return accumulated + incoming;
+    }
+};
+
+/**
+ * @brief Vale true se due valori di tipo T possono essere confrontati con ==
+ */
+template<typename T>
+struct equality_comparable {
+private:
+    template<typename U>
+    static auto test(int) -> decltype(std::declval<const U&>() == std::declval<const U&>(), std::true_type());
+
+    template<typename U>
+    static std::false_type test(...);
+
+public:
+    typedef decltype(test<T>(0)) type;
+    static const bool value = type::value;
+};
+
+/**
+ * @brief Memoria occupata da una SparseMatrix, in byte, restituita da SparseMatrix::memory_usage()
+ */
+struct sparse_matrix_memory {
+    std::size_t index; ///< Tabella hash e indici ordinati
+    std::size_t values; ///< Valori memorizzati, sizeof(T) per elemento
+    std::size_t overhead; ///< Coordinate dei nodi, nodi non ancora usati, elenco dei blocchi
+
+    /**
+     * @return il totale dei byte
+     */
+    std::size_t total() const {
+        return index + values + overhead;
+    }
+};
+
+/**
+ * @brief Fotografia dei contatori di una SparseMatrix, restituita da SparseMatrix::statistics()
+ *
+ * I contatori vengono raccolti solo compilando con la macro SPARSE_MATRIX_STATISTICS definita; altrimenti
+ * valgono tutti zero e non hanno alcun costo.
+ */
+struct sparse_matrix_statistics {
+    unsigned long long allocations; ///< Chiamate all'allocatore per blocchi di nodi, tabelle hash e contatori
+    unsigned long long lookups; ///< Ricerche di una posizione nella tabella hash, comprese quelle del rehash
+    unsigned long long probes; ///< Celle della tabella esaminate in totale dalle ricerche
+    unsigned long long max_probe; ///< Celle esaminate dalla ricerca più lunga
+    unsigned long long iterator_steps; ///< Incrementi di const_iterator e ordered_iterator
+    unsigned long long evaluate_calls; ///< Chiamate a evaluate, sequenziale o parallela
+
+    sparse_matrix_statistics() : allocations(0), lookups(0), probes(0), max_probe(0), iterator_steps(0),
+                                 evaluate_calls(0) {}
+};
 
 /**
  *
@@ -28,12 +112,77 @@
 
 /**
  * @tparam T Il tipo di dato da memorizzare all'interno della matrice
+ * @tparam Alloc L'allocatore da cui vengono presi i blocchi di memoria della matrice. I nodi non vengono allocati
+ * uno alla volta, ma occupano in modo contiguo dei blocchi (slab) di dimensione crescente, liberati tutti insieme
+ * alla distruzione. La tabella hash contiene gli indici dei nodi invece di puntatori.
+ * @tparam Index Il tipo intero con cui riga e colonna vengono memorizzate in ogni elemento. Con std::uint32_t (o
+ * più piccolo, per matrici con meno di 65536 righe e colonne) ogni nodo occupa meno memoria: per un double si passa
+ * da 24 a 16 byte, e più elementi stanno nella cache. Anche le celle della tabella hash scendono da 8 a 4 byte,
+ * ma la matrice può contenere al più 2^32 - 1 elementi. Il costruttore controlla che le dimensioni siano
+ * rappresentabili; l'interfaccia continua a usare size_type.
+ *
+ * Le copie sono copy-on-write: una matrice copiata condivide nodi, tabella hash e blocchi con l'originale, tramite
+ * un contatore di riferimenti, e li duplica in tempo lineare solo alla prima operazione che la modifica. Questa
+ * operazione invalida i riferimenti e gli iteratori ottenuti in precedenza dalla matrice modificata; quelli delle
+ * altre matrici che condividevano la memoria restano validi.
  */
 
-template<typename T>
+template<typename T, typename Alloc = std::allocator<T>, typename Index = long>
 class SparseMatrix {
+    static_assert(std::is_integral<Index>::value, "Il tipo degli indici deve essere intero");
+
 private:
     struct node;
+    struct slab;
+
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<node> node_allocator;
+    typedef std::allocator_traits<node_allocator> node_traits;
+    /**
+     * Contenuto di una cella della tabella hash: 0 se vuota, altrimenti l'indice del nodo più 1. Con indici di
+     * riga e colonna fino a 32 bit bastano celle a 32 bit, che limitano la matrice a 2^32 - 1 elementi; con
+     * indici più larghi le celle sono grandi come std::size_t.
+     */
+    typedef typename std::conditional<(sizeof(Index) <= sizeof(std::uint32_t)), std::uint32_t,
+                                      std::size_t>::type slot_type;
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<slot_type> table_allocator;
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<slab> slab_allocator;
+    typedef std::atomic<long> share_count;
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<share_count> count_allocator;
+
+#ifdef SPARSE_MATRIX_STATISTICS
+    /**
+     * @brief Contatori di una matrice, vedi sparse_matrix_statistics
+     *
+     * Ogni incremento è una lettura e una scrittura relaxed, non un'operazione atomica read-modify-write: costa
+     * come un incremento ordinario, ma se più thread leggono la stessa matrice qualche incremento può andare perso.
+     * Le copie della matrice partono da contatori nulli.
+     */
+    struct statistics_block {
+        typedef std::atomic<unsigned long long> counter;
+
+        mutable counter allocations;
+        mutable counter lookups;
+        mutable counter probes;
+        mutable counter max_probe;
+        mutable counter iterator_steps;
+        mutable counter evaluate_calls;
+
+        statistics_block() : allocations(0), lookups(0), probes(0), max_probe(0), iterator_steps(0),
+                             evaluate_calls(0) {}
+
+        statistics_block(const statistics_block &) : allocations(0), lookups(0), probes(0), max_probe(0),
+                                                     iterator_steps(0), evaluate_calls(0) {}
+
+        statistics_block& operator=(const statistics_block &) {
+            return *this;
+        }
+
+        static void add(counter &c, unsigned long long n) {
+            c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+    };
+#endif
+
 public:
 
     /**
@@ -42,6 +191,24 @@ public:
      */
     typedef long size_type;
 
+    /**
+     * @typedef index_type
+     * @brief Il tipo con cui riga e colonna sono memorizzate in ogni elemento
+     */
+    typedef Index index_type;
+
+    /**
+     * @typedef allocator_type
+     * @brief Il tipo dell'allocatore della matrice
+     */
+    typedef Alloc allocator_type;
+
+    /**
+     * @typedef value_type
+     * @brief Il tipo dei valori memorizzati
+     */
+    typedef T value_type;
+
     /**
      * @brief Classe che contiene le informazioni sui valori inseriti nella SparseMatrix.
      */
@@ -51,9 +218,9 @@ public:
 
         T m_value; ///< Il valore effettivo
 
-        size_type m_i; ///< Il valore della riga in cui si trova l'elemento
+        index_type m_i; ///< Il valore della riga in cui si trova l'elemento
 
-        size_type m_j; ///< Il valore della colonna in cui si trova l'elemento
+        index_type m_j; ///< Il valore della colonna in cui si trova l'elemento
 
 
 
@@ -81,7 +248,17 @@ public:
         /*
          * Se la copia del valore ha successo, imposto gli indici.
          * */
-        element(size_type i, size_type j, const T &data) : m_value(data), m_i(i), m_j(j) {}
+        element(size_type i, size_type j, const T &data) : m_value(data), m_i(static_cast<index_type>(i)),
+                                                           m_j(static_cast<index_type>(j)) {}
+
+        /**
+         * @brief Costruttore che sposta il valore invece di copiarlo
+         * @param i Valore della riga
+         * @param j Valore della colonna
+         * @param data il valore da spostare nell'elemento
+         */
+        element(size_type i, size_type j, T &&data) : m_value(std::move(data)), m_i(static_cast<index_type>(i)),
+                                                      m_j(static_cast<index_type>(j)) {}
 
 
         /**
@@ -90,6 +267,12 @@ public:
          */
         element(const element &other) : m_value(other.m_value), m_j(other.m_j), m_i(other.m_i) {}
 
+        /**
+         * @brief Costruttore di spostamento
+         * @param other l'elemento da cui spostare il valore
+         */
+        element(element &&other) : m_value(std::move(other.m_value)), m_i(other.m_i), m_j(other.m_j) {}
+
         /**
          * @brief Distruttore
          */
@@ -116,6 +299,21 @@ public:
             return *this;
         }
 
+        /**
+         * @brief Operatore di assegnamento per spostamento
+         * @param other l'elemento da cui spostare il valore
+         * @return se stesso
+         */
+        element& operator=(element &&other){
+            if (this != &other){
+                m_value = std::move(other.m_value);
+                m_i = other.m_i;
+                m_j = other.m_j;
+            }
+
+            return *this;
+        }
+
 
         /**
          * @brief getter per la riga dell'elemento
@@ -142,6 +340,20 @@ public:
         const T& value() const {
             return m_value;
         }
+
+    private:
+        /**
+         * @brief Tipo usato per distinguere il costruttore "in place" dagli altri
+         */
+        struct emplace_tag {};
+
+        /**
+         * @brief Costruisce il valore direttamente a partire dagli argomenti del suo costruttore
+         */
+        template<typename... Args>
+        element(emplace_tag, size_type i, size_type j, Args&&... args) : m_value(std::forward<Args>(args)...),
+                                                                         m_i(static_cast<index_type>(i)),
+                                                                         m_j(static_cast<index_type>(j)) {}
     };
 
 
@@ -153,24 +365,39 @@ public:
      *
      * @post m_rows == 0
      * @post m_columns == 0
-     * @post m_data == nullptr
+     * @post m_inserted_elements == 0
      */
 
-    SparseMatrix() : m_rows(0), m_columns(0), m_data(nullptr), m_inserted_elements(0), m_default() {}
+    SparseMatrix() : m_table(nullptr), m_table_size(0), m_alloc(), m_slabs(nullptr), m_slab_count(0),
+                     m_slab_capacity(0), m_shared(nullptr), m_rows(0), m_columns(0), m_inserted_elements(0),
+                     m_default(), m_prune_defaults(false) {}
+
+    /**
+     * @brief Costruttore di una matrice vuota che usa l'allocatore specificato
+     * @param alloc l'allocatore da usare
+     */
+    explicit SparseMatrix(const Alloc &alloc) : m_table(nullptr), m_table_size(0), m_alloc(alloc),
+                                                m_slabs(nullptr), m_slab_count(0), m_slab_capacity(0),
+                                                m_shared(nullptr), m_rows(0), m_columns(0), m_inserted_elements(0),
+                                                m_default(), m_prune_defaults(false) {}
 
 
     /**
      * @brief Costruttore che prende in input la dimensione della matrice e il valore di default.
      *
      * Per assicurare la coerenza con il numero di elementi inseriti, il numero totale di possibili elementi non può
-     * superare il valore massimo di size_type.
+     * superare il valore massimo di size_type. Inoltre ogni indice di riga e di colonna deve essere rappresentabile
+     * con index_type.
      * @param n numero di righe
      * @param m numero di colonne
      * @param default_value valore di default
+     * @param alloc l'allocatore da usare
+     * @throws invalid_matrix_dimension_exception se le dimensioni non sono valide
      */
-    SparseMatrix(size_type n, size_type m, const T &default_value) : m_data(nullptr), m_rows(0),
-                                                                     m_columns(0), m_inserted_elements(0),
-                                                                     m_default(default_value){
+    SparseMatrix(size_type n, size_type m, const T &default_value, const Alloc &alloc = Alloc()) :
+            m_table(nullptr), m_table_size(0), m_alloc(alloc), m_slabs(nullptr), m_slab_count(0),
+            m_slab_capacity(0), m_shared(nullptr), m_rows(0), m_columns(0), m_inserted_elements(0),
+            m_default(default_value), m_prune_defaults(false) {
         if(n < 0 || m < 0){
             throw invalid_matrix_dimension_exception("Dimensione richiesta negativa");
         }
@@ -178,6 +405,9 @@ public:
         if(m != 0 && n != 0 && std::numeric_limits<size_type>::max()/m < n){
             throw invalid_matrix_dimension_exception("Dimensione richiesta troppo grande");
         }
+        if(!fits_index(n) || !fits_index(m)){
+            throw invalid_matrix_dimension_exception("Dimensione non rappresentabile con il tipo degli indici");
+        }
         m_columns = n;
         m_rows = m;
     }
@@ -185,26 +415,80 @@ public:
 
     /**
      * @brief costruttore di copia
+     *
+     * L'allocatore viene scelto con select_on_container_copy_construction, come nei container della libreria
+     * standard. Se è uguale a quello di other la memoria viene condivisa in tempo costante e duplicata solo alla
+     * prima modifica di una delle due matrici.
      * @param other l'oggetto da copiare
      * @post m_rows == other.m_rows
      * @post m_columns == other.m_columns
      * @post m_default == other.m_default
      */
-    SparseMatrix(const SparseMatrix &other) : m_default(other.m_default), m_columns(other.m_columns),
-                                              m_rows(other.m_rows), m_data(nullptr),
-                                              m_inserted_elements(0) {
-        node* temp = other.m_data;
+    SparseMatrix(const SparseMatrix &other) :
+            m_table(nullptr), m_table_size(0),
+            m_alloc(node_traits::select_on_container_copy_construction(other.m_alloc)), m_slabs(nullptr),
+            m_slab_count(0), m_slab_capacity(0), m_shared(nullptr), m_rows(other.m_rows),
+            m_columns(other.m_columns), m_inserted_elements(0), m_default(other.m_default),
+            m_prune_defaults(other.m_prune_defaults) {
+        share_or_copy(other);
+    }
 
-        // Devo catturare eventuali eccezioni per riportare la matrice allo stato precedente (distruggerla)
-        try{
-            while (temp != nullptr){
-                set(temp->data.m_i, temp->data.m_j, temp->data.m_value);
-                temp = temp->next;
-            }
-        }catch(...){
-            destroy_matrix();
-            throw;
-        }
+    /**
+     * @brief costruttore di copia con un allocatore specifico
+     *
+     * La memoria viene condivisa con other solo se alloc è uguale al suo allocatore.
+     * @param other l'oggetto da copiare
+     * @param alloc l'allocatore della nuova matrice
+     */
+    SparseMatrix(const SparseMatrix &other, const Alloc &alloc) : m_table(nullptr), m_table_size(0),
+                                                                  m_alloc(alloc), m_slabs(nullptr),
+                                                                  m_slab_count(0), m_slab_capacity(0),
+                                                                  m_shared(nullptr), m_rows(other.m_rows),
+                                                                  m_columns(other.m_columns),
+                                                                  m_inserted_elements(0),
+                                                                  m_default(other.m_default),
+                                                                  m_prune_defaults(other.m_prune_defaults) {
+        share_or_copy(other);
+    }
+
+    /**
+     * @brief costruttore di spostamento
+     *
+     * Prende possesso dei nodi, della tabella hash e dell'allocatore di other senza copiare nulla.
+     * @param other la matrice da spostare, che rimane vuota e di dimensione 0 x 0
+     */
+    SparseMatrix(SparseMatrix &&other) noexcept : m_table(nullptr), m_table_size(0),
+                                                  m_alloc(std::move(other.m_alloc)), m_slabs(nullptr),
+                                                  m_slab_count(0), m_slab_capacity(0), m_shared(nullptr),
+                                                  m_rows(0), m_columns(0), m_inserted_elements(0), m_default(),
+                                                  m_prune_defaults(false) {
+        swap_contents(other);
+    }
+
+    /**
+     * @brief Costruisce la matrice a partire da un intervallo di triple (riga, colonna, valore)
+     *
+     * @see assign(InputIt, InputIt, Combine)
+     * @param n numero di righe
+     * @param m numero di colonne
+     * @param default_value valore di default
+     * @param first inizio dell'intervallo di triple
+     * @param last fine dell'intervallo di triple
+     * @param combine politica per le posizioni ripetute
+     */
+    template<typename InputIt, typename Combine>
+    SparseMatrix(size_type n, size_type m, const T &default_value, InputIt first, InputIt last, Combine combine) :
+            SparseMatrix(n, m, default_value) {
+        assign(first, last, combine);
+    }
+
+    /**
+     * @brief Costruisce la matrice a partire da un intervallo di triple; a parità di posizione vince l'ultima
+     */
+    template<typename InputIt>
+    SparseMatrix(size_type n, size_type m, const T &default_value, InputIt first, InputIt last) :
+            SparseMatrix(n, m, default_value) {
+        assign(first, last, last_wins());
     }
 
     /**
@@ -216,156 +500,788 @@ public:
 
     /**
      * @brief Operatore di assegnamento
+     *
+     * L'allocatore di other viene adottato solo se propagate_on_container_copy_assignment lo prevede.
      * @param other Reference all'oggetto da assegnare
      * @return Reference all'oggetto assegnato
      */
     SparseMatrix& operator=(const SparseMatrix &other) {
         if (this != &other){
-            SparseMatrix temp(other);
-            std::swap(m_data, temp.m_data);
-            std::swap(m_columns, temp.m_columns);
-            std::swap(m_rows, temp.m_rows);
-            std::swap(m_default, temp.m_default);
+            typedef typename node_traits::propagate_on_container_copy_assignment propagate;
+            SparseMatrix temp(other, propagate::value ? Alloc(other.m_alloc) : Alloc(m_alloc));
+            swap_allocator(temp.m_alloc, propagate());
+            swap_contents(temp);
         }
         return *this;
     }
 
     /**
-     * @brief Aggiunge un valore alla matrice ad una posizione precisa
-     * @param i indice della riga
-     * @param j indice della colonna
-     * @param data
+     * @brief Operatore di assegnamento per spostamento
+     *
+     * Se l'allocatore può essere propagato i nodi di other vengono semplicemente acquisiti; altrimenti, se i due
+     * allocatori sono diversi, i valori vengono spostati uno per uno in nodi presi dall'allocatore di questa
+     * matrice.
+     * @param other la matrice da spostare
+     * @return Reference all'oggetto assegnato
      */
-    void set(size_type i, size_type j, const T &data){
-        if(i > m_columns || j > m_rows || i < 0 || j < 0){
-            throw matrix_out_of_bounds_exception("Gli indici non rientrano nelle dimensioni della matrice");
-        }
-        node *found = get_node(i, j);
-        if(found == nullptr){
-            node *new_node = new node(i, j, data);
-            new_node->next = m_data;
-            m_data = new_node;
-            ++m_inserted_elements;
-        }
-        else {
-            found->data.m_value = data;
+    SparseMatrix& operator=(SparseMatrix &&other)
+            noexcept(node_traits::propagate_on_container_move_assignment::value) {
+        if (this != &other){
+            typedef typename node_traits::propagate_on_container_move_assignment propagate;
+            if(propagate::value || m_alloc == other.m_alloc){
+                SparseMatrix temp(std::move(other));
+                swap_allocator(temp.m_alloc, propagate());
+                swap_contents(temp);
+            } else {
+                SparseMatrix temp(other.m_columns, other.m_rows, other.m_default, Alloc(m_alloc));
+                temp.m_prune_defaults = other.m_prune_defaults;
+                temp.move_elements(other);
+                swap_contents(temp);
+            }
         }
+        return *this;
     }
 
     /**
-     * @brief operatore per ottenere il valore alla posizione specificata
-     * @param i indice della riga
-     * @param j indice della colonna
-     * @return il reference costante alla posizione specificata se esiste, il valore di default altrimenti
+     * @brief Scambia il contenuto di due matrici in tempo costante
+     *
+     * Gli allocatori vengono scambiati solo se propagate_on_container_swap lo prevede; in caso contrario devono
+     * essere uguali.
+     * @param other la matrice con cui scambiare il contenuto
      */
-
-    const T& operator()(size_type i, size_type j) const {
-        if (i >= m_columns || j >= m_rows || i < 0 || j < 0){
-            throw matrix_out_of_bounds_exception("Gli indici specificati non rientrano nei limiti di dimensione della matrice.");
-        }
-
-        node *found = get_node(i, j);
-        if(found == nullptr){
-            return m_default;
-        }
-
-        return found->data.m_value;
+    void swap(SparseMatrix &other) noexcept {
+        swap_allocator(other.m_alloc, typename node_traits::propagate_on_container_swap());
+        swap_contents(other);
     }
 
     /**
-     * @brief getter per il numero di elementi inseriti
-     * @return numero di elementi inseriti
+     * @return una copia dell'allocatore della matrice
      */
-
-    size_type inserted_items() const {
-        return m_inserted_elements;
+    allocator_type get_allocator() const {
+        return allocator_type(m_alloc);
     }
 
+private:
 
     /**
-     * @brief getter per il numero di righe della matrice
-     * @return numero di righe della matrice
+     * @brief funzione di appoggio per i costruttori di copia
+     *
+     * Copia tutti gli elementi di other. Se una copia fallisce la matrice viene distrutta e l'eccezione rilanciata.
      */
-    size_type rows() const {
-        return m_columns;
+    void copy_elements(const SparseMatrix &other){
+        // Devo catturare eventuali eccezioni per riportare la matrice allo stato precedente (distruggerla)
+        try{
+            reserve(other.m_inserted_elements);
+            for(size_type k = 0; k < other.m_inserted_elements; ++k){
+                const node *temp = other.node_at(k);
+                set(temp->data.m_i, temp->data.m_j, temp->data.m_value);
+            }
+        }catch(...){
+            destroy_matrix();
+            throw;
+        }
     }
 
     /**
-     * @brief getter per il numero di colonne della matrice
-     * @return numero di colonne della matrice
+     * @brief funzione di appoggio per i costruttori di copia
+     *
+     * Condivide la memoria di other se gli allocatori sono uguali, altrimenti copia gli elementi.
      */
-
-    size_type columns() const {
-        return m_rows;
+    void share_or_copy(const SparseMatrix &other){
+        if(other.m_shared == nullptr || !(m_alloc == other.m_alloc)){
+            copy_elements(other);
+            return;
+        }
+        other.m_shared->fetch_add(1, std::memory_order_relaxed);
+        m_shared = other.m_shared;
+        m_table = other.m_table;
+        m_table_size = other.m_table_size;
+        m_inserted_elements = other.m_inserted_elements;
+        m_slabs = other.m_slabs;
+        m_slab_count = other.m_slab_count;
+        m_slab_capacity = other.m_slab_capacity;
     }
 
     /**
-     * @brief getter per il numero di elementi inseriti
-     * @return const reference al valore di default
+     * @brief funzione di appoggio per l'assegnamento per spostamento con allocatori diversi
+     *
+     * Sposta in nuovi nodi tutti i valori di other, che non viene svuotata ma contiene valori spostati. Se la
+     * memoria di other è condivisa con altre matrici i valori vengono invece copiati.
      */
+    void move_elements(SparseMatrix &other){
+        if(other.is_shared()){
+            copy_elements(other);
+            return;
+        }
+        reserve(other.m_inserted_elements);
+        for(size_type k = 0; k < other.m_inserted_elements; ++k){
+            node *it = other.node_at(k);
+            set(it->data.m_i, it->data.m_j, std::move(it->data.m_value));
+        }
+    }
 
-    const T& default_value() const {
-        return m_default;
+    /**
+     * @brief scambia lo stato di due matrici, allocatore escluso
+     */
+    void swap_contents(SparseMatrix &other) noexcept {
+        std::swap(m_table, other.m_table);
+        std::swap(m_table_size, other.m_table_size);
+        std::swap(m_inserted_elements, other.m_inserted_elements);
+        std::swap(m_columns, other.m_columns);
+        std::swap(m_rows, other.m_rows);
+        std::swap(m_default, other.m_default);
+        std::swap(m_slabs, other.m_slabs);
+        std::swap(m_slab_count, other.m_slab_count);
+        std::swap(m_slab_capacity, other.m_slab_capacity);
+        std::swap(m_shared, other.m_shared);
+        std::swap(m_prune_defaults, other.m_prune_defaults);
+        m_row_order.swap(other.m_row_order);
+        m_column_order.swap(other.m_column_order);
     }
 
     /**
-     * @brief Forward const_iterator per SparseMatrix.
-     *
-     * Questo iteratore visita gli elementi in ordine di inserimento, passando prima dagli elementi inseriti per ultimi.
+     * @brief scambia gli allocatori, quando la propagazione è prevista dai traits dell'allocatore
      */
-    class const_iterator {
-    public:
-        typedef std::forward_iterator_tag iterator_category;
-        typedef element                         value_type;
-        typedef ptrdiff_t                 difference_type;
-        typedef const element*                  pointer;
-        typedef const element&                  reference;
+    void swap_allocator(node_allocator &other, std::true_type) noexcept {
+        using std::swap;
+        swap(m_alloc, other);
+    }
 
+    /**
+     * @brief non fa nulla: l'allocatore non deve essere propagato
+     */
+    void swap_allocator(node_allocator &, std::false_type) noexcept {}
 
-        /**
-         * @brief costruttore di default
-         */
-        const_iterator() : ptr(nullptr) {}
+    /**
+     * @brief Posizione di una tripla in attesa di essere inserita da assign
+     *
+     * L'ordinamento è per riga, colonna e infine per ordine di arrivo, così i duplicati restano nell'ordine
+     * dell'intervallo di partenza.
+     */
+    struct staged_key {
+        size_type i;
+        size_type j;
+        size_type position; ///< Indice del valore nel vettore dei valori letti
 
-        /**
-         * @brief costruttore di copia
-         * @param other l'iteratore da copiare
-         */
-        const_iterator(const const_iterator &other) {
-            ptr = other.ptr;
-        }
+        staged_key(size_type i, size_type j, size_type position) : i(i), j(j), position(position) {}
 
-        /**
-         * @param other l'iteratore da copiare
-         * @return reference al nuovo stato dell'iteratore
-         */
-        const_iterator& operator=(const const_iterator &other) {
-            if(this != &other){
-                ptr = other.ptr;
+        bool operator<(const staged_key &other) const {
+            if(i != other.i){
+                return i < other.i;
             }
-            return *this;
+            if(j != other.j){
+                return j < other.j;
+            }
+            return position < other.position;
         }
+    };
 
+    /**
+     * @name Accesso ai campi di una tripla
+     *
+     * Le versioni per std::tuple sono più specializzate e vengono preferite a quelle generiche, che usano
+     * row(), column() e value().
+     */
+    ///@{
+    template<typename I, typename J, typename V>
+    static size_type triplet_row(const std::tuple<I, J, V> &t){
+        return static_cast<size_type>(std::get<0>(t));
+    }
 
-        /**
-         * @brief Distruttore
-         *
-         * È vuoto perchè il ciclo di vita del nodo dipende da SparseMatrix.
-         */
-        ~const_iterator() {}
+    template<typename I, typename J, typename V>
+    static size_type triplet_column(const std::tuple<I, J, V> &t){
+        return static_cast<size_type>(std::get<1>(t));
+    }
 
+    template<typename I, typename J, typename V>
+    static const V& triplet_value(const std::tuple<I, J, V> &t){
+        return std::get<2>(t);
+    }
 
+    template<typename E>
+    static size_type triplet_row(const E &e){
+        return e.row();
+    }
 
+    template<typename E>
+    static size_type triplet_column(const E &e){
+        return e.column();
+    }
 
-        /**
-         * @brief operatore di dereferenziamento
-         * @return reference all'elemento puntato dall'iteratore
-         */
-        reference operator*() const {
-            return ptr->data;
+    template<typename E>
+    static auto triplet_value(const E &e) -> decltype(e.value()) {
+        return e.value();
+    }
+    ///@}
+
+    /**
+     * @brief lancia matrix_out_of_bounds_exception se (i, j) non appartiene alla matrice
+     */
+    void check_bounds(size_type i, size_type j) const {
+        if(i >= m_columns || j >= m_rows || i < 0 || j < 0){
+            throw matrix_out_of_bounds_exception("Gli indici non rientrano nelle dimensioni della matrice");
         }
+    }
 
-        /**
+    /**
+     * @brief funzione di appoggio per le due versioni di set
+     *
+     * Se la posizione è già occupata il valore viene assegnato (per copia o per spostamento), altrimenti viene
+     * creato un nuovo nodo.
+     */
+    template<typename V>
+    void set_value(size_type i, size_type j, V &&data){
+        check_bounds(i, j);
+        detach();
+        if(m_prune_defaults && is_default(data, typename equality_comparable<T>::type())){
+            erase(i, j);
+            return;
+        }
+        size_type slot = find_slot(i, j);
+        if(m_table != nullptr && m_table[slot] != 0){
+            node_at(m_table[slot] - 1)->data.m_value = std::forward<V>(data);
+            return;
+        }
+        insert_node(slot, i, j, std::forward<V>(data));
+    }
+
+    /**
+     * @brief inserisce un nuovo nodo in (i, j), costruendo il valore con gli argomenti args
+     *
+     * Il nodo occupa la prima posizione libera dei blocchi, subito dopo gli elementi già inseriti.
+     * @param slot la cella vuota della tabella hash restituita da find_slot(i, j)
+     * @throws invalid_matrix_dimension_exception se la matrice contiene già max_elements elementi
+     */
+    template<typename... Args>
+    void insert_node(size_type slot, size_type i, size_type j, Args&&... args){
+        if(m_inserted_elements == max_elements){
+            throw invalid_matrix_dimension_exception("Numero massimo di elementi memorizzabili raggiunto");
+        }
+        // La tabella e i blocchi vengono ingranditi prima di costruire il nodo: se qualcosa fallisce la matrice
+        // resta invariata, al più con più memoria riservata
+        if((m_inserted_elements + 1) * 2 > m_table_size){
+            rehash(m_table_size == 0 ? min_table_size : m_table_size * 2);
+            slot = find_slot(i, j);
+        }
+        if(m_inserted_elements == node_capacity()){
+            add_slab();
+        }
+
+        node_traits::construct(m_alloc, node_at(m_inserted_elements), i, j, std::forward<Args>(args)...);
+        m_table[slot] = static_cast<slot_type>(m_inserted_elements + 1);
+        ++m_inserted_elements;
+        invalidate_order();
+    }
+
+public:
+
+    /**
+     * @brief Aggiunge un valore alla matrice ad una posizione precisa
+     *
+     * Se è attiva la rimozione dei valori di default (set_prune_defaults) e data è uguale al valore di default,
+     * l'eventuale elemento in (i, j) viene rimosso invece di essere aggiornato.
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @param data
+     */
+    void set(size_type i, size_type j, const T &data){
+        set_value(i, j, data);
+    }
+
+    /**
+     * @brief Aggiunge un valore alla matrice ad una posizione precisa, spostandolo invece di copiarlo
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @param data il valore da spostare nella matrice
+     */
+    void set(size_type i, size_type j, T &&data){
+        set_value(i, j, std::move(data));
+    }
+
+    /**
+     * @brief Costruisce un valore direttamente nella posizione (i, j), senza copie né spostamenti
+     *
+     * Se la posizione contiene già un valore, questo viene sostituito da T(args...). Se è attiva la rimozione dei
+     * valori di default il valore viene costruito in un temporaneo, per poterlo confrontare con il default.
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @param args argomenti da passare al costruttore di T
+     */
+    template<typename... Args>
+    void emplace(size_type i, size_type j, Args&&... args){
+        check_bounds(i, j);
+        detach();
+        if(m_prune_defaults){
+            // Il valore va confrontato con il default prima di decidere se inserirlo
+            set_value(i, j, T(std::forward<Args>(args)...));
+            return;
+        }
+        size_type slot = find_slot(i, j);
+        if(m_table != nullptr && m_table[slot] != 0){
+            node_at(m_table[slot] - 1)->data.m_value = T(std::forward<Args>(args)...);
+            return;
+        }
+        insert_node(slot, i, j, std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Sostituisce il contenuto della matrice con un intervallo di triple (riga, colonna, valore)
+     *
+     * Le triple possono essere SparseMatrix::element, std::tuple o qualsiasi tipo con i metodi row(), column() e
+     * value(). Vengono ordinate per posizione e le posizioni ripetute vengono fuse, nell'ordine in cui compaiono,
+     * con combine(valore_accumulato, nuovo_valore). La memoria per tutti i nodi viene allocata prima degli
+     * inserimenti e non serve alcun controllo dei duplicati, quindi il costo è O(n log n).
+     *
+     * Gli elementi risultano visitati dal const_iterator in ordine di riga e di colonna.
+     *
+     * Garanzia forte: se una tripla è fuori dai limiti, o se una copia o combine lanciano un'eccezione, la matrice
+     * resta invariata.
+     * @param first inizio dell'intervallo di triple
+     * @param last fine dell'intervallo di triple
+     * @param combine funtore (const T&, const T&) -> T per le posizioni ripetute, ad esempio last_wins o
+     * sum_duplicates
+     */
+    template<typename InputIt, typename Combine>
+    void assign(InputIt first, InputIt last, Combine combine){
+        std::vector<T> values;
+        std::vector<staged_key> keys;
+        for(; first != last; ++first){
+            size_type i = triplet_row(*first), j = triplet_column(*first);
+            check_bounds(i, j);
+            keys.push_back(staged_key(i, j, static_cast<size_type>(values.size())));
+            values.push_back(triplet_value(*first));
+        }
+        std::sort(keys.begin(), keys.end());
+
+        size_type unique = 0;
+        for(typename std::vector<staged_key>::size_type k = 0; k < keys.size(); ++k){
+            if(k == 0 || keys[k].i != keys[k - 1].i || keys[k].j != keys[k - 1].j){
+                ++unique;
+            }
+        }
+
+        SparseMatrix temp(m_columns, m_rows, m_default, Alloc(m_alloc));
+        temp.m_prune_defaults = m_prune_defaults;
+        temp.reserve(unique);
+
+        // Inserisco a partire dall'ultima posizione: il const_iterator parte dall'ultimo nodo inserito, quindi
+        // visita gli elementi in ordine di riga
+        typename std::vector<staged_key>::size_type end = keys.size();
+        while(end > 0){
+            typename std::vector<staged_key>::size_type begin = end - 1;
+            while(begin > 0 && keys[begin - 1].i == keys[end - 1].i && keys[begin - 1].j == keys[end - 1].j){
+                --begin;
+            }
+            T accumulated = values[keys[begin].position];
+            for(typename std::vector<staged_key>::size_type k = begin + 1; k < end; ++k){
+                accumulated = combine(accumulated, values[keys[k].position]);
+            }
+            if(!m_prune_defaults || !is_default(accumulated, typename equality_comparable<T>::type())){
+                temp.insert_node(temp.find_slot(keys[begin].i, keys[begin].j), keys[begin].i, keys[begin].j,
+                                 std::move(accumulated));
+            }
+            end = begin;
+        }
+
+        swap_contents(temp);
+    }
+
+    /**
+     * @brief Sostituisce il contenuto della matrice con un intervallo di triple; a parità di posizione vince
+     * l'ultima
+     */
+    template<typename InputIt>
+    void assign(InputIt first, InputIt last){
+        assign(first, last, last_wins());
+    }
+
+    /**
+     * @brief Prepara la matrice a contenere almeno n elementi senza ridimensionare l'indice interno
+     *
+     * Utile prima di inserimenti massivi: evita le riallocazioni della tabella hash durante le chiamate a set e
+     * alloca subito i blocchi di nodi mancanti. I nodi liberati da erase restano nei blocchi e contano come spazio
+     * disponibile.
+     * @param n numero di elementi previsti
+     */
+    void reserve(size_type n){
+        detach();
+        size_type size = m_table_size == 0 ? min_table_size : m_table_size;
+        while(size < n * 2){
+            size *= 2;
+        }
+        if(size != m_table_size){
+            rehash(size);
+        }
+
+        while(node_capacity() < n){
+            add_slab();
+        }
+    }
+
+    /**
+     * @brief Rimuove l'elemento in posizione (i, j), che torna a valere default_value()
+     *
+     * Il posto del nodo rimosso viene preso dall'ultimo nodo dei blocchi, quello inserito più di recente, così i
+     * nodi restano contigui: l'ordine di visita del const_iterator cambia solo per quell'elemento. La cella
+     * della tabella hash viene liberata spostando indietro gli elementi successivi della stessa sequenza di
+     * scansione, senza lasciare marcatori. Il costo è O(1) in media e il nodo liberato viene riusato dal prossimo
+     * inserimento.
+     *
+     * Invalida iteratori e riferimenti agli elementi della matrice. Se lo spostamento del valore dell'ultimo nodo
+     * lancia un'eccezione la matrice resta valida e l'elemento non viene rimosso.
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @return true se in (i, j) c'era un elemento
+     */
+    bool erase(size_type i, size_type j){
+        check_bounds(i, j);
+        detach();
+        if(m_table == nullptr){
+            return false;
+        }
+        size_type slot = find_slot(i, j);
+        if(m_table[slot] == 0){
+            return false;
+        }
+
+        const size_type index = m_table[slot] - 1;
+        node *last = node_at(m_inserted_elements - 1);
+        if(index != m_inserted_elements - 1){
+            node *target = node_at(index);
+            size_type last_slot = find_slot(last->data.m_i, last->data.m_j);
+            target->data.m_value = std::move(last->data.m_value);
+            target->data.m_i = last->data.m_i;
+            target->data.m_j = last->data.m_j;
+            m_table[last_slot] = static_cast<slot_type>(index + 1);
+        }
+        erase_slot(slot);
+        node_traits::destroy(m_alloc, last);
+        --m_inserted_elements;
+        invalidate_order();
+        return true;
+    }
+
+    /**
+     * @brief Rimuove tutti gli elementi per cui pred restituisce true
+     *
+     * I nodi vengono visitati una volta sola e quelli rimasti vengono compattati verso l'inizio dei blocchi,
+     * quindi il costo è O(nnz) e gli elementi rimasti mantengono il loro ordine di visita. Ogni elemento viene
+     * rimosso appena pred restituisce true, senza altre operazioni che possano fallire. Se pred lancia
+     * un'eccezione gli elementi già rimossi restano rimossi; se lancia un'eccezione lo spostamento di un valore,
+     * la matrice resta valida ma perde gli elementi non ancora compattati.
+     * @param pred funtore (const element&) -> bool
+     * @return il numero di elementi rimossi
+     */
+    template<typename Pred>
+    size_type erase_if(Pred pred){
+        detach();
+        const size_type count = m_inserted_elements;
+        size_type kept = 0, read = 0;
+        try{
+            for(; read < count; ++read){
+                node *current = node_at(read);
+                if(pred(static_cast<const element&>(current->data))){
+                    erase_slot(find_slot(current->data.m_i, current->data.m_j));
+                    node_traits::destroy(m_alloc, current);
+                } else {
+                    if(kept != read){
+                        move_node(read, kept);
+                    }
+                    ++kept;
+                }
+            }
+        } catch(...){
+            close_gap(kept, read, count);
+            throw;
+        }
+        m_inserted_elements = kept;
+        if(kept != count){
+            invalidate_order();
+        }
+        return count - kept;
+    }
+
+    /**
+     * @brief Attiva o disattiva la rimozione automatica dei valori uguali al default
+     *
+     * Con la modalità attiva set ed emplace di un valore uguale a default_value() rimuovono l'elemento invece di
+     * memorizzarlo, e assign scarta le posizioni il cui valore finale è il default; così inserted_items() conta
+     * solo i valori diversi dal default. All'attivazione vengono rimossi anche gli elementi già presenti uguali
+     * al default. Richiede che T sia confrontabile con ==.
+     * @param enable true per attivare la modalità
+     */
+    void set_prune_defaults(bool enable){
+        static_assert(equality_comparable<T>::value, "La rimozione dei valori di default richiede l'operatore ==");
+        if(enable && !m_prune_defaults){
+            erase_if(default_equal(m_default));
+        }
+        m_prune_defaults = enable;
+    }
+
+    /**
+     * @return true se è attiva la rimozione automatica dei valori uguali al default
+     */
+    bool prune_defaults() const {
+        return m_prune_defaults;
+    }
+
+    /**
+     * @brief Ricostruisce la matrice in ordine di riga, dopo molti inserimenti e rimozioni
+     *
+     * I nodi vengono copiati (o spostati, se lo spostamento non lancia eccezioni) in nuovi blocchi, in ordine di
+     * riga e di colonna, e la tabella hash viene ridimensionata sul numero di elementi attuale. I blocchi
+     * precedenti, compresi i nodi non più usati dopo le rimozioni, vengono restituiti all'allocatore. Dopo la
+     * chiamata il const_iterator visita gli elementi in ordine di riga. Garanzia forte se la copia dei valori può
+     * lanciare eccezioni.
+     */
+    void compact(){
+        SparseMatrix temp(m_columns, m_rows, m_default, Alloc(m_alloc));
+        temp.m_prune_defaults = m_prune_defaults;
+        temp.reserve(m_inserted_elements);
+
+        // Inserisco dall'ultimo elemento in ordine di riga, così la nuova matrice viene visitata in ordine di riga.
+        // I valori condivisi con altre matrici vengono copiati invece che spostati
+        const bool shared = is_shared();
+        const std::vector<const node*> &order = ordered_index(true);
+        for(typename std::vector<const node*>::size_type k = order.size(); k > 0; --k){
+            node *source = const_cast<node*>(order[k - 1]);
+            if(shared){
+                temp.insert_node(temp.find_slot(source->data.m_i, source->data.m_j), source->data.m_i,
+                                 source->data.m_j, static_cast<const T&>(source->data.m_value));
+            } else {
+                temp.insert_node(temp.find_slot(source->data.m_i, source->data.m_j), source->data.m_i,
+                                 source->data.m_j, std::move_if_noexcept(source->data.m_value));
+            }
+        }
+        swap_contents(temp);
+    }
+
+    /**
+     * @brief operatore per ottenere il valore alla posizione specificata
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @return il reference costante alla posizione specificata se esiste, il valore di default altrimenti
+     */
+
+    const T& operator()(size_type i, size_type j) const {
+        if (i >= m_columns || j >= m_rows || i < 0 || j < 0){
+            throw matrix_out_of_bounds_exception("Gli indici specificati non rientrano nei limiti di dimensione della matrice.");
+        }
+
+        node *found = get_node(i, j);
+        if(found == nullptr){
+            return m_default;
+        }
+
+        return found->data.m_value;
+    }
+
+    /**
+     * @brief getter per il numero di elementi inseriti
+     * @return numero di elementi inseriti
+     */
+
+    size_type inserted_items() const {
+        return m_inserted_elements;
+    }
+
+
+    /**
+     * @brief getter per il numero di righe della matrice
+     * @return numero di righe della matrice
+     */
+    size_type rows() const {
+        return m_columns;
+    }
+
+    /**
+     * @brief getter per il numero di colonne della matrice
+     * @return numero di colonne della matrice
+     */
+
+    size_type columns() const {
+        return m_rows;
+    }
+
+    /**
+     * @brief getter per il numero di elementi inseriti
+     * @return const reference al valore di default
+     */
+
+    const T& default_value() const {
+        return m_default;
+    }
+
+    /**
+     * @brief Numero di celle dell'indice hash interno
+     *
+     * Insieme a bucket_element permette di dividere gli elementi in blocchi indipendenti, ad esempio per visitarli
+     * con più thread.
+     * @return il numero di celle, 0 se la matrice non ha mai contenuto elementi
+     */
+    size_type bucket_count() const {
+        return m_table_size;
+    }
+
+    /**
+     * @brief Elemento contenuto in una cella dell'indice hash interno
+     *
+     * Ogni elemento inserito compare in esattamente una cella, in un ordine che non ha relazione con la posizione
+     * nella matrice.
+     * @param k indice della cella, compreso tra 0 e bucket_count()
+     * @return puntatore all'elemento, nullptr se la cella è vuota
+     */
+    const element* bucket_element(size_type k) const {
+        return m_table[k] == 0 ? nullptr : &node_at(m_table[k] - 1)->data;
+    }
+
+    /**
+     * @brief Memoria occupata dalla matrice
+     *
+     * Conta la memoria allocata dalla matrice e l'oggetto stesso, ma non quella posseduta dai valori (ad esempio
+     * i caratteri di una std::string lunga). Le matrici che condividono la memoria dopo una copia la contano
+     * ciascuna per intero. Costa O(numero di blocchi).
+     * @return i byte occupati da indice, valori e strutture di supporto
+     */
+    sparse_matrix_memory memory_usage() const {
+        sparse_matrix_memory result;
+        result.index = static_cast<std::size_t>(m_table_size) * sizeof(slot_type) +
+                       (m_row_order.capacity() + m_column_order.capacity()) * sizeof(const node*);
+        result.values = static_cast<std::size_t>(m_inserted_elements) * sizeof(T);
+
+        std::size_t node_bytes = 0;
+        for(size_type k = 0; k < m_slab_count; ++k){
+            node_bytes += static_cast<std::size_t>(m_slabs[k].capacity) * sizeof(node);
+        }
+        result.overhead = node_bytes - result.values + static_cast<std::size_t>(m_slab_capacity) * sizeof(slab) +
+                          (m_shared == nullptr ? 0 : sizeof(share_count)) + sizeof(*this);
+        return result;
+    }
+
+    /**
+     * @brief Fotografia dei contatori della matrice
+     * @return i contatori, tutti a zero se SPARSE_MATRIX_STATISTICS non è definita
+     * @see sparse_matrix_statistics
+     */
+    sparse_matrix_statistics statistics() const {
+        sparse_matrix_statistics result;
+#ifdef SPARSE_MATRIX_STATISTICS
+        result.allocations = m_statistics.allocations.load(std::memory_order_relaxed);
+        result.lookups = m_statistics.lookups.load(std::memory_order_relaxed);
+        result.probes = m_statistics.probes.load(std::memory_order_relaxed);
+        result.max_probe = m_statistics.max_probe.load(std::memory_order_relaxed);
+        result.iterator_steps = m_statistics.iterator_steps.load(std::memory_order_relaxed);
+        result.evaluate_calls = m_statistics.evaluate_calls.load(std::memory_order_relaxed);
+#endif
+        return result;
+    }
+
+    /**
+     * @brief Azzera i contatori della matrice
+     */
+    void reset_statistics() {
+#ifdef SPARSE_MATRIX_STATISTICS
+        m_statistics.allocations.store(0, std::memory_order_relaxed);
+        m_statistics.lookups.store(0, std::memory_order_relaxed);
+        m_statistics.probes.store(0, std::memory_order_relaxed);
+        m_statistics.max_probe.store(0, std::memory_order_relaxed);
+        m_statistics.iterator_steps.store(0, std::memory_order_relaxed);
+        m_statistics.evaluate_calls.store(0, std::memory_order_relaxed);
+#endif
+    }
+
+    /**
+     * @brief Crea una copia immutabile della matrice in formato CSR (compressed sparse row)
+     *
+     * Utile per le fasi in cui la matrice viene solo letta: la rappresentazione compressa è contigua in memoria.
+     * @return la matrice in formato CSR
+     */
+    CSRMatrix<T> freeze() const;
+
+    /**
+     * @brief Salva la matrice nel formato binario descritto in mapped_file.h
+     *
+     * La matrice viene convertita in formato CSR e scritta su disco; il file si riapre senza copie con
+     * open_mapped. Disponibile solo per i tipi T banalmente copiabili.
+     * @param path il percorso del file da scrivere
+     * @throws matrix_file_exception se il file non può essere scritto
+     */
+    void save(const std::string &path) const;
+
+    /**
+     * @brief Forward const_iterator per SparseMatrix.
+     *
+     * Questo iteratore visita gli elementi in ordine di inserimento, passando prima dagli elementi inseriti per ultimi.
+     * I nodi sono contigui all'interno di ogni blocco, quindi la visita scorre la memoria all'indietro, un blocco
+     * alla volta.
+     */
+    class const_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef element                         value_type;
+        typedef ptrdiff_t                 difference_type;
+        typedef const element*                  pointer;
+        typedef const element&                  reference;
+
+
+        /**
+         * @brief costruttore di default
+         */
+        const_iterator() : ptr(nullptr), m_slab(nullptr), m_first(nullptr) {
+#ifdef SPARSE_MATRIX_STATISTICS
+            m_statistics = nullptr;
+#endif
+        }
+
+        /**
+         * @brief costruttore di copia
+         * @param other l'iteratore da copiare
+         */
+        const_iterator(const const_iterator &other) {
+            ptr = other.ptr;
+            m_slab = other.m_slab;
+            m_first = other.m_first;
+#ifdef SPARSE_MATRIX_STATISTICS
+            m_statistics = other.m_statistics;
+#endif
+        }
+
+        /**
+         * @param other l'iteratore da copiare
+         * @return reference al nuovo stato dell'iteratore
+         */
+        const_iterator& operator=(const const_iterator &other) {
+            if(this != &other){
+                ptr = other.ptr;
+                m_slab = other.m_slab;
+                m_first = other.m_first;
+#ifdef SPARSE_MATRIX_STATISTICS
+                m_statistics = other.m_statistics;
+#endif
+            }
+            return *this;
+        }
+
+
+        /**
+         * @brief Distruttore
+         *
+         * È vuoto perchè il ciclo di vita del nodo dipende da SparseMatrix.
+         */
+        ~const_iterator() {}
+
+
+
+
+        /**
+         * @brief operatore di dereferenziamento
+         * @return reference all'elemento puntato dall'iteratore
+         */
+        reference operator*() const {
+            return ptr->data;
+        }
+
+        /**
          * @return puntatore all'elemento puntato dall'iteratore
          */
         pointer operator->() const {
@@ -379,7 +1295,7 @@ public:
          */
         const_iterator operator++(int) {
             const_iterator temp = *this;
-            temp.ptr = temp.ptr->next;
+            ++*this;
             return temp;
         }
 
@@ -389,7 +1305,20 @@ public:
          * @return l'iteratore al nuovo elemento
          */
         const_iterator& operator++() {
-            ptr = ptr->next;
+            if(ptr != m_slab->nodes){
+                --ptr;
+            } else if(m_slab != m_first){
+                // I blocchi precedenti all'ultimo sono sempre pieni
+                --m_slab;
+                ptr = m_slab->nodes + (m_slab->capacity - 1);
+            } else {
+                ptr = nullptr;
+            }
+#ifdef SPARSE_MATRIX_STATISTICS
+            if(m_statistics != nullptr){
+                statistics_block::add(m_statistics->iterator_steps, 1);
+            }
+#endif
             return *this;
         }
 
@@ -411,12 +1340,22 @@ public:
         }
 
     private:
-        const node *ptr;
+        const node *ptr; ///< Il nodo corrente, nullptr alla fine
+        const slab *m_slab; ///< Il blocco che contiene ptr
+        const slab *m_first; ///< Il primo blocco della matrice, dove termina la visita
+#ifdef SPARSE_MATRIX_STATISTICS
+        const statistics_block *m_statistics; ///< I contatori della matrice visitata
+#endif
 
 
         friend class SparseMatrix;
 
-        explicit const_iterator(const node *ptr) : ptr(ptr) {}
+        const_iterator(const node *ptr, const slab *current, const slab *first) : ptr(ptr), m_slab(current),
+                                                                                 m_first(first) {
+#ifdef SPARSE_MATRIX_STATISTICS
+            m_statistics = nullptr;
+#endif
+        }
 
     };
 
@@ -425,7 +1364,11 @@ public:
      * @return l'iteratore costante che punta al primo elemento disponibile
      */
     const_iterator begin() const {
-        return const_iterator(m_data);
+        if(m_inserted_elements == 0){
+            return end();
+        }
+        const size_type k = slab_of(m_inserted_elements - 1);
+        return with_statistics(const_iterator(node_at(m_inserted_elements - 1), m_slabs + k, m_slabs));
     }
 
 
@@ -434,7 +1377,200 @@ public:
      * @return l'iteratore che rappresenta l'elemento dopo la fine della matrice.
      */
     const_iterator end() const {
-        return const_iterator(nullptr);
+        return const_iterator(nullptr, nullptr, nullptr);
+    }
+
+    /**
+     * @brief Forward iterator sugli elementi della matrice in un ordine stabilito.
+     *
+     * Scorre l'indice ordinato della matrice (vedi row_major_begin e row): viene invalidato, insieme all'indice, da
+     * ogni inserimento di una nuova posizione e da ogni rimozione.
+     */
+    class ordered_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef element                         value_type;
+        typedef ptrdiff_t                 difference_type;
+        typedef const element*                  pointer;
+        typedef const element&                  reference;
+
+        /**
+         * @brief costruttore di default
+         */
+        ordered_iterator() : ptr(nullptr) {
+#ifdef SPARSE_MATRIX_STATISTICS
+            m_statistics = nullptr;
+#endif
+        }
+
+        /**
+         * @brief operatore di dereferenziamento
+         * @return reference all'elemento puntato dall'iteratore
+         */
+        reference operator*() const {
+            return (*ptr)->data;
+        }
+
+        /**
+         * @return puntatore all'elemento puntato dall'iteratore
+         */
+        pointer operator->() const {
+            return &(*ptr)->data;
+        }
+
+        /**
+         * @brief operatore di post incremento
+         * @return l'iteratore allo stato antecedente la modifica
+         */
+        ordered_iterator operator++(int) {
+            ordered_iterator temp = *this;
+            ++*this;
+            return temp;
+        }
+
+        /**
+         * @brief operatore di preincremento
+         * @return l'iteratore al nuovo elemento
+         */
+        ordered_iterator& operator++() {
+            ++ptr;
+#ifdef SPARSE_MATRIX_STATISTICS
+            if(m_statistics != nullptr){
+                statistics_block::add(m_statistics->iterator_steps, 1);
+            }
+#endif
+            return *this;
+        }
+
+        /**
+         * @param other l'iteratore da confrontare
+         * @return true se this e other puntano allo stesso elemento
+         */
+        bool operator==(const ordered_iterator &other) const {
+            return ptr == other.ptr;
+        }
+
+        /**
+         * @param other l'iteratore da confrontare
+         * @return false se this e other puntano allo stesso elemento
+         */
+        bool operator!=(const ordered_iterator &other) const {
+            return ptr != other.ptr;
+        }
+
+    private:
+        const node * const *ptr; ///< Posizione corrente nell'indice ordinato
+#ifdef SPARSE_MATRIX_STATISTICS
+        const statistics_block *m_statistics; ///< I contatori della matrice visitata
+#endif
+
+        friend class SparseMatrix;
+
+        explicit ordered_iterator(const node * const *ptr) : ptr(ptr) {
+#ifdef SPARSE_MATRIX_STATISTICS
+            m_statistics = nullptr;
+#endif
+        }
+    };
+
+    /**
+     * @brief Intervallo di elementi ordinati, ad esempio una riga, utilizzabile nei cicli for
+     */
+    class ordered_range {
+    public:
+        /**
+         * @return l'iteratore al primo elemento dell'intervallo
+         */
+        ordered_iterator begin() const {
+            return m_begin;
+        }
+
+        /**
+         * @return l'iteratore che segue l'ultimo elemento dell'intervallo
+         */
+        ordered_iterator end() const {
+            return m_end;
+        }
+
+        /**
+         * @return il numero di elementi dell'intervallo
+         */
+        size_type size() const {
+            return m_end.ptr - m_begin.ptr;
+        }
+
+    private:
+        friend class SparseMatrix;
+
+        ordered_iterator m_begin;
+        ordered_iterator m_end;
+
+        ordered_range(const ordered_iterator &begin, const ordered_iterator &end) : m_begin(begin), m_end(end) {}
+    };
+
+    /**
+     * @brief Iteratore al primo elemento in ordine di riga e, nella stessa riga, di colonna
+     *
+     * Alla prima chiamata dopo una modifica della struttura viene costruito l'indice ordinato per righe, in
+     * O(nnz log nnz); le visite successive non hanno costi aggiuntivi. La costruzione modifica lo stato interno:
+     * più thread possono visitare la matrice in parallelo solo dopo che l'indice è stato costruito.
+     */
+    ordered_iterator row_major_begin() const {
+        const std::vector<const node*> &order = ordered_index(true);
+        return with_statistics(ordered_iterator(order.data()));
+    }
+
+    /**
+     * @return l'iteratore che segue l'ultimo elemento in ordine di riga
+     */
+    ordered_iterator row_major_end() const {
+        const std::vector<const node*> &order = ordered_index(true);
+        return ordered_iterator(order.data() + order.size());
+    }
+
+    /**
+     * @brief Iteratore al primo elemento in ordine di colonna e, nella stessa colonna, di riga
+     * @see row_major_begin
+     */
+    ordered_iterator column_major_begin() const {
+        const std::vector<const node*> &order = ordered_index(false);
+        return with_statistics(ordered_iterator(order.data()));
+    }
+
+    /**
+     * @return l'iteratore che segue l'ultimo elemento in ordine di colonna
+     */
+    ordered_iterator column_major_end() const {
+        const std::vector<const node*> &order = ordered_index(false);
+        return ordered_iterator(order.data() + order.size());
+    }
+
+    /**
+     * @brief Elementi memorizzati nella riga i, in ordine di colonna crescente
+     *
+     * La riga viene cercata con una ricerca binaria nell'indice per righe, quindi costa O(log nnz) più il numero
+     * di elementi della riga.
+     * @param i indice della riga
+     * @return l'intervallo degli elementi della riga
+     */
+    ordered_range row(size_type i) const {
+        if(i < 0 || i >= m_columns){
+            throw matrix_out_of_bounds_exception("La riga richiesta non appartiene alla matrice");
+        }
+        return ordered_slice(true, i);
+    }
+
+    /**
+     * @brief Elementi memorizzati nella colonna j, in ordine di riga crescente
+     * @see row
+     * @param j indice della colonna
+     * @return l'intervallo degli elementi della colonna
+     */
+    ordered_range column(size_type j) const {
+        if(j < 0 || j >= m_rows){
+            throw matrix_out_of_bounds_exception("La colonna richiesta non appartiene alla matrice");
+        }
+        return ordered_slice(false, j);
     }
 
 private:
@@ -443,30 +1579,33 @@ private:
     /**
      * @brief Struttura che rappresenta un elemento fisico della SparseMatrix.
      *
-     * Questa struttura è parte della lista concatenata
+     * I nodi non hanno puntatori: il nodo di indice k è il k-esimo inserito tra quelli presenti e si trova con
+     * node_at(k).
      */
     struct node{
 
         element data; ///< Informazioni sull'elemento inserito priva di puntatori interni alla SparseMatrix
-        node *next; ///< Puntatore al nodo successivo
 
 
         /**
          * @brief Costruttore di default
-         *
-         * @post next == nullptr
          */
-        node() : next(nullptr){}
+        node() {}
 
 
         /**
          * @brief Costruttore di copia
          *
-         * Questo costruttore non copia tutti gli elementi della lista, ma copia solo il valore del puntatore successivo.
-         *
          * @param other il nodo da copiare
          */
-        node(const node &other) : data(other.data), next(other.next) {}
+        node(const node &other) : data(other.data) {}
+
+        /**
+         * @brief Costruisce il nodo spostando un elemento
+         *
+         * @param other l'elemento da spostare
+         */
+        explicit node(element &&other) : data(std::move(other)) {}
 
         /**
          *
@@ -474,7 +1613,18 @@ private:
          * @param j La colonna dell'elemento
          * @param data il valore effettivo
          */
-        node(size_type i, size_type j, const T &data) : data(element(i, j, data)), next(nullptr){}
+        node(size_type i, size_type j, const T &data) : data(element(i, j, data)) {}
+
+        /**
+         * @brief Costruisce il valore dell'elemento direttamente con gli argomenti args
+         *
+         * @param i La riga dell'elemento
+         * @param j La colonna dell'elemento
+         * @param args argomenti per il costruttore di T
+         */
+        template<typename... Args>
+        node(size_type i, size_type j, Args&&... args) : data(typename element::emplace_tag(), i, j,
+                                                              std::forward<Args>(args)...) {}
 
         /**
          * @brief Distruttore
@@ -490,14 +1640,59 @@ private:
         node& operator=(const node &other){
             if (this != &other){
                 data = other.data;
-                next = other.next;
             }
             return *this;
         }
     };
 
 
-    node *m_data; ///< Puntatore alla testa della lista di nodi
+    /**
+     * Tabella hash ad indirizzamento aperto (scansione lineare) indicizzata sulla coppia (riga, colonna).
+     * Ogni cella contiene 0 se è vuota, altrimenti l'indice del nodo più 1. La dimensione è sempre una potenza di 2
+     * e il fattore di carico non supera 1/2.
+     */
+    slot_type *m_table;
+    size_type m_table_size; ///< Numero di celle di m_table
+
+    static const size_type min_table_size = 16; ///< Dimensione minima della tabella hash
+
+    /// Numero massimo di elementi, limitato dalla larghezza delle celle della tabella hash
+    static const size_type max_elements = sizeof(slot_type) < sizeof(size_type) ?
+                                          static_cast<size_type>(std::numeric_limits<slot_type>::max()) :
+                                          std::numeric_limits<size_type>::max();
+
+    /**
+     * @brief Blocco di memoria contiguo da cui vengono ricavati i nodi
+     */
+    struct slab {
+        node *nodes; ///< Memoria non inizializzata per capacity nodi
+        size_type capacity; ///< Numero di nodi contenuti nel blocco
+    };
+
+    /**
+     * I blocchi hanno dimensioni fisse: il primo contiene 2^first_slab_shift nodi, i successivi raddoppiano fino a
+     * 2^max_slab_shift nodi e da lì restano costanti. Così il blocco e la posizione di un nodo si ricavano dal suo
+     * indice senza cercarli.
+     */
+    static const unsigned first_slab_shift = 4;
+    static const unsigned max_slab_shift = 13; ///< Logaritmo del numero massimo di nodi di un blocco
+    static const size_type first_slab_size = size_type(1) << first_slab_shift; ///< Numero di nodi del primo blocco
+    static const size_type max_slab_size = size_type(1) << max_slab_shift; ///< Numero massimo di nodi di un blocco
+    /// Numero di blocchi di dimensione crescente, che insieme contengono max_slab_size nodi
+    static const size_type growing_slabs = max_slab_shift - first_slab_shift + 1;
+
+    node_allocator m_alloc; ///< Allocatore dei blocchi di nodi, della tabella hash e dell'elenco dei blocchi
+
+    slab *m_slabs; ///< Elenco dei blocchi allocati; i nodi occupano gli indici da 0 a m_inserted_elements - 1
+    size_type m_slab_count; ///< Numero di blocchi allocati
+    size_type m_slab_capacity; ///< Dimensione dell'array m_slabs
+
+    /**
+     * Numero di matrici che condividono nodi, tabella hash e blocchi. È allocato insieme alla prima tabella hash,
+     * quindi è nullptr solo se la matrice non ha ancora memoria; una matrice con il contatore a 1 è l'unica
+     * proprietaria e può modificare la memoria direttamente.
+     */
+    share_count *m_shared;
 
     size_type m_rows; ///< Numero di righe logiche della matrice
     size_type m_columns; ///< Numero di colonne logiche della matrice
@@ -506,6 +1701,94 @@ private:
 
     T m_default; ///< Valore di default
 
+    bool m_prune_defaults; ///< Se true i valori uguali al default non vengono memorizzati
+
+    /**
+     * Indici ordinati degli elementi, costruiti alla prima visita ordinata e svuotati da ogni inserimento di una
+     * nuova posizione e da ogni rimozione. Un vettore vuoto con la matrice non vuota indica un indice da ricostruire.
+     */
+    mutable std::vector<const node*> m_row_order; ///< Nodi in ordine di riga e colonna
+    mutable std::vector<const node*> m_column_order; ///< Nodi in ordine di colonna e riga
+
+
+#ifdef SPARSE_MATRIX_STATISTICS
+    statistics_block m_statistics; ///< Contatori della matrice
+#endif
+
+    template<typename U, typename A, typename I, typename Pred>
+    friend typename SparseMatrix<U, A, I>::size_type evaluate(const SparseMatrix<U, A, I> &M, Pred P);
+
+    template<typename U, typename A, typename I, typename Pred>
+    friend typename SparseMatrix<U, A, I>::size_type evaluate(const SparseMatrix<U, A, I> &M, Pred P,
+                                                              unsigned threads);
+
+    template<typename U, typename A, typename I, typename Pred>
+    friend struct evaluate_block;
+
+    /**
+     * @name Aggiornamento dei contatori
+     *
+     * Senza SPARSE_MATRIX_STATISTICS sono funzioni vuote, eliminate dal compilatore.
+     */
+    ///@{
+    void count_allocation() const {
+#ifdef SPARSE_MATRIX_STATISTICS
+        statistics_block::add(m_statistics.allocations, 1);
+#endif
+    }
+
+    void count_lookup(unsigned long long probes) const {
+#ifdef SPARSE_MATRIX_STATISTICS
+        statistics_block::add(m_statistics.lookups, 1);
+        statistics_block::add(m_statistics.probes, probes);
+        if(probes > m_statistics.max_probe.load(std::memory_order_relaxed)){
+            m_statistics.max_probe.store(probes, std::memory_order_relaxed);
+        }
+#else
+        (void) probes;
+#endif
+    }
+
+    void count_evaluate() const {
+#ifdef SPARSE_MATRIX_STATISTICS
+        statistics_block::add(m_statistics.evaluate_calls, 1);
+#endif
+    }
+
+    /**
+     * @brief conta gli elementi di indice compreso tra begin ed end - 1 il cui valore soddisfa P
+     *
+     * I nodi vengono letti in sequenza, un blocco alla volta, senza passare dalla tabella hash.
+     */
+    template<typename Pred>
+    size_type count_range(Pred &P, size_type begin, size_type end) const {
+        size_type count = 0;
+        while(begin < end){
+            const slab &current = m_slabs[slab_of(begin)];
+            const node *it = node_at(begin);
+            const size_type available = current.capacity - static_cast<size_type>(it - current.nodes);
+            const size_type stop = end - begin < available ? end : begin + available;
+            for(const node *last = it + (stop - begin); it != last; ++it){
+                if(P(it->data.m_value)){
+                    ++count;
+                }
+            }
+            begin = stop;
+        }
+        return count;
+    }
+
+    /**
+     * @brief collega un iteratore ai contatori della matrice, per contarne gli incrementi
+     */
+    template<typename Iterator>
+    Iterator with_statistics(Iterator it) const {
+#ifdef SPARSE_MATRIX_STATISTICS
+        it.m_statistics = &m_statistics;
+#endif
+        return it;
+    }
+    ///@}
 
     /**
      * @brief funzione di appoggio per cercare un nodo partendo dalle coordinate.
@@ -514,24 +1797,249 @@ private:
      * @return Il puntatore al nodo che contiene l'elemento (i, j) se esiste, nullptr altrimenti.
      */
     node* get_node(size_type i, size_type j) const {
-        node* temp = m_data;
-        while (temp != nullptr && (temp->data.row() != i || temp->data.column() != j)){
-            temp = temp->next;
+        if(m_table == nullptr){
+            return nullptr;
+        }
+        slot_type index = m_table[find_slot(i, j)];
+        return index == 0 ? nullptr : node_at(index - 1);
+    }
+
+    /**
+     * @brief true se gli indici da 0 a dim - 1 sono rappresentabili con index_type
+     */
+    static bool fits_index(size_type dim) {
+        return dim <= 1 || static_cast<unsigned long long>(dim - 1) <=
+                           static_cast<unsigned long long>(std::numeric_limits<index_type>::max());
+    }
+
+    /**
+     * @brief funzione hash sulla posizione di un elemento
+     *
+     * Mescola i bit di entrambi gli indici, in modo che righe o colonne consecutive finiscano in celle lontane.
+     */
+    static unsigned long long hash_position(size_type i, size_type j) {
+        unsigned long long h = static_cast<unsigned long long>(i) * 0x9E3779B97F4A7C15ULL;
+        h ^= static_cast<unsigned long long>(j) + 0x7F4A7C159E3779B9ULL + (h << 6) + (h >> 2);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    /**
+     * @brief cerca la cella della tabella hash associata alla posizione (i, j)
+     * @return l'indice della cella che contiene il nodo (i, j) se esiste, altrimenti quello della prima cella
+     * vuota incontrata, dove il nodo andrebbe inserito.
+     */
+    size_type find_slot(size_type i, size_type j) const {
+        if(m_table == nullptr){
+            return 0;
+        }
+        size_type mask = m_table_size - 1;
+        size_type slot = static_cast<size_type>(hash_position(i, j) & static_cast<unsigned long long>(mask));
+        unsigned long long probes = 1;
+        while (m_table[slot] != 0){
+            const element &current = node_at(m_table[slot] - 1)->data;
+            if(current.row() == i && current.column() == j){
+                break;
+            }
+            slot = (slot + 1) & mask;
+            ++probes;
+        }
+        count_lookup(probes);
+        return slot;
+    }
+
+    /**
+     * @brief ricostruisce la tabella hash con una nuova dimensione
+     *
+     * Se l'allocazione fallisce la tabella precedente resta intatta.
+     * @param new_size la nuova dimensione, potenza di 2 e almeno il doppio degli elementi inseriti
+     */
+    void rehash(size_type new_size){
+        if(m_shared == nullptr){
+            count_allocator count_alloc(m_alloc);
+            share_count *count = std::allocator_traits<count_allocator>::allocate(count_alloc, 1);
+            count_allocation();
+            std::allocator_traits<count_allocator>::construct(count_alloc, count, 1L);
+            m_shared = count;
+        }
+        table_allocator table_alloc(m_alloc);
+        slot_type *new_table = std::allocator_traits<table_allocator>::allocate(table_alloc, new_size);
+        count_allocation();
+        std::fill(new_table, new_table + new_size, slot_type(0));
+        free_table();
+        m_table = new_table;
+        m_table_size = new_size;
+        for(size_type k = 0; k < m_inserted_elements; ++k){
+            const element &current = node_at(k)->data;
+            m_table[find_slot(current.m_i, current.m_j)] = static_cast<slot_type>(k + 1);
+        }
+    }
+
+    /**
+     * @brief libera la tabella hash, se allocata
+     */
+    void free_table(){
+        if(m_table != nullptr){
+            table_allocator table_alloc(m_alloc);
+            std::allocator_traits<table_allocator>::deallocate(table_alloc, m_table, m_table_size);
+        }
+    }
+
+    /**
+     * @return il logaritmo in base 2 di n, arrotondato per difetto; n deve essere positivo
+     */
+    static unsigned floor_log2(size_type n) {
+#ifdef __GNUC__
+        return 63u - static_cast<unsigned>(__builtin_clzll(static_cast<unsigned long long>(n)));
+#else
+        unsigned result = 0;
+        while(n >>= 1){
+            ++result;
+        }
+        return result;
+#endif
+    }
+
+    /**
+     * @return il numero di nodi del blocco k
+     */
+    static size_type slab_capacity(size_type k) {
+        if(k == 0){
+            return first_slab_size;
+        }
+        return k < growing_slabs ? first_slab_size << (k - 1) : max_slab_size;
+    }
+
+    /**
+     * @return il blocco che contiene il nodo di indice index
+     */
+    static size_type slab_of(size_type index) {
+        if(index < first_slab_size){
+            return 0;
+        }
+        if(index < max_slab_size){
+            return floor_log2(index) - first_slab_shift + 1;
+        }
+        return growing_slabs + (index >> max_slab_shift) - 1;
+    }
+
+    /**
+     * @brief trova il nodo di indice index nei blocchi
+     *
+     * Il blocco k, per 0 < k < growing_slabs, contiene gli indici da 2^(k + first_slab_shift - 1) in poi; i
+     * blocchi successivi contengono max_slab_size indici ciascuno.
+     * @return il puntatore alla memoria del nodo, costruito o meno
+     */
+    node* node_at(size_type index) const {
+        if(index < first_slab_size){
+            return m_slabs[0].nodes + index;
+        }
+        if(index < max_slab_size){
+            unsigned top = floor_log2(index);
+            return m_slabs[top - first_slab_shift + 1].nodes + (index - (size_type(1) << top));
+        }
+        return m_slabs[growing_slabs + (index >> max_slab_shift) - 1].nodes + (index & (max_slab_size - 1));
+    }
+
+    /**
+     * @return il numero di nodi contenuti nei blocchi allocati
+     */
+    size_type node_capacity() const {
+        if(m_slab_count == 0){
+            return 0;
+        }
+        if(m_slab_count <= growing_slabs){
+            return first_slab_size << (m_slab_count - 1);
+        }
+        return max_slab_size * (m_slab_count - growing_slabs + 1);
+    }
+
+    /**
+     * @brief alloca il blocco successivo secondo la sequenza di dimensioni fissata
+     */
+    void add_slab(){
+        if(m_slab_count == m_slab_capacity){
+            size_type new_capacity = m_slab_capacity == 0 ? 8 : m_slab_capacity * 2;
+            slab_allocator list_alloc(m_alloc);
+            slab *new_slabs = std::allocator_traits<slab_allocator>::allocate(list_alloc, new_capacity);
+            count_allocation();
+            std::copy(m_slabs, m_slabs + m_slab_count, new_slabs);
+            if(m_slabs != nullptr){
+                std::allocator_traits<slab_allocator>::deallocate(list_alloc, m_slabs, m_slab_capacity);
+            }
+            m_slabs = new_slabs;
+            m_slab_capacity = new_capacity;
+        }
+        const size_type n = slab_capacity(m_slab_count);
+        m_slabs[m_slab_count].nodes = node_traits::allocate(m_alloc, n);
+        count_allocation();
+        m_slabs[m_slab_count].capacity = n;
+        ++m_slab_count;
+    }
+
+    /**
+     * @brief sposta il nodo from nella memoria libera del nodo to e aggiorna la sua cella della tabella hash
+     *
+     * Se lo spostamento lancia un'eccezione il nodo from resta al suo posto.
+     */
+    void move_node(size_type from, size_type to){
+        node *source = node_at(from);
+        size_type slot = find_slot(source->data.m_i, source->data.m_j);
+        node_traits::construct(m_alloc, node_at(to), std::move(source->data));
+        m_table[slot] = static_cast<slot_type>(to + 1);
+        node_traits::destroy(m_alloc, source);
+    }
+
+    /**
+     * @brief completa una compattazione interrotta da un'eccezione
+     *
+     * I nodi da read a count - 1 vengono spostati a partire da kept. Se uno spostamento fallisce i nodi rimanenti
+     * vengono rimossi, così la matrice resta comunque valida.
+     */
+    void close_gap(size_type kept, size_type read, size_type count) noexcept {
+        for(; read < count; ++read){
+            if(kept != read){
+                try{
+                    move_node(read, kept);
+                } catch(...){
+                    for(; read < count; ++read){
+                        node *current = node_at(read);
+                        erase_slot(find_slot(current->data.m_i, current->data.m_j));
+                        node_traits::destroy(m_alloc, current);
+                    }
+                    break;
+                }
+            }
+            ++kept;
         }
-        return temp;
+        m_inserted_elements = kept;
+        invalidate_order();
     }
 
     /**
      * @brief funzione di appoggio per il distruttore
      *
-     * Si occupa di distruggere tutti i nodi della matrice e di resettare i valori dei vari attributi.
+     * Si occupa di distruggere tutti i nodi della matrice e di resettare i valori dei vari attributi. La memoria dei
+     * nodi viene liberata un blocco alla volta; se T ha un distruttore banale i nodi non vengono nemmeno visitati.
      */
     void destroy_matrix(){
-        node* it = m_data;
-        while (it != nullptr){
-            node* temp = it;
-            it = it->next;
-            delete temp;
+        // La memoria condivisa viene liberata solo dall'ultima matrice che la usa
+        if(release_shared()){
+            if(!std::is_trivially_destructible<T>::value){
+                for(size_type k = 0; k < m_inserted_elements; ++k){
+                    node_traits::destroy(m_alloc, node_at(k));
+                }
+            }
+            for(size_type k = 0; k < m_slab_count; ++k){
+                node_traits::deallocate(m_alloc, m_slabs[k].nodes, m_slabs[k].capacity);
+            }
+            if(m_slabs != nullptr){
+                slab_allocator list_alloc(m_alloc);
+                std::allocator_traits<slab_allocator>::deallocate(list_alloc, m_slabs, m_slab_capacity);
+            }
+            free_table();
         }
 
         // Riporto uno stato coerente
@@ -539,11 +2047,204 @@ private:
         m_columns = 0;
         m_rows = 0;
         m_inserted_elements = 0;
-        m_data = nullptr;
+        m_table = nullptr;
+        m_table_size = 0;
+        m_slabs = nullptr;
+        m_slab_count = 0;
+        m_slab_capacity = 0;
+        m_shared = nullptr;
+        invalidate_order();
+    }
+
+    /**
+     * @brief rinuncia alla memoria della matrice
+     * @return true se la matrice era l'unica a usarla, e deve quindi liberarla
+     */
+    bool release_shared(){
+        if(m_shared == nullptr){
+            return true;
+        }
+        if(m_shared->fetch_sub(1, std::memory_order_acq_rel) != 1){
+            return false;
+        }
+        count_allocator count_alloc(m_alloc);
+        std::allocator_traits<count_allocator>::destroy(count_alloc, m_shared);
+        std::allocator_traits<count_allocator>::deallocate(count_alloc, m_shared, 1);
+        return true;
+    }
+
+    /**
+     * @return true se la memoria della matrice è condivisa con altre matrici
+     */
+    bool is_shared() const {
+        return m_shared != nullptr && m_shared->load(std::memory_order_acquire) > 1;
+    }
+
+    /**
+     * @brief rende la matrice l'unica proprietaria della propria memoria, da chiamare prima di ogni modifica
+     *
+     * Se la memoria è condivisa gli elementi vengono copiati in una memoria nuova, in tempo lineare; la memoria
+     * condivisa resta alle altre matrici. Se la copia fallisce la matrice resta invariata e ancora condivisa.
+     */
+    void detach(){
+        if(!is_shared()){
+            return;
+        }
+        SparseMatrix temp(m_columns, m_rows, m_default, Alloc(m_alloc));
+        temp.m_prune_defaults = m_prune_defaults;
+        temp.copy_elements(*this);
+        swap_contents(temp);
+    }
+
+    /**
+     * @brief Confronto tra nodi in ordine di riga (by_row) o di colonna, e tra un nodo e una riga o colonna
+     */
+    struct order_less {
+        bool by_row;
+
+        explicit order_less(bool by_row) : by_row(by_row) {}
+
+        size_type major(const node *n) const {
+            return by_row ? n->data.row() : n->data.column();
+        }
+
+        size_type minor(const node *n) const {
+            return by_row ? n->data.column() : n->data.row();
+        }
+
+        bool operator()(const node *a, const node *b) const {
+            return major(a) != major(b) ? major(a) < major(b) : minor(a) < minor(b);
+        }
+
+        bool operator()(const node *a, size_type key) const {
+            return major(a) < key;
+        }
+
+        bool operator()(size_type key, const node *b) const {
+            return key < major(b);
+        }
+    };
+
+    /**
+     * @brief restituisce l'indice ordinato richiesto, costruendolo se necessario
+     *
+     * Se la costruzione fallisce l'indice resta vuoto e verrà ricostruito alla visita successiva.
+     * @param by_row true per l'ordine di riga, false per quello di colonna
+     */
+    const std::vector<const node*>& ordered_index(bool by_row) const {
+        std::vector<const node*> &order = by_row ? m_row_order : m_column_order;
+        if(order.empty() && m_inserted_elements != 0){
+            std::vector<const node*> temp;
+            temp.reserve(m_inserted_elements);
+            for(size_type k = 0; k < m_inserted_elements; ++k){
+                temp.push_back(node_at(k));
+            }
+            std::sort(temp.begin(), temp.end(), order_less(by_row));
+            order.swap(temp);
+        }
+        return order;
+    }
+
+    /**
+     * @brief gli elementi della riga (by_row) o della colonna key, cercati nell'indice ordinato
+     */
+    ordered_range ordered_slice(bool by_row, size_type key) const {
+        const std::vector<const node*> &order = ordered_index(by_row);
+        std::pair<typename std::vector<const node*>::const_iterator,
+                  typename std::vector<const node*>::const_iterator> bounds =
+                std::equal_range(order.begin(), order.end(), key, order_less(by_row));
+        const node * const *base = order.data();
+        return ordered_range(with_statistics(ordered_iterator(base + (bounds.first - order.begin()))),
+                             ordered_iterator(base + (bounds.second - order.begin())));
+    }
+
+    /**
+     * @brief svuota gli indici ordinati dopo una modifica della struttura della matrice
+     */
+    void invalidate_order() {
+        m_row_order.clear();
+        m_column_order.clear();
+    }
+
+    /**
+     * @brief libera la cella slot della tabella hash (backward shift deletion)
+     *
+     * Gli elementi successivi della stessa sequenza di scansione vengono spostati indietro nel buco, finché
+     * la loro cella di partenza lo permette: la ricerca lineare non incontra mai celle vuote intermedie.
+     */
+    void erase_slot(size_type slot){
+        size_type mask = m_table_size - 1;
+        size_type hole = slot;
+        for(size_type k = (slot + 1) & mask; m_table[k] != 0; k = (k + 1) & mask){
+            const element &current = node_at(m_table[k] - 1)->data;
+            size_type home = static_cast<size_type>(hash_position(current.m_i, current.m_j) &
+                                                    static_cast<unsigned long long>(mask));
+            // L'elemento può occupare il buco solo se il buco si trova tra la sua cella di partenza e k
+            if(((k - home) & mask) >= ((k - hole) & mask)){
+                m_table[hole] = m_table[k];
+                hole = k;
+            }
+        }
+        m_table[hole] = 0;
+    }
+
+    /**
+     * @brief vero se value è uguale al valore di default; sempre falso se T non ha l'operatore ==
+     */
+    template<typename V>
+    bool is_default(const V &value, std::true_type) const {
+        return value == m_default;
+    }
+
+    template<typename V>
+    bool is_default(const V &, std::false_type) const {
+        return false;
     }
 
+    /**
+     * @brief Predicato per erase_if: l'elemento ha il valore di default
+     */
+    struct default_equal {
+        const T &value;
+
+        explicit default_equal(const T &value) : value(value) {}
+
+        bool operator()(const element &e) const {
+            return e.value() == value;
+        }
+    };
+
 };
 
+/**
+ * @brief Scambia il contenuto di due SparseMatrix in tempo costante
+ */
+template<typename T, typename Alloc, typename Index>
+void swap(SparseMatrix<T, Alloc, Index> &a, SparseMatrix<T, Alloc, Index> &b) noexcept {
+    a.swap(b);
+}
+
+template<typename T, typename Alloc, typename Index>
+const typename SparseMatrix<T, Alloc, Index>::size_type SparseMatrix<T, Alloc, Index>::min_table_size;
+
+template<typename T, typename Alloc, typename Index>
+const typename SparseMatrix<T, Alloc, Index>::size_type SparseMatrix<T, Alloc, Index>::max_elements;
+
+template<typename T, typename Alloc, typename Index>
+const unsigned SparseMatrix<T, Alloc, Index>::first_slab_shift;
+
+template<typename T, typename Alloc, typename Index>
+const unsigned SparseMatrix<T, Alloc, Index>::max_slab_shift;
+
+template<typename T, typename Alloc, typename Index>
+const typename SparseMatrix<T, Alloc, Index>::size_type SparseMatrix<T, Alloc, Index>::first_slab_size;
+
+template<typename T, typename Alloc, typename Index>
+const typename SparseMatrix<T, Alloc, Index>::size_type SparseMatrix<T, Alloc, Index>::max_slab_size;
+
+template<typename T, typename Alloc, typename Index>
+const typename SparseMatrix<T, Alloc, Index>::size_type SparseMatrix<T, Alloc, Index>::growing_slabs;
+
 
 /**
  * @brief Funzione che testa un predicato sugli elementi di una SparseMatrix.
@@ -552,15 +2253,17 @@ private:
  * passato come argomento.
  *
  * @tparam T il tipo di dato della matrice
+ * @tparam Alloc l'allocatore della matrice
  * @tparam Pred il tipo del funtore
  * @param M la matrice da visitare
  * @param P il predicato da testare
  * @return il numero di elementi inseriti nella matrice che soddisfano P
  */
-template<typename T, typename Pred>
-typename SparseMatrix<T>::size_type evaluate(const SparseMatrix<T> &M, Pred P){
-    typename SparseMatrix<T>::size_type  result = 0;
-    typename SparseMatrix<T>::const_iterator begin;
+template<typename T, typename Alloc, typename Index, typename Pred>
+typename SparseMatrix<T, Alloc, Index>::size_type evaluate(const SparseMatrix<T, Alloc, Index> &M, Pred P){
+    typename SparseMatrix<T, Alloc, Index>::size_type  result = 0;
+    typename SparseMatrix<T, Alloc, Index>::const_iterator begin;
+    M.count_evaluate();
     for(begin = M.begin(); begin != M.end(); ++begin){
         if(P(begin->value())){
             ++result;
@@ -573,10 +2276,88 @@ typename SparseMatrix<T>::size_type evaluate(const SparseMatrix<T> &M, Pred P){
     return result;
 }
 
+/**
+ * @brief Funtore che conta gli elementi di un intervallo di indici dei nodi che soddisfano un predicato
+ *
+ * Ogni thread usa la propria copia del predicato e scrive il risultato in una sola cella di memoria alla fine.
+ */
+template<typename T, typename Alloc, typename Index, typename Pred>
+struct evaluate_block {
+    const SparseMatrix<T, Alloc, Index> &M;
+    Pred P;
+    typename SparseMatrix<T, Alloc, Index>::size_type *result;
+
+    evaluate_block(const SparseMatrix<T, Alloc, Index> &M, Pred P,
+                   typename SparseMatrix<T, Alloc, Index>::size_type *result) :
+            M(M), P(P), result(result) {}
+
+    void operator()(typename SparseMatrix<T, Alloc, Index>::size_type begin,
+                    typename SparseMatrix<T, Alloc, Index>::size_type end) {
+        *result = M.count_range(P, begin, end);
+    }
+};
+
+/**
+ * @brief Versione parallela di evaluate.
+ *
+ * I nodi della matrice, che occupano gli indici da 0 a inserted_items() - 1, vengono divisi in intervalli
+ * contigui, uno per thread; ogni thread legge in sequenza i nodi del proprio intervallo con una copia del predicato
+ * e senza variabili condivise. I conteggi parziali
+ * vengono sommati alla fine, insieme al contributo del valore di default.
+ *
+ * Il predicato deve poter essere chiamato contemporaneamente da più thread sulle proprie copie.
+ *
+ * @param M la matrice da visitare
+ * @param P il predicato da testare
+ * @param threads numero di thread da usare, compreso il chiamante. Con 0 viene usato
+ * std::thread::hardware_concurrency()
+ * @return il numero di elementi logici della matrice che soddisfano P
+ */
+template<typename T, typename Alloc, typename Index, typename Pred>
+typename SparseMatrix<T, Alloc, Index>::size_type evaluate(const SparseMatrix<T, Alloc, Index> &M, Pred P,
+                                                           unsigned threads){
+    typedef typename SparseMatrix<T, Alloc, Index>::size_type size_type;
+    if(threads == 0){
+        threads = std::thread::hardware_concurrency();
+    }
+    if(threads <= 1 || M.inserted_items() < static_cast<size_type>(threads)){
+        return evaluate(M, P);
+    }
+
+    M.count_evaluate();
+    std::vector<size_type> partial(threads, 0);
+    std::vector<std::thread> workers;
+    const size_type nodes = M.inserted_items();
+    try{
+        for(unsigned t = 1; t < threads; ++t){
+            workers.push_back(std::thread(evaluate_block<T, Alloc, Index, Pred>(M, P, &partial[t]),
+                                          nodes * t / threads, nodes * (t + 1) / threads));
+        }
+    } catch(...){
+        for(std::vector<std::thread>::size_type k = 0; k < workers.size(); ++k){
+            workers[k].join();
+        }
+        throw;
+    }
+    evaluate_block<T, Alloc, Index, Pred>(M, P, &partial[0])(0, nodes / threads);
+    for(std::vector<std::thread>::size_type k = 0; k < workers.size(); ++k){
+        workers[k].join();
+    }
+
+    size_type result = 0;
+    for(unsigned t = 0; t < threads; ++t){
+        result += partial[t];
+    }
+    if(P(M.default_value())){
+        result += (M.rows() * M.columns() - M.inserted_items());
+    }
+    return result;
+}
+
 // Operatore utile per debug
-template<typename T>
-std::ostream& operator<<(std::ostream &stream, const SparseMatrix<T> &mat){
-    typename SparseMatrix<T>::const_iterator it = mat.begin();
+template<typename T, typename Alloc, typename Index>
+std::ostream& operator<<(std::ostream &stream, const SparseMatrix<T, Alloc, Index> &mat){
+    typename SparseMatrix<T, Alloc, Index>::const_iterator it = mat.begin();
     stream << "{";
     while (it != mat.end()){
         stream << "(" << it->row() << ", " << it->column() << ") -> " << it->value();
@@ -589,4 +2370,23 @@ std::ostream& operator<<(std::ostream &stream, const SparseMatrix<T> &mat){
     return stream;
 }
 
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+
+namespace pmr {
+    /**
+     * @brief SparseMatrix che prende i suoi blocchi di memoria da una std::pmr::memory_resource
+     *
+     * Disponibile solo compilando con C++17 o successivo; i test relativi sono nel target main17 del Makefile.
+     */
+    template<typename T>
+    using SparseMatrix = ::SparseMatrix<T, std::pmr::polymorphic_allocator<T>>;
+}
+#endif
 #endif
+
+// La definizione di freeze richiede CSRMatrix completa
+#include "CSRMatrix.h"
+
+#endif
\ No newline at end of file
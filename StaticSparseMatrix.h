@@ -0,0 +1,498 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ *
+ * @file StaticSparseMatrix.h
+ * @author Gabriele Canesi
+ * @brief File contenente la definizione della classe StaticSparseMatrix, matrice sparsa con dimensioni fissate a
+ * tempo di compilazione
+ */
+
+#ifndef STATIC_SPARSE_MATRIX_H
+#define STATIC_SPARSE_MATRIX_H
+#include "SparseMatrix.h"
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Il più piccolo tipo intero senza segno in grado di rappresentare il valore N
+ */
+template<unsigned long long N>
+struct smallest_unsigned {
+    typedef typename std::conditional<N <= 0xFFULL, std::uint8_t,
+            typename std::conditional<N <= 0xFFFFULL, std::uint16_t,
+            typename std::conditional<N <= 0xFFFFFFFFULL, std::uint32_t,
+                                      std::uint64_t>::type>::type>::type type;
+};
+
+/**
+ * @brief Matrice sparsa con numero di righe e di colonne fissato a tempo di compilazione.
+ *
+ * Gli elementi sono memorizzati direttamente in una tabella hash a indirizzamento aperto con scansione lineare,
+ * come due array paralleli di chiavi e valori, senza nodi né liste. La chiave di un elemento è la sua posizione
+ * lineare i * Cols + j, memorizzata nel più piccolo tipo intero che la contiene: per una matrice 1024 x 1024 una
+ * chiave occupa 4 byte, contro le due coordinate di un nodo di SparseMatrix (16 byte con gli indici long, 8 con
+ * std::uint32_t), a cui si aggiunge la sua cella nella tabella hash. Le divisioni per Cols usate per ricavare riga
+ * e colonna sono per una costante, e diventano moltiplicazioni.
+ *
+ * I metodi template get<I, J>() e set<I, J>() controllano gli indici a tempo di compilazione; operator() e set con
+ * indici runtime li controllano e lanciano matrix_out_of_bounds_exception, mentre get_unchecked e set_unchecked
+ * non fanno alcun controllo e sono da usare nei cicli in cui gli indici sono noti essere validi.
+ *
+ * @tparam T Il tipo di dato memorizzato all'interno della matrice, copiabile
+ * @tparam Rows Il numero di righe
+ * @tparam Cols Il numero di colonne
+ */
+template<typename T, long Rows, long Cols>
+class StaticSparseMatrix {
+    static_assert(Rows > 0 && Cols > 0, "Le dimensioni della matrice devono essere positive");
+    static_assert(static_cast<unsigned long long>(Rows) <=
+                  0xFFFFFFFFFFFFFFFEULL / static_cast<unsigned long long>(Cols),
+                  "Le dimensioni della matrice sono troppo grandi");
+
+public:
+
+    /**
+     * @typedef size_type
+     * @brief Lo stesso tipo usato da SparseMatrix per indici e dimensioni
+     */
+    typedef typename SparseMatrix<T>::size_type size_type;
+
+    /**
+     * @typedef index_type
+     * @brief Il più piccolo tipo senza segno che contiene gli indici di riga e di colonna
+     */
+    typedef typename smallest_unsigned<static_cast<unsigned long long>(Rows > Cols ? Rows : Cols) - 1>::type
+            index_type;
+
+    /**
+     * @typedef key_type
+     * @brief Il più piccolo tipo senza segno che contiene le posizioni lineari i * Cols + j e il marcatore di cella
+     * vuota Rows * Cols
+     */
+    typedef typename smallest_unsigned<static_cast<unsigned long long>(Rows) *
+                                       static_cast<unsigned long long>(Cols)>::type key_type;
+
+    /**
+     * @brief Vista su un elemento memorizzato nella matrice, con la stessa interfaccia di SparseMatrix::element
+     */
+    class element {
+        friend class StaticSparseMatrix;
+
+        index_type m_i; ///< Riga dell'elemento
+        index_type m_j; ///< Colonna dell'elemento
+        const T *m_value; ///< Puntatore al valore all'interno della tabella
+
+    public:
+        /**
+         * @brief Costruttore di default
+         */
+        element() : m_i(0), m_j(0), m_value(nullptr) {}
+
+        /**
+         * @brief getter per la riga dell'elemento
+         * @return valore della riga
+         */
+        size_type row() const {
+            return m_i;
+        }
+
+        /**
+         * @brief getter per la colonna dell'elemento
+         * @return valore della colonna
+         */
+        size_type column() const {
+            return m_j;
+        }
+
+        /**
+         * @brief getter per il valore effettivo
+         * @return const reference al valore
+         */
+        const T& value() const {
+            return *m_value;
+        }
+    };
+
+    /**
+     * @brief Costruttore. Istanzia una matrice vuota.
+     * @param default_value il valore di default della matrice
+     */
+    explicit StaticSparseMatrix(const T &default_value = T()) : m_inserted_elements(0), m_default(default_value) {}
+
+    /**
+     * @brief numero di righe della matrice, noto a tempo di compilazione
+     */
+    static constexpr size_type rows() {
+        return Rows;
+    }
+
+    /**
+     * @brief numero di colonne della matrice, noto a tempo di compilazione
+     */
+    static constexpr size_type columns() {
+        return Cols;
+    }
+
+    /**
+     * @brief vero se (i, j) è una posizione della matrice; utilizzabile in espressioni costanti
+     */
+    static constexpr bool in_bounds(size_type i, size_type j) {
+        return i >= 0 && i < Rows && j >= 0 && j < Cols;
+    }
+
+    /**
+     * @brief operatore per ottenere il valore alla posizione specificata
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @return il reference costante al valore se memorizzato, il valore di default altrimenti
+     * @throws matrix_out_of_bounds_exception se gli indici non rientrano nella matrice
+     */
+    const T& operator()(size_type i, size_type j) const {
+        check_bounds(i, j);
+        return get_unchecked(i, j);
+    }
+
+    /**
+     * @brief Versione di operator() con gli indici controllati a tempo di compilazione
+     */
+    template<size_type I, size_type J>
+    const T& get() const noexcept {
+        static_assert(in_bounds(I, J), "Gli indici specificati non rientrano nei limiti di dimensione della matrice");
+        return get_unchecked(I, J);
+    }
+
+    /**
+     * @brief Versione di operator() senza controllo degli indici
+     * @pre in_bounds(i, j)
+     */
+    const T& get_unchecked(size_type i, size_type j) const noexcept {
+        if(m_keys.empty()){
+            return m_default;
+        }
+        size_type slot = find_slot(key_of(i, j));
+        return m_keys[slot] == empty_key ? m_default : m_values[slot];
+    }
+
+    /**
+     * @brief Inserisce o sovrascrive il valore alla posizione specificata
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @param data il valore da inserire
+     * @throws matrix_out_of_bounds_exception se gli indici non rientrano nella matrice
+     */
+    void set(size_type i, size_type j, const T &data){
+        check_bounds(i, j);
+        set_unchecked(i, j, data);
+    }
+
+    /**
+     * @brief Versione di set con gli indici controllati a tempo di compilazione
+     */
+    template<size_type I, size_type J>
+    void set(const T &data){
+        static_assert(in_bounds(I, J), "Gli indici specificati non rientrano nei limiti di dimensione della matrice");
+        set_unchecked(I, J, data);
+    }
+
+    /**
+     * @brief Versione di set senza controllo degli indici
+     *
+     * Può comunque lanciare le eccezioni dell'allocazione e della copia di T, quando la tabella va ingrandita.
+     * @pre in_bounds(i, j)
+     */
+    void set_unchecked(size_type i, size_type j, const T &data){
+        const key_type key = key_of(i, j);
+        if(!m_keys.empty()){
+            size_type slot = find_slot(key);
+            if(m_keys[slot] != empty_key){
+                m_values[slot] = data;
+                return;
+            }
+        }
+        if((m_inserted_elements + 1) * 2 > static_cast<size_type>(m_keys.size())){
+            rehash(m_keys.empty() ? min_table_size : static_cast<size_type>(m_keys.size()) * 2);
+        }
+        size_type slot = find_slot(key);
+        m_values[slot] = data;
+        m_keys[slot] = key;
+        ++m_inserted_elements;
+    }
+
+    /**
+     * @brief Rimuove l'elemento alla posizione specificata, che torna a valere il default
+     * @return true se l'elemento era memorizzato
+     * @throws matrix_out_of_bounds_exception se gli indici non rientrano nella matrice
+     */
+    bool erase(size_type i, size_type j){
+        check_bounds(i, j);
+        if(m_keys.empty()){
+            return false;
+        }
+        size_type slot = find_slot(key_of(i, j));
+        if(m_keys[slot] == empty_key){
+            return false;
+        }
+        erase_slot(slot);
+        --m_inserted_elements;
+        return true;
+    }
+
+    /**
+     * @brief getter per il numero di elementi memorizzati
+     * @return numero di elementi memorizzati
+     */
+    size_type inserted_items() const {
+        return m_inserted_elements;
+    }
+
+    /**
+     * @brief getter per il valore di default
+     * @return const reference al valore di default
+     */
+    const T& default_value() const {
+        return m_default;
+    }
+
+    /**
+     * @brief Forward const_iterator per StaticSparseMatrix.
+     *
+     * Visita le celle occupate della tabella; l'ordine di visita non è specificato.
+     */
+    class const_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef element                   value_type;
+        typedef ptrdiff_t                 difference_type;
+        typedef const element*            pointer;
+        typedef const element&            reference;
+
+        /**
+         * @brief costruttore di default
+         */
+        const_iterator() : m_matrix(nullptr), m_slot(0) {}
+
+        /**
+         * @brief operatore di dereferenziamento
+         * @return reference all'elemento puntato dall'iteratore
+         */
+        reference operator*() const {
+            return m_current;
+        }
+
+        /**
+         * @return puntatore all'elemento puntato dall'iteratore
+         */
+        pointer operator->() const {
+            return &m_current;
+        }
+
+        /**
+         * @brief operatore di post incremento
+         * @return l'iteratore allo stato antecedente la modifica
+         */
+        const_iterator operator++(int) {
+            const_iterator temp = *this;
+            ++*this;
+            return temp;
+        }
+
+        /**
+         * @brief operatore di preincremento
+         * @return l'iteratore al nuovo elemento
+         */
+        const_iterator& operator++() {
+            ++m_slot;
+            sync();
+            return *this;
+        }
+
+        /**
+         * @param other l'iteratore da confrontare
+         * @return true se this e other puntano allo stesso elemento
+         */
+        bool operator==(const const_iterator &other) const {
+            return m_matrix == other.m_matrix && m_slot == other.m_slot;
+        }
+
+        /**
+         * @param other l'iteratore da confrontare
+         * @return false se this e other puntano allo stesso elemento
+         */
+        bool operator!=(const const_iterator &other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const StaticSparseMatrix *m_matrix; ///< La matrice visitata
+        size_type m_slot; ///< Cella corrente della tabella
+        element m_current; ///< Vista sull'elemento corrente
+
+        friend class StaticSparseMatrix;
+
+        const_iterator(const StaticSparseMatrix *matrix, size_type slot) : m_matrix(matrix), m_slot(slot) {
+            sync();
+        }
+
+        /**
+         * @brief avanza fino alla prima cella occupata e aggiorna la vista sull'elemento corrente
+         */
+        void sync() {
+            const size_type size = static_cast<size_type>(m_matrix->m_keys.size());
+            while(m_slot < size && m_matrix->m_keys[m_slot] == empty_key){
+                ++m_slot;
+            }
+            if(m_slot < size){
+                m_current.m_i = static_cast<index_type>(m_matrix->m_keys[m_slot] / Cols);
+                m_current.m_j = static_cast<index_type>(m_matrix->m_keys[m_slot] % Cols);
+                m_current.m_value = &m_matrix->m_values[m_slot];
+            }
+        }
+    };
+
+    /**
+     * @return l'iteratore costante che punta al primo elemento della matrice
+     */
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+
+    /**
+     * @return l'iteratore che rappresenta l'elemento dopo la fine della matrice
+     */
+    const_iterator end() const {
+        return const_iterator(this, static_cast<size_type>(m_keys.size()));
+    }
+
+private:
+    /// Chiave delle celle vuote, che non corrisponde a nessuna posizione
+    static const key_type empty_key = static_cast<key_type>(static_cast<unsigned long long>(Rows) *
+                                                            static_cast<unsigned long long>(Cols));
+    static const size_type min_table_size = 16; ///< Dimensione minima della tabella hash
+
+    std::vector<key_type> m_keys; ///< Chiavi delle celle della tabella, empty_key per le celle vuote
+    std::vector<T> m_values; ///< Valori delle celle della tabella, parallelo a m_keys
+    size_type m_inserted_elements; ///< Numero di elementi memorizzati
+    T m_default; ///< Valore di default
+
+    /**
+     * @brief lancia matrix_out_of_bounds_exception se (i, j) non appartiene alla matrice
+     */
+    static void check_bounds(size_type i, size_type j) {
+        if(!in_bounds(i, j)){
+            throw matrix_out_of_bounds_exception("Gli indici specificati non rientrano nei limiti di dimensione della matrice.");
+        }
+    }
+
+    /**
+     * @brief posizione lineare dell'elemento (i, j)
+     */
+    static key_type key_of(size_type i, size_type j) noexcept {
+        return static_cast<key_type>(static_cast<unsigned long long>(i) * Cols + static_cast<unsigned long long>(j));
+    }
+
+    /**
+     * @brief funzione hash sulla chiave di un elemento
+     */
+    static unsigned long long hash_key(key_type key) noexcept {
+        unsigned long long h = static_cast<unsigned long long>(key) * 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 32);
+    }
+
+    /**
+     * @brief cerca la cella della tabella associata alla chiave key
+     * @return l'indice della cella che contiene key se esiste, altrimenti quello della prima cella vuota incontrata
+     * @pre la tabella è allocata
+     */
+    size_type find_slot(key_type key) const noexcept {
+        const size_type mask = static_cast<size_type>(m_keys.size()) - 1;
+        size_type slot = static_cast<size_type>(hash_key(key) & static_cast<unsigned long long>(mask));
+        while(m_keys[slot] != empty_key && m_keys[slot] != key){
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    /**
+     * @brief ricostruisce la tabella con una nuova dimensione
+     *
+     * I valori vengono spostati nella nuova tabella, senza copiarli. Se l'allocazione fallisce la tabella
+     * precedente resta intatta; se uno spostamento lancia un'eccezione i valori già spostati vanno persi.
+     * @param new_size la nuova dimensione, potenza di 2 e almeno il doppio degli elementi inseriti
+     */
+    void rehash(size_type new_size){
+        std::vector<key_type> keys(new_size, empty_key);
+        std::vector<T> values(new_size, m_default);
+        const size_type mask = new_size - 1;
+        for(typename std::vector<key_type>::size_type k = 0; k < m_keys.size(); ++k){
+            if(m_keys[k] != empty_key){
+                size_type slot = static_cast<size_type>(hash_key(m_keys[k]) & static_cast<unsigned long long>(mask));
+                while(keys[slot] != empty_key){
+                    slot = (slot + 1) & mask;
+                }
+                keys[slot] = m_keys[k];
+                values[slot] = std::move(m_values[k]);
+            }
+        }
+        m_keys.swap(keys);
+        m_values.swap(values);
+    }
+
+    /**
+     * @brief libera la cella slot della tabella (backward shift deletion), come SparseMatrix::erase_slot
+     */
+    void erase_slot(size_type slot){
+        const size_type mask = static_cast<size_type>(m_keys.size()) - 1;
+        size_type hole = slot;
+        for(size_type k = (slot + 1) & mask; m_keys[k] != empty_key; k = (k + 1) & mask){
+            size_type home = static_cast<size_type>(hash_key(m_keys[k]) & static_cast<unsigned long long>(mask));
+            // L'elemento può occupare il buco solo se il buco si trova tra la sua cella di partenza e k
+            if(((k - home) & mask) >= ((k - hole) & mask)){
+                m_keys[hole] = m_keys[k];
+                m_values[hole] = std::move(m_values[k]);
+                hole = k;
+            }
+        }
+        m_keys[hole] = empty_key;
+        m_values[hole] = m_default;
+    }
+};
+
+template<typename T, long Rows, long Cols>
+const typename StaticSparseMatrix<T, Rows, Cols>::key_type StaticSparseMatrix<T, Rows, Cols>::empty_key;
+
+template<typename T, long Rows, long Cols>
+const typename StaticSparseMatrix<T, Rows, Cols>::size_type StaticSparseMatrix<T, Rows, Cols>::min_table_size;
+
+/**
+ * @brief Versione di evaluate per StaticSparseMatrix.
+ *
+ * @tparam T il tipo di dato della matrice
+ * @tparam Rows il numero di righe
+ * @tparam Cols il numero di colonne
+ * @tparam Pred il tipo del funtore
+ * @param M la matrice da visitare
+ * @param P il predicato da testare
+ * @return il numero di elementi logici della matrice che soddisfano P
+ */
+template<typename T, long Rows, long Cols, typename Pred>
+typename StaticSparseMatrix<T, Rows, Cols>::size_type evaluate(const StaticSparseMatrix<T, Rows, Cols> &M, Pred P){
+    typename StaticSparseMatrix<T, Rows, Cols>::size_type result = 0;
+    typename StaticSparseMatrix<T, Rows, Cols>::const_iterator it, end = M.end();
+    for(it = M.begin(); it != end; ++it){
+        if(P(it->value())){
+            ++result;
+        }
+    }
+    if(P(M.default_value())){
+        result += (Rows * Cols - M.inserted_items());
+    }
+
+    return result;
+}
+
+#endif
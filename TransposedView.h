@@ -0,0 +1,316 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ *
+ * @file TransposedView.h
+ * @author Gabriele Canesi
+ * @brief File contenente la definizione della classe TransposedView, vista in sola lettura sulla trasposta di una
+ * SparseMatrix
+ */
+
+#ifndef TRANSPOSED_VIEW_H
+#define TRANSPOSED_VIEW_H
+#include "SparseMatrix.h"
+#include <iterator>
+
+/**
+ * @brief Vista in sola lettura sulla trasposta di una SparseMatrix.
+ *
+ * Contiene solo un riferimento alla matrice di partenza: la creazione non alloca e non copia nulla. Righe e colonne
+ * sono scambiate in tutta l'interfaccia, compresi gli elementi restituiti dagli iteratori. La vista resta valida
+ * finché esiste la matrice; iteratori e riferimenti seguono le regole di invalidazione della matrice.
+ *
+ * @tparam T Il tipo di dato memorizzato all'interno della matrice
+ * @tparam Alloc L'allocatore della matrice
+ * @tparam Index Il tipo degli indici memorizzati nella matrice
+ */
+template<typename T, typename Alloc = std::allocator<T>, typename Index = long>
+class TransposedView {
+public:
+
+    /**
+     * @typedef size_type
+     * @brief Lo stesso tipo usato da SparseMatrix per indici e dimensioni
+     */
+    typedef typename SparseMatrix<T, Alloc, Index>::size_type size_type;
+
+    template<typename BaseIterator>
+    class basic_iterator;
+
+    /**
+     * @brief Vista su un elemento della matrice con riga e colonna scambiate, con la stessa interfaccia di
+     * SparseMatrix::element
+     */
+    class entry {
+        template<typename BaseIterator>
+        friend class basic_iterator;
+
+        const typename SparseMatrix<T, Alloc, Index>::element *m_element; ///< L'elemento della matrice di partenza
+
+    public:
+        /**
+         * @brief Costruttore di default
+         */
+        entry() : m_element(nullptr) {}
+
+        /**
+         * @brief getter per la riga dell'elemento, cioè la colonna nella matrice di partenza
+         */
+        size_type row() const {
+            return m_element->column();
+        }
+
+        /**
+         * @brief getter per la colonna dell'elemento, cioè la riga nella matrice di partenza
+         */
+        size_type column() const {
+            return m_element->row();
+        }
+
+        /**
+         * @brief getter per il valore effettivo
+         * @return const reference al valore, all'interno della matrice di partenza
+         */
+        const T& value() const {
+            return m_element->value();
+        }
+    };
+
+    /**
+     * @brief Forward iterator che adatta un iteratore della matrice di partenza scambiando riga e colonna
+     * @tparam BaseIterator const_iterator o ordered_iterator di SparseMatrix
+     */
+    template<typename BaseIterator>
+    class basic_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef entry                     value_type;
+        typedef ptrdiff_t                 difference_type;
+        typedef const entry*              pointer;
+        typedef const entry&              reference;
+
+        /**
+         * @brief costruttore di default
+         */
+        basic_iterator() {}
+
+        /**
+         * @brief operatore di dereferenziamento
+         * @return reference all'elemento puntato dall'iteratore
+         */
+        reference operator*() const {
+            return m_current;
+        }
+
+        /**
+         * @return puntatore all'elemento puntato dall'iteratore
+         */
+        pointer operator->() const {
+            return &m_current;
+        }
+
+        /**
+         * @brief operatore di post incremento
+         * @return l'iteratore allo stato antecedente la modifica
+         */
+        basic_iterator operator++(int) {
+            basic_iterator temp = *this;
+            ++*this;
+            return temp;
+        }
+
+        /**
+         * @brief operatore di preincremento
+         * @return l'iteratore al nuovo elemento
+         */
+        basic_iterator& operator++() {
+            ++m_it;
+            sync();
+            return *this;
+        }
+
+        /**
+         * @param other l'iteratore da confrontare
+         * @return true se this e other puntano allo stesso elemento
+         */
+        bool operator==(const basic_iterator &other) const {
+            return m_it == other.m_it;
+        }
+
+        /**
+         * @param other l'iteratore da confrontare
+         * @return false se this e other puntano allo stesso elemento
+         */
+        bool operator!=(const basic_iterator &other) const {
+            return !(*this == other);
+        }
+
+    private:
+        BaseIterator m_it; ///< Posizione nella matrice di partenza
+        BaseIterator m_end; ///< Fine della visita nella matrice di partenza
+        entry m_current; ///< Vista sull'elemento corrente
+
+        friend class TransposedView;
+
+        basic_iterator(BaseIterator it, BaseIterator end) : m_it(it), m_end(end) {
+            sync();
+        }
+
+        /**
+         * @brief aggiorna la vista sull'elemento corrente
+         */
+        void sync() {
+            if(m_it != m_end){
+                m_current.m_element = &(*m_it);
+            }
+        }
+    };
+
+    /**
+     * @typedef const_iterator
+     * @brief Iteratore sugli elementi nello stesso ordine (non specificato) della matrice di partenza
+     */
+    typedef basic_iterator<typename SparseMatrix<T, Alloc, Index>::const_iterator> const_iterator;
+
+    /**
+     * @typedef ordered_iterator
+     * @brief Iteratore sugli elementi in ordine di riga o di colonna della trasposta
+     */
+    typedef basic_iterator<typename SparseMatrix<T, Alloc, Index>::ordered_iterator> ordered_iterator;
+
+    /**
+     * @brief Costruisce la vista sulla trasposta di matrix
+     * @param matrix la matrice di partenza, che deve sopravvivere alla vista
+     */
+    explicit TransposedView(const SparseMatrix<T, Alloc, Index> &matrix) : m_matrix(&matrix) {}
+
+    /**
+     * @brief operatore per ottenere il valore alla posizione specificata della trasposta
+     * @param i indice della riga
+     * @param j indice della colonna
+     * @return il valore in (j, i) nella matrice di partenza
+     * @throws matrix_out_of_bounds_exception se gli indici non rientrano nella trasposta
+     */
+    const T& operator()(size_type i, size_type j) const {
+        return (*m_matrix)(j, i);
+    }
+
+    /**
+     * @brief getter per il numero di righe, cioè il numero di colonne della matrice di partenza
+     */
+    size_type rows() const {
+        return m_matrix->columns();
+    }
+
+    /**
+     * @brief getter per il numero di colonne, cioè il numero di righe della matrice di partenza
+     */
+    size_type columns() const {
+        return m_matrix->rows();
+    }
+
+    /**
+     * @brief getter per il numero di elementi memorizzati
+     */
+    size_type inserted_items() const {
+        return m_matrix->inserted_items();
+    }
+
+    /**
+     * @brief getter per il valore di default
+     */
+    const T& default_value() const {
+        return m_matrix->default_value();
+    }
+
+    /**
+     * @return la matrice di partenza
+     */
+    const SparseMatrix<T, Alloc, Index>& source() const {
+        return *m_matrix;
+    }
+
+    /**
+     * @brief Rappresentazione compressa per righe della trasposta
+     * @see CSRMatrix(const TransposedView<T, Alloc, Index>&)
+     */
+    CSRMatrix<T> freeze() const {
+        return CSRMatrix<T>(*this);
+    }
+
+    /**
+     * @return l'iteratore costante che punta al primo elemento
+     */
+    const_iterator begin() const {
+        return const_iterator(m_matrix->begin(), m_matrix->end());
+    }
+
+    /**
+     * @return l'iteratore che rappresenta l'elemento dopo la fine
+     */
+    const_iterator end() const {
+        return const_iterator(m_matrix->end(), m_matrix->end());
+    }
+
+    /**
+     * @brief Inizio della visita in ordine di riga della trasposta, cioè in ordine di colonna della matrice
+     * @see SparseMatrix::column_major_begin
+     */
+    ordered_iterator row_major_begin() const {
+        return ordered_iterator(m_matrix->column_major_begin(), m_matrix->column_major_end());
+    }
+
+    /**
+     * @brief Fine della visita in ordine di riga della trasposta
+     */
+    ordered_iterator row_major_end() const {
+        return ordered_iterator(m_matrix->column_major_end(), m_matrix->column_major_end());
+    }
+
+    /**
+     * @brief Inizio della visita in ordine di colonna della trasposta, cioè in ordine di riga della matrice
+     * @see SparseMatrix::row_major_begin
+     */
+    ordered_iterator column_major_begin() const {
+        return ordered_iterator(m_matrix->row_major_begin(), m_matrix->row_major_end());
+    }
+
+    /**
+     * @brief Fine della visita in ordine di colonna della trasposta
+     */
+    ordered_iterator column_major_end() const {
+        return ordered_iterator(m_matrix->row_major_end(), m_matrix->row_major_end());
+    }
+
+private:
+    const SparseMatrix<T, Alloc, Index> *m_matrix; ///< La matrice di partenza
+};
+
+/**
+ * @brief Vista sulla trasposta di una matrice, senza copie
+ * @param M la matrice da trasporre, che deve sopravvivere alla vista
+ * @return la vista sulla trasposta di M
+ */
+template<typename T, typename Alloc, typename Index>
+TransposedView<T, Alloc, Index> transpose(const SparseMatrix<T, Alloc, Index> &M){
+    return TransposedView<T, Alloc, Index>(M);
+}
+
+/**
+ * @brief Versione di evaluate per TransposedView: la trasposta ha gli stessi valori della matrice di partenza
+ *
+ * @tparam T il tipo di dato della matrice
+ * @tparam Alloc l'allocatore della matrice
+ * @tparam Index il tipo degli indici della matrice
+ * @tparam Pred il tipo del funtore
+ * @param M la vista da visitare
+ * @param P il predicato da testare
+ * @return il numero di elementi logici della trasposta che soddisfano P
+ */
+template<typename T, typename Alloc, typename Index, typename Pred>
+typename TransposedView<T, Alloc, Index>::size_type evaluate(const TransposedView<T, Alloc, Index> &M, Pred P){
+    return evaluate(M.source(), P);
+}
+
+#endif
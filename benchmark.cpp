@@ -0,0 +1,329 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ * @file benchmark.cpp
+ * @author Gabriele Canesi
+ * @brief Programma che misura i tempi delle operazioni principali di SparseMatrix.
+ *
+ * Per ogni tipo di elemento (int, double, std::string, test_class), numero di elementi (da 1e3 a 1e7, a potenze di
+ * dieci), densità e schema di accesso misura set, operator(), la visita con il const_iterator, evaluate, la copia e
+ * l'assegnamento. Gli schemi di accesso sono:
+ * - random: posizioni casuali
+ * - row_major: posizioni in ordine di riga, distribuite uniformemente sulle colonne
+ * - overwrite: le posizioni casuali vengono prima inserite, poi set le sovrascrive tutte in un ordine diverso
+ *
+ * Poiché le copie sono copy-on-write, copy e assign misurano solo la condivisione della memoria; copy_first_write
+ * e assign_first_write misurano la prima scrittura successiva, che duplica la matrice.
+ *
+ * L'output è una riga CSV (o un oggetto JSON) per ogni misura, per poter confrontare versioni diverse.
+ * Opzioni:
+ * - --format=csv|json formato dell'output, csv di default
+ * - --min-nnz=N, --max-nnz=N intervallo di elementi da misurare, 1000 e 10000000 di default
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "SparseMatrix.h"
+#include "test_class.h"
+
+/**
+ * @brief Generatore pseudo-casuale deterministico (xorshift), per avere le stesse posizioni ad ogni esecuzione
+ */
+struct xorshift{
+    unsigned long long state;
+
+    explicit xorshift(unsigned long long seed) : state(seed) {}
+
+    unsigned long long operator()(){
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+/**
+ * @brief Secondi trascorsi da start
+ */
+double seconds_since(bench_clock::time_point start){
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+/**
+ * @name Descrizione dei tipi misurati
+ *
+ * Per ogni tipo: il nome nell'output, il valore da scrivere al passo k e il predicato usato per evaluate.
+ */
+///@{
+template<typename T>
+struct bench_type;
+
+template<>
+struct bench_type<int> {
+    static const char* name() { return "int"; }
+    static int make(long k) { return static_cast<int>(k % 1000) + 1; }
+    bool operator()(const int &v) const { return v > 500; }
+};
+
+template<>
+struct bench_type<double> {
+    static const char* name() { return "double"; }
+    static double make(long k) { return static_cast<double>(k % 1000) + 0.5; }
+    bool operator()(const double &v) const { return v > 500.0; }
+};
+
+template<>
+struct bench_type<std::string> {
+    static const char* name() { return "string"; }
+    // Abbastanza lunga da non rientrare nella small string optimization
+    static std::string make(long k) { return "valore_di_prova_" + std::to_string(k); }
+    bool operator()(const std::string &v) const { return v.size() > 20; }
+};
+
+template<>
+struct bench_type<test_class> {
+    static const char* name() { return "test_class"; }
+    static test_class make(long k) { return test_class(static_cast<int>(k % 1000) + 1); }
+    bool operator()(const test_class &v) const { return v.value() > 500; }
+};
+///@}
+
+/**
+ * @brief Scrive le misure in CSV o JSON su std::cout
+ */
+class reporter {
+public:
+    explicit reporter(bool json) : m_json(json), m_first(true) {
+        if(m_json){
+            std::cout << "[" << std::endl;
+        } else {
+            std::cout << "type,pattern,target_nnz,density,rows,nnz,operation,ops,seconds,ns_per_op" << std::endl;
+        }
+    }
+
+    ~reporter(){
+        if(m_json){
+            std::cout << std::endl << "]" << std::endl;
+        }
+    }
+
+    /**
+     * @brief Scrive una misura
+     * @param ops numero di operazioni eseguite (o di elementi coinvolti) nel tempo misurato
+     */
+    void report(const char *type, const char *pattern, long target_nnz, double density, long rows, long nnz,
+                const char *operation, long ops, double seconds){
+        double ns_per_op = ops == 0 ? 0.0 : seconds * 1e9 / static_cast<double>(ops);
+        if(m_json){
+            std::cout << (m_first ? "" : ",\n") << "  {\"type\": \"" << type << "\", \"pattern\": \"" << pattern
+                      << "\", \"target_nnz\": " << target_nnz << ", \"density\": " << density << ", \"rows\": "
+                      << rows << ", \"nnz\": " << nnz << ", \"operation\": \"" << operation << "\", \"ops\": "
+                      << ops << ", \"seconds\": " << seconds << ", \"ns_per_op\": " << ns_per_op << "}";
+        } else {
+            std::cout << type << "," << pattern << "," << target_nnz << "," << density << "," << rows << "," << nnz
+                      << "," << operation << "," << ops << "," << seconds << "," << ns_per_op << std::endl;
+        }
+        std::cout.flush();
+        m_first = false;
+    }
+
+private:
+    bool m_json;
+    bool m_first;
+};
+
+/**
+ * @brief Posizioni su cui lavorano le misure, generate prima di far partire il cronometro
+ */
+struct positions {
+    std::vector<long> rows;
+    std::vector<long> columns;
+
+    void push(long i, long j){
+        rows.push_back(i);
+        columns.push_back(j);
+    }
+};
+
+/**
+ * @brief n posizioni casuali in una matrice dim x dim
+ */
+positions random_positions(long n, long dim, unsigned long long seed){
+    positions result;
+    result.rows.reserve(n);
+    result.columns.reserve(n);
+    xorshift rng(seed);
+    for(long k = 0; k < n; ++k){
+        long i = static_cast<long>(rng() % dim);
+        result.push(i, static_cast<long>(rng() % dim));
+    }
+    return result;
+}
+
+/**
+ * @brief n posizioni in ordine di riga: ceil(n / dim) elementi per riga, a distanza costante tra loro
+ */
+positions row_major_positions(long n, long dim){
+    positions result;
+    result.rows.reserve(n);
+    result.columns.reserve(n);
+    const long per_row = (n + dim - 1) / dim;
+    const long stride = dim / per_row;
+    for(long k = 0; k < n; ++k){
+        result.push(k / per_row, (k % per_row) * stride);
+    }
+    return result;
+}
+
+/**
+ * @brief Esegue tutte le misure per un tipo, un numero di elementi, una densità e uno schema di accesso
+ * @param out dove scrivere i risultati
+ * @param n numero di elementi da inserire
+ * @param density frazione delle celle occupate, da cui si ricava il lato della matrice
+ * @param pattern "random", "row_major" oppure "overwrite"
+ */
+template<typename T>
+void bench_case(reporter &out, long n, double density, const char *pattern){
+    const char *type = bench_type<T>::name();
+    const long dim = std::max(1L, static_cast<long>(std::ceil(std::sqrt(static_cast<double>(n) / density))));
+    const bool overwrite = std::strcmp(pattern, "overwrite") == 0;
+    positions writes = std::strcmp(pattern, "row_major") == 0 ? row_major_positions(n, dim) :
+                       random_positions(n, dim, static_cast<unsigned long long>(n) * 31 + dim);
+    std::vector<T> values;
+    values.reserve(n);
+    for(long k = 0; k < n; ++k){
+        values.push_back(bench_type<T>::make(k));
+    }
+
+    SparseMatrix<T> matrice(dim, dim, T());
+    bench_clock::time_point start;
+    if(overwrite){
+        // Riempimento non misurato, poi le stesse posizioni vengono riscritte in un altro ordine
+        for(long k = 0; k < n; ++k){
+            matrice.set(writes.rows[k], writes.columns[k], values[k]);
+        }
+        xorshift rng(n);
+        for(long k = n - 1; k > 0; --k){
+            long other = static_cast<long>(rng() % static_cast<unsigned long long>(k + 1));
+            std::swap(writes.rows[k], writes.rows[other]);
+            std::swap(writes.columns[k], writes.columns[other]);
+        }
+    }
+    start = bench_clock::now();
+    for(long k = 0; k < n; ++k){
+        matrice.set(writes.rows[k], writes.columns[k], values[n - 1 - k]);
+    }
+    double seconds = seconds_since(start);
+    const long nnz = matrice.inserted_items();
+    out.report(type, pattern, n, density, dim, nnz, "set", n, seconds);
+
+    long hits = 0;
+    start = bench_clock::now();
+    for(long k = 0; k < n; ++k){
+        if(&matrice(writes.rows[k], writes.columns[k]) != &matrice.default_value()){
+            ++hits;
+        }
+    }
+    seconds = seconds_since(start);
+    out.report(type, pattern, n, density, dim, nnz, "get", n, seconds);
+
+    long visited = 0;
+    start = bench_clock::now();
+    typename SparseMatrix<T>::const_iterator it, end = matrice.end();
+    for(it = matrice.begin(); it != end; ++it){
+        visited += it->row() ^ it->column();
+    }
+    seconds = seconds_since(start);
+    out.report(type, pattern, n, density, dim, nnz, "iterate", nnz, seconds);
+
+    start = bench_clock::now();
+    long matching = evaluate(matrice, bench_type<T>());
+    seconds = seconds_since(start);
+    out.report(type, pattern, n, density, dim, nnz, "evaluate", nnz, seconds);
+
+    {
+        start = bench_clock::now();
+        SparseMatrix<T> copia(matrice);
+        seconds = seconds_since(start);
+        out.report(type, pattern, n, density, dim, nnz, "copy", nnz, seconds);
+
+        start = bench_clock::now();
+        copia.set(writes.rows[0], writes.columns[0], values[0]);
+        seconds = seconds_since(start);
+        out.report(type, pattern, n, density, dim, nnz, "copy_first_write", nnz, seconds);
+    }
+
+    {
+        SparseMatrix<T> assegnata(dim, dim, T());
+        assegnata.set(0, 0, values[0]);
+        start = bench_clock::now();
+        assegnata = matrice;
+        seconds = seconds_since(start);
+        out.report(type, pattern, n, density, dim, nnz, "assign", nnz, seconds);
+
+        start = bench_clock::now();
+        assegnata.set(writes.rows[0], writes.columns[0], values[0]);
+        seconds = seconds_since(start);
+        out.report(type, pattern, n, density, dim, nnz, "assign_first_write", nnz, seconds);
+    }
+
+    // Impedisce al compilatore di eliminare le letture
+    if(hits + visited + matching == -1){
+        std::cerr << hits << std::endl;
+    }
+}
+
+/**
+ * @brief Tutte le misure per un tipo di elemento
+ */
+template<typename T>
+void bench_type_sweep(reporter &out, long min_nnz, long max_nnz){
+    const double densities[] = {1e-2, 1e-4, 1e-6};
+    const char *patterns[] = {"random", "row_major", "overwrite"};
+    for(long n = min_nnz; n <= max_nnz; n *= 10){
+        for(unsigned d = 0; d < sizeof(densities) / sizeof(densities[0]); ++d){
+            for(unsigned p = 0; p < sizeof(patterns) / sizeof(patterns[0]); ++p){
+                bench_case<T>(out, n, densities[d], patterns[p]);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv){
+    bool json = false;
+    long min_nnz = 1000, max_nnz = 10000000;
+    for(int a = 1; a < argc; ++a){
+        std::string arg = argv[a];
+        if(arg == "--format=json"){
+            json = true;
+        } else if(arg == "--format=csv"){
+            json = false;
+        } else if(arg.compare(0, 10, "--min-nnz=") == 0){
+            min_nnz = std::atol(arg.c_str() + 10);
+        } else if(arg.compare(0, 10, "--max-nnz=") == 0){
+            max_nnz = std::atol(arg.c_str() + 10);
+        } else {
+            std::cerr << "uso: " << argv[0] << " [--format=csv|json] [--min-nnz=N] [--max-nnz=N]" << std::endl;
+            return 1;
+        }
+    }
+    if(min_nnz < 1){
+        min_nnz = 1;
+    }
+
+    reporter out(json);
+    bench_type_sweep<int>(out, min_nnz, max_nnz);
+    bench_type_sweep<double>(out, min_nnz, max_nnz);
+    bench_type_sweep<std::string>(out, min_nnz, max_nnz);
+    bench_type_sweep<test_class>(out, min_nnz, max_nnz);
+    return 0;
+}
@@ -17,6 +17,23 @@
 #include <iostream>
 #include <cassert>
 #include "SparseMatrix.h"
+#include "CSCMatrix.h"
+#include "BSRMatrix.h"
+#include "StaticSparseMatrix.h"
+#include "ConcurrentSparseMatrix.h"
+#include "TransposedView.h"
+#include "AggregatedSparseMatrix.h"
+#include "MappedMatrix.h"
+#include "MatrixMarket.h"
+#include "sparse_kernels.h"
+#include <vector>
+#include <cmath>
+#include <tuple>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include "test_class.h"
 #include "sparse_matrix_exceptions.h"
 
@@ -43,6 +60,52 @@ struct stringhe_pari{
     }
 };
 
+/**
+ * @brief Funtore per int
+ *
+ * Questo funtore ritorna true se il numero passato come argomento è pari, false altrimenti.
+ */
+struct pari_int{
+    bool operator()(int n) const {
+        return n % 2 == 0;
+    }
+};
+
+/**
+ * @brief Allocatore che conta le allocazioni effettuate, usato per verificare il pool di nodi di SparseMatrix
+ */
+template<typename T>
+struct counting_allocator {
+    typedef T value_type;
+
+    long *allocations; ///< Contatore condiviso tra tutte le copie dell'allocatore
+
+    explicit counting_allocator(long *counter) : allocations(counter) {}
+
+    template<typename U>
+    counting_allocator(const counting_allocator<U> &other) : allocations(other.allocations) {}
+
+    T* allocate(std::size_t n){
+        ++*allocations;
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, std::size_t){
+        --*allocations;
+        ::operator delete(p);
+    }
+
+    template<typename U>
+    bool operator==(const counting_allocator<U> &other) const {
+        return allocations == other.allocations;
+    }
+
+    template<typename U>
+    bool operator!=(const counting_allocator<U> &other) const {
+        return allocations != other.allocations;
+    }
+};
+
 
 typedef SparseMatrix<test_class>  mat_test;
 
@@ -137,40 +200,57 @@ void test_bounds(){
 /**
  * @brief Test del costruttore di copia
  *
- * Controlla che il copy constructor di SparseMatrix non renda condivisi tra istanze i puntatori
+ * Controlla che il copy constructor di SparseMatrix condivida la memoria solo fino alla prima modifica: dopo una
+ * scrittura su una delle due istanze i valori non sono più condivisi e l'altra resta invariata.
  */
 void test_copia(){
     std::cout << "Test sul costruttore di copia: ";
     test_class default_value(-1);
     mat_test m1(10, 10, test_class(-1));
-
-    // Controllo che i dati siano separati
     m1.set(0, 0, test_class(10));
 
     mat_test m2 = m1;
-    const test_class& v1 = m1(0, 0);
-    const test_class& v2 = m2(0, 0);
 
-    // Controllo che gli indirizzi di memoria dei valori siano diversi
+    // Finché nessuna delle due viene modificata la memoria è condivisa
+    assert(&m1(0, 0) == &m2(0, 0));
+
+    // Controllo che i dati siano separati dopo una scrittura
+    m2.set(1, 1, test_class(11));
     assert(&m1(0, 0) != &m2(0, 0));
+    assert(m2(0, 0).value() == 10 && m2(1, 1).value() == 11);
+    assert(m1(1, 1).value() == -1 && m1.inserted_items() == 1);
+
+    m2.set(0, 0, test_class(20));
+    assert(m1(0, 0).value() == 10 && m2(0, 0).value() == 20);
 
     // Controllo che le dimensioni coincidano
     assert(m1.rows() == m2.rows());
     assert(m1.columns() == m2.columns());
-    assert(m1.inserted_items() == m2.inserted_items());
+    assert(m1.inserted_items() + 1 == m2.inserted_items());
 
     // Controllo che il valore di default sia stato copiato correttamente
     assert(m1.default_value().value() == m2.default_value().value());
     assert(&m1.default_value() != &m2.default_value());
 
+    // La scrittura sull'originale separa allo stesso modo le due istanze
+    mat_test m3 = m1;
+    m1.erase(0, 0);
+    assert(m3(0, 0).value() == 10 && m1(0, 0).value() == -1);
+
+    // Una copia distrutta non libera la memoria ancora usata dall'altra
+    {
+        mat_test m4 = m3;
+    }
+    assert(m3(0, 0).value() == 10);
+
     std::cout << "passato" << std::endl;
 }
 
 /**
  * @brief Test dell'operatore di assegnamento
  *
- * Controlla la correttezza dell'operatore di assegnamento, controllando che non ci siano condivisioni
- * di dati tra le istanze.
+ * Controlla la correttezza dell'operatore di assegnamento, controllando che dopo una scrittura non ci siano
+ * condivisioni di dati tra le istanze.
  */
 void test_assegnamento(){
     std::cout << "Test di assegnamento: ";
@@ -181,9 +261,19 @@ void test_assegnamento(){
 
     m2 = m1;
     assert(m2(0, 0).value() == m1(0, 0).value());
+    assert(m2.rows() == 10 && m2.columns() == 10);
 
-    // Controllo che i dati siano separati
+    // Controllo che i dati siano separati dopo una scrittura
+    m1.set(0, 0, test_class(30));
     assert(&m1(0, 0) != &m2(0, 0));
+    assert(m1(0, 0).value() == 30 && m2(0, 0).value() == 10);
+
+    // Assegnamento a una matrice che condivide già la memoria con un'altra
+    mat_test m3 = m2;
+    m3 = m1;
+    assert(m3(0, 0).value() == 30 && m2(0, 0).value() == 10);
+    m3.set(2, 2, test_class(5));
+    assert(m1(2, 2).value() == -1 && m2(2, 2).value() == -1);
 
     std::cout << "passato" << std::endl;
 }
@@ -268,6 +358,1721 @@ void test_element(){
 }
 
 
+/**
+ * @brief Test sull'accesso tramite indice hash
+ *
+ * Inserisce molti elementi, alcuni sovrascritti, e verifica che ogni posizione restituisca il valore corretto anche
+ * dopo i ridimensionamenti della tabella interna.
+ */
+void test_accesso_indicizzato(){
+    std::cout << "Test accesso indicizzato: ";
+    SparseMatrix<int> matrice(1000, 1000, -1);
+    for(int k = 0; k < 5000; ++k){
+        matrice.set(k / 5, (k * 7) % 1000, k);
+    }
+    for(int k = 0; k < 5000; k += 2){
+        matrice.set(k / 5, (k * 7) % 1000, -k);
+    }
+    assert(matrice.inserted_items() == 5000);
+    for(int k = 0; k < 5000; ++k){
+        assert(matrice(k / 5, (k * 7) % 1000) == (k % 2 == 0 ? -k : k));
+    }
+    assert(matrice(999, 998) == -1);
+
+    bool passed = false;
+    try{
+        matrice.set(1000, 0, 1);
+    } catch (matrix_out_of_bounds_exception &e){
+        passed = true;
+    }
+    assert(passed);
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Test sulla conversione in formato CSR
+ *
+ * Verifica che la matrice congelata restituisca gli stessi valori dell'originale, che visiti gli elementi in ordine
+ * di riga e colonna e che evaluate dia lo stesso risultato.
+ */
+void test_freeze(){
+    std::cout << "Test freeze: ";
+    SparseMatrix<int> matrice(5, 4, 0);
+    matrice.set(3, 2, 7);
+    matrice.set(0, 3, 1);
+    matrice.set(3, 0, 2);
+    matrice.set(1, 1, 4);
+    matrice.set(0, 0, 5);
+
+    CSRMatrix<int> csr = matrice.freeze();
+    assert(csr.rows() == 5 && csr.columns() == 4);
+    assert(csr.inserted_items() == matrice.inserted_items());
+    for(int i = 0; i < 5; ++i){
+        for(int j = 0; j < 4; ++j){
+            assert(csr(i, j) == matrice(i, j));
+        }
+    }
+
+    CSRMatrix<int>::size_type last_row = -1, last_column = -1;
+    for(CSRMatrix<int>::const_iterator it = csr.begin(); it != csr.end(); ++it){
+        assert(it->row() > last_row || (it->row() == last_row && it->column() > last_column));
+        last_row = it->row();
+        last_column = it->column();
+    }
+
+    int count = 0;
+    for(CSRMatrix<int>::const_iterator it = csr.row_begin(3); it != csr.row_end(3); ++it){
+        assert(it->row() == 3);
+        ++count;
+    }
+    assert(count == 2);
+    assert(csr.row_begin(2) == csr.row_end(2));
+
+    assert(evaluate(csr, pari_int()) == evaluate(matrice, pari_int()));
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Test sulla rappresentazione per colonne
+ *
+ * Verifica che CSCMatrix restituisca gli stessi valori della matrice di partenza e che la vista su una colonna
+ * visiti solo gli elementi di quella colonna, in ordine di riga.
+ */
+void test_csc(){
+    std::cout << "Test CSC: ";
+    SparseMatrix<int> matrice(6, 3, -1);
+    matrice.set(5, 1, 10);
+    matrice.set(0, 1, 11);
+    matrice.set(2, 0, 12);
+    matrice.set(3, 1, 13);
+    matrice.set(4, 2, 14);
+
+    CSCMatrix<int> csc(matrice);
+    assert(csc.inserted_items() == 5);
+    for(int i = 0; i < 6; ++i){
+        for(int j = 0; j < 3; ++j){
+            assert(csc(i, j) == matrice(i, j));
+        }
+    }
+
+    CSCMatrix<int>::column_range colonna = csc.column(1);
+    assert(colonna.size() == 3);
+    CSCMatrix<int>::size_type last_row = -1;
+    for(CSCMatrix<int>::const_iterator it = colonna.begin(); it != colonna.end(); ++it){
+        assert(it->column() == 1);
+        assert(it->row() > last_row);
+        assert(it->value() == matrice(it->row(), 1));
+        last_row = it->row();
+    }
+    assert(last_row == 5);
+    assert(evaluate(csc, pari_int()) == evaluate(matrice, pari_int()));
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Confronta multiply con il prodotto calcolato cella per cella tramite operator(), per ogni livello di
+ * vettorizzazione disponibile
+ * @tparam T il tipo aritmetico della matrice
+ * @param default_value il valore di default della matrice
+ */
+template<typename T>
+void controlla_spmv(T default_value){
+    const long n = 37, m = 29;
+    SparseMatrix<T> matrice(n, m, default_value);
+    for(long k = 0; k < 400; ++k){
+        matrice.set((k * 13) % n, (k * 7 + k / 5) % m, static_cast<T>(k % 11 - 5));
+    }
+    std::vector<T> x(m), y(n), atteso(n);
+    for(long j = 0; j < m; ++j){
+        x[j] = static_cast<T>(j % 5 - 2);
+    }
+    for(long i = 0; i < n; ++i){
+        atteso[i] = T();
+        for(long j = 0; j < m; ++j){
+            atteso[i] += matrice(i, j) * x[j];
+        }
+    }
+
+    CSRMatrix<T> csr = matrice.freeze();
+    simd_level levels[] = {simd_scalar, simd_avx2, simd_avx512};
+    for(int l = 0; l < 3; ++l){
+        set_simd_level(levels[l]);
+        multiply(csr, &x[0], &y[0]);
+        for(long i = 0; i < n; ++i){
+            assert(std::fabs(static_cast<double>(y[i] - atteso[i])) < 1e-3);
+        }
+    }
+    set_simd_level(detected_simd_level());
+}
+
+/**
+ * @brief Test del prodotto matrice sparsa - vettore denso
+ *
+ * Verifica il risultato per tutti i tipi con un kernel dedicato, anche con valore di default diverso da zero.
+ */
+void test_spmv(){
+    std::cout << "Test SpMV: ";
+    controlla_spmv<double>(0.0);
+    controlla_spmv<double>(1.5);
+    controlla_spmv<float>(-2.0f);
+    controlla_spmv<std::int32_t>(0);
+    controlla_spmv<std::int32_t>(3);
+    controlla_spmv<std::int64_t>(-4);
+    controlla_spmv<short>(2);
+
+    SparseMatrix<double> matrice(2, 3, 0.0);
+    matrice.set(1, 2, 2.0);
+    double x[] = {1.0, 1.0, 4.0};
+    double y[2];
+    multiply(matrice, x, y);
+    assert(y[0] == 0.0 && y[1] == 8.0);
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Test del prodotto matrice sparsa - vettore denso parallelo
+ *
+ * Su una matrice con righe di lunghezza molto diversa controlla che i blocchi di righe abbiano un costo simile e
+ * che il risultato sia identico a quello seriale.
+ */
+void test_spmv_parallelo(){
+    std::cout << "Test SpMV parallelo: ";
+    const long n = 1000;
+    SparseMatrix<std::int64_t> matrice(n, n, 1);
+    // Lunghezza delle righe con distribuzione a legge di potenza: la riga i ha circa n / (i + 1) elementi
+    for(long i = 0; i < n; ++i){
+        for(long j = 0; j < n / (i + 1); ++j){
+            matrice.set(i, (j * 31 + i) % n, static_cast<std::int64_t>(i - j));
+        }
+    }
+    CSRMatrix<std::int64_t> csr = matrice.freeze();
+
+    std::vector<long> bounds = balanced_row_partition(csr.row_pointers(), n, 4);
+    assert(bounds.size() == 5 && bounds[0] == 0 && bounds[4] == n);
+    long total = csr.inserted_items() + n;
+    for(int p = 0; p < 4; ++p){
+        long cost = csr.row_pointers()[bounds[p + 1]] - csr.row_pointers()[bounds[p]] + bounds[p + 1] - bounds[p];
+        assert(cost <= total / 4 + n);
+    }
+
+    std::vector<std::int64_t> x(n), seriale(n), parallelo(n);
+    for(long j = 0; j < n; ++j){
+        x[j] = j % 7 - 3;
+    }
+    multiply(csr, &x[0], &seriale[0]);
+    unsigned threads[] = {2, 3, 8, 0};
+    for(int t = 0; t < 4; ++t){
+        multiply(csr, &x[0], &parallelo[0], threads[t]);
+        assert(parallelo == seriale);
+    }
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Test del prodotto tra matrici sparse
+ *
+ * Confronta il risultato con il prodotto calcolato cella per cella, usando righe abbastanza piene da attivare
+ * l'accumulatore denso e righe quasi vuote che usano quello hash, sia con un thread che con più thread.
+ * Controlla inoltre che vengano rifiutate dimensioni incompatibili e valori di default diversi da zero.
+ */
+void test_spgemm(){
+    std::cout << "Test SpGEMM: ";
+    const long n = 40, k = 30, m = 500;
+    SparseMatrix<long> a(n, k, 0), b(k, m, 0);
+    for(long i = 0; i < n; ++i){
+        long elementi = (i == 3) ? k : 2;
+        for(long c = 0; c < elementi; ++c){
+            a.set(i, (i * 3 + c * 7) % k, i - c);
+        }
+    }
+    for(long i = 0; i < k; ++i){
+        for(long c = 0; c < 4; ++c){
+            b.set(i, (i * 11 + c * 13) % m, c + 1);
+        }
+    }
+
+    unsigned threads[] = {1, 3};
+    for(int t = 0; t < 2; ++t){
+        SparseMatrix<long> c = multiply(a, b, threads[t]);
+        assert(c.rows() == n && c.columns() == m);
+        for(long i = 0; i < n; ++i){
+            for(long j = 0; j < m; ++j){
+                long atteso = 0;
+                for(long h = 0; h < k; ++h){
+                    atteso += a(i, h) * b(h, j);
+                }
+                assert(c(i, j) == atteso);
+            }
+        }
+    }
+
+    bool passed = false;
+    try{
+        multiply(a, a);
+    } catch (matrix_dimension_mismatch_exception &e){
+        passed = true;
+    }
+    assert(passed);
+
+    passed = false;
+    SparseMatrix<long> d(k, m, 1);
+    try{
+        multiply(a, d);
+    } catch (unsupported_default_value_exception &e){
+        passed = true;
+    }
+    assert(passed);
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Test sull'allocazione dei nodi a blocchi
+ *
+ * Con un allocatore che conta le allocazioni ancora attive verifica che i nodi vengano presi da pochi blocchi
+ * grandi, che le copie usino lo stesso allocatore, anche quando duplicano la memoria condivisa, e che alla
+ * distruzione tutta la memoria venga restituita.
+ */
+void test_allocatore(){
+    std::cout << "Test allocatore: ";
+    long attive = 0;
+    {
+        typedef SparseMatrix<test_class, counting_allocator<test_class> > mat_contata;
+        counting_allocator<test_class> alloc(&attive);
+        mat_contata matrice(1000, 1000, test_class(-1), alloc);
+        for(int k = 0; k < 10000; ++k){
+            matrice.set(k / 10, k % 1000, test_class(k));
+        }
+        assert(matrice.inserted_items() == 10000);
+        // Blocchi di nodi, elenco dei blocchi e tabella hash: molto meno di un'allocazione per elemento
+        assert(attive > 0 && attive < 20);
+        assert(matrice(999, 990).value() == 9990);
+
+        long prima_della_copia = attive;
+        mat_contata copia = matrice;
+        assert(copia.get_allocator() == matrice.get_allocator());
+        // La copia condivide la memoria fino alla prima scrittura, che la duplica con lo stesso allocatore
+        assert(attive == prima_della_copia);
+        copia.set(0, 0, test_class(1));
+        assert(attive > prima_della_copia && attive < 2 * prima_della_copia + 5);
+        assert(copia(999, 990).value() == 9990 && matrice(0, 0).value() == 0);
+    }
+    assert(attive == 0);
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+    // Senza una risorsa a monte ogni allocazione deve venire dal buffer dell'arena, altrimenti lancia bad_alloc
+    static char buffer[1 << 21];
+    std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    pmr::SparseMatrix<int> mat_pmr(100, 100, 0, &arena);
+    for(int k = 0; k < 5000; ++k){
+        mat_pmr.set(k / 100, k % 100, k + 1);
+    }
+    for(int k = 0; k < 5000; k += 2){
+        assert(mat_pmr.erase(k / 100, k % 100));
+    }
+    assert(mat_pmr.inserted_items() == 2500 && mat_pmr(0, 1) == 2 && mat_pmr(0, 0) == 0);
+    assert(mat_pmr.get_allocator().resource() == &arena);
+
+    pmr::SparseMatrix<int> copia_pmr(mat_pmr, &arena);
+    copia_pmr.set(0, 0, 7);
+    assert(copia_pmr(0, 0) == 7 && mat_pmr(0, 0) == 0 && copia_pmr(49, 99) == 5000);
+    assert(copia_pmr.inserted_items() == 2501 && copia_pmr.get_allocator().resource() == &arena);
+    pmr::SparseMatrix<int> assegnata(1, 1, 0, &arena);
+    assegnata = copia_pmr;
+    assert(assegnata(0, 0) == 7 && assegnata.get_allocator().resource() == &arena);
+#endif
+#endif
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Funzione di appoggio per test_spostamento: costruisce e ritorna una matrice per valore
+ */
+mat_test crea_matrice(){
+    mat_test matrice(10, 10, test_class(-1));
+    matrice.set(1, 1, test_class(11));
+    matrice.set(2, 2, test_class(22));
+    return matrice;
+}
+
+/**
+ * @brief Test sulla semantica di spostamento
+ *
+ * Usa i contatori di test_class per verificare che restituire una matrice per valore, spostarla, inserirla in un
+ * std::vector, scambiarla e usare set con un temporaneo o emplace non copi nessun valore.
+ */
+void test_spostamento(){
+    std::cout << "Test spostamento: ";
+    test_class::reset_counters();
+    mat_test m1 = crea_matrice();
+    // Le uniche copie sono quelle del valore di default nel costruttore
+    assert(test_class::copy_count() == 1);
+    assert(m1(2, 2).value() == 22);
+
+    test_class::reset_counters();
+    mat_test m2(std::move(m1));
+    assert(test_class::copy_count() == 0);
+    assert(m2.inserted_items() == 2 && m2(1, 1).value() == 11);
+    assert(m1.inserted_items() == 0 && m1.rows() == 0);
+
+    std::vector<mat_test> vettore;
+    vettore.push_back(std::move(m2));
+    vettore.push_back(crea_matrice());
+    test_class::reset_counters();
+    vettore.reserve(100);
+    assert(test_class::copy_count() == 0);
+    assert(vettore[0](2, 2).value() == 22);
+
+    test_class::reset_counters();
+    mat_test m3(5, 5, test_class(0));
+    m3 = std::move(vettore[1]);
+    assert(m3.rows() == 10 && m3(1, 1).value() == 11);
+    m3.set(3, 3, test_class(33));
+    m3.set(3, 3, test_class(34));
+    assert(test_class::copy_count() == 1);
+    assert(m3(3, 3).value() == 34);
+
+    test_class::reset_counters();
+    m3.emplace(4, 4, 44);
+    assert(test_class::copy_count() == 0 && test_class::move_count() == 0);
+    assert(m3(4, 4).value() == 44);
+
+    mat_test m4(3, 3, test_class(-2));
+    test_class::reset_counters();
+    swap(m3, m4);
+    assert(test_class::copy_count() == 0);
+    assert(m3.rows() == 3 && m4(4, 4).value() == 44);
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Politica per i duplicati che tiene il valore massimo
+ */
+struct massimo{
+    int operator()(int accumulato, int nuovo) const {
+        return accumulato > nuovo ? accumulato : nuovo;
+    }
+};
+
+/**
+ * @brief Test sulla costruzione da triple
+ *
+ * Verifica la gestione dei duplicati con le diverse politiche, l'ordine di visita risultante e la garanzia forte
+ * in caso di tripla fuori dai limiti.
+ */
+void test_costruzione_da_triple(){
+    std::cout << "Test costruzione da triple: ";
+    typedef std::tuple<long, long, int> tripla;
+    std::vector<tripla> triple;
+    triple.push_back(tripla(2, 1, 5));
+    triple.push_back(tripla(0, 3, 1));
+    triple.push_back(tripla(2, 1, 7));
+    triple.push_back(tripla(1, 0, 4));
+    triple.push_back(tripla(2, 1, 6));
+
+    SparseMatrix<int> ultimo(3, 4, 0, triple.begin(), triple.end());
+    assert(ultimo.inserted_items() == 3);
+    assert(ultimo(2, 1) == 6 && ultimo(0, 3) == 1 && ultimo(1, 0) == 4);
+
+    SparseMatrix<int> somma(3, 4, 0, triple.begin(), triple.end(), sum_duplicates());
+    assert(somma(2, 1) == 18);
+
+    SparseMatrix<int> massimi(3, 4, 0, triple.begin(), triple.end(), massimo());
+    assert(massimi(2, 1) == 7);
+
+    // Gli elementi sono visitati in ordine di riga
+    SparseMatrix<int>::const_iterator it = somma.begin();
+    assert(it->row() == 0 && it->column() == 3);
+    ++it;
+    assert(it->row() == 1);
+    ++it;
+    assert(it->row() == 2);
+
+    // Anche gli element di un'altra matrice sono triple valide
+    mat_test sorgente(5, 5, test_class(0));
+    sorgente.set(4, 4, test_class(44));
+    sorgente.set(0, 1, test_class(1));
+    mat_test copia(5, 5, test_class(0), sorgente.begin(), sorgente.end());
+    assert(copia.inserted_items() == 2 && copia(4, 4).value() == 44);
+
+    // Garanzia forte: una tripla fuori dai limiti lascia la matrice invariata
+    triple.push_back(tripla(3, 0, 9));
+    bool passed = false;
+    try{
+        somma.assign(triple.begin(), triple.end(), sum_duplicates());
+    } catch(matrix_out_of_bounds_exception &e){
+        passed = true;
+    }
+    assert(passed);
+    assert(somma.inserted_items() == 3 && somma(2, 1) == 18);
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Test della versione parallela di evaluate
+ *
+ * Confronta il risultato con quello della versione seriale al variare del numero di thread.
+ */
+void test_evaluate_parallelo(){
+    std::cout << "Test evaluate parallelo: ";
+    SparseMatrix<int> matrice(300, 300, 4);
+    for(int k = 0; k < 20000; ++k){
+        matrice.set(k % 300, (k * 17) % 300, k % 7);
+    }
+    unsigned threads[] = {1, 2, 3, 7, 0};
+    for(int t = 0; t < 5; ++t){
+        assert(evaluate(matrice, pari_int(), threads[t]) == evaluate(matrice, pari_int()));
+    }
+    // Intervalli di nodi che attraversano il confine tra il primo e il secondo blocco
+    SparseMatrix<int> piccola(5, 5, 1);
+    for(int k = 0; k < 19; ++k){
+        piccola.set(k / 5, k % 5, k);
+    }
+    assert(evaluate(piccola, pari_int(), 3) == evaluate(piccola, pari_int()) && evaluate(piccola, pari_int(), 3) == 10);
+
+    SparseMatrix<std::string> stringhe(10, 10, "Ciao");
+    stringhe.set(1, 0, "Dispari");
+    assert(evaluate(stringhe, stringhe_pari(), 4) == 99);
+    std::cout << "passato" << std::endl;
+}
+
+
+/**
+ * @brief Predicato lo <= v < hi, usato come riferimento per evaluate_range
+ */
+template<typename T>
+struct nell_intervallo {
+    T lo;
+    T hi;
+
+    nell_intervallo(T lo, T hi) : lo(lo), hi(hi) {}
+
+    bool operator()(const T &v) const {
+        return lo <= v && v < hi;
+    }
+};
+
+/**
+ * @brief Predicato v op x, usato come riferimento per count_if_compare
+ */
+template<typename T>
+struct confronto {
+    compare_op op;
+    T x;
+
+    confronto(compare_op op, T x) : op(op), x(x) {}
+
+    bool operator()(const T &v) const {
+        return compare_holds(v, op, x);
+    }
+};
+
+/**
+ * @brief Confronta evaluate_range e count_if_compare con evaluate, su CSR e CSC e per ogni livello di
+ * vettorizzazione disponibile
+ * @tparam T il tipo aritmetico della matrice
+ * @param default_value il valore di default della matrice
+ */
+template<typename T>
+void controlla_conteggi(T default_value){
+    const long n = 41, m = 23;
+    SparseMatrix<T> matrice(n, m, default_value);
+    for(long k = 0; k < 600; ++k){
+        matrice.set((k * 11) % n, (k * 5 + k / 3) % m, static_cast<T>(k % 13 - 6));
+    }
+    CSRMatrix<T> csr = matrice.freeze();
+    CSCMatrix<T> csc(matrice);
+
+    T soglie[] = {static_cast<T>(-7), static_cast<T>(-2), static_cast<T>(0), static_cast<T>(3), static_cast<T>(6),
+                  std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest()};
+    compare_op ops[] = {compare_equal, compare_not_equal, compare_less, compare_less_equal, compare_greater,
+                        compare_greater_equal};
+    simd_level levels[] = {simd_scalar, simd_avx2, simd_avx512};
+    for(int l = 0; l < 3; ++l){
+        set_simd_level(levels[l]);
+        for(int a = 0; a < 7; ++a){
+            for(int o = 0; o < 6; ++o){
+                long atteso = evaluate(matrice, confronto<T>(ops[o], soglie[a]));
+                assert(count_if_compare(csr, ops[o], soglie[a]) == atteso);
+                assert(count_if_compare(csc, ops[o], soglie[a]) == atteso);
+            }
+            for(int b = 0; b < 7; ++b){
+                long atteso = evaluate(matrice, nell_intervallo<T>(soglie[a], soglie[b]));
+                assert(evaluate_range(csr, soglie[a], soglie[b]) == atteso);
+                assert(evaluate_range(csc, soglie[a], soglie[b]) == atteso);
+            }
+        }
+    }
+
+    // Il livello può cambiare mentre un altro thread esegue i kernel
+    const long minori = evaluate(matrice, confronto<T>(compare_less, soglie[2]));
+    std::thread selettore([&levels]() {
+        for(int k = 0; k < 300; ++k){
+            set_simd_level(levels[k % 3]);
+        }
+    });
+    for(int k = 0; k < 300; ++k){
+        assert(count_if_compare(csr, compare_less, soglie[2]) == minori);
+    }
+    selettore.join();
+    set_simd_level(detected_simd_level());
+}
+
+/**
+ * @brief Test di evaluate_range e count_if_compare
+ *
+ * Oltre al confronto con evaluate per tutti i tipi con un kernel dedicato, controlla che i NaN non appartengano
+ * a nessun intervallo ma risultino diversi da qualunque valore.
+ */
+void test_conteggi_vettorizzati(){
+    std::cout << "Test evaluate_range e count_if_compare: ";
+    controlla_conteggi<double>(0.0);
+    controlla_conteggi<double>(2.0);
+    controlla_conteggi<float>(-1.0f);
+    controlla_conteggi<std::int32_t>(0);
+    controlla_conteggi<std::int32_t>(5);
+    controlla_conteggi<std::int64_t>(-3);
+    controlla_conteggi<short>(1);
+
+    SparseMatrix<double> matrice(4, 5, 0.0);
+    for(long j = 0; j < 5; ++j){
+        matrice.set(0, j, std::nan(""));
+    }
+    matrice.set(1, 1, 1.0);
+    CSRMatrix<double> csr = matrice.freeze();
+    const double infinito = std::numeric_limits<double>::infinity();
+    assert(evaluate_range(csr, -infinito, infinito) == 15);
+    assert(count_if_compare(csr, compare_not_equal, 0.0) == 6);
+    assert(count_if_compare(csr, compare_greater_equal, -infinito) == 15);
+    std::cout << "passato" << std::endl;
+}
+
+
+/**
+ * @brief Test delle visite ordinate per righe e per colonne e delle viste sulle singole righe e colonne
+ *
+ * Controlla anche che l'indice ordinato venga aggiornato dopo un inserimento.
+ */
+void test_visite_ordinate(){
+    std::cout << "Test visite ordinate: ";
+    SparseMatrix<int> matrice(30, 20, 0);
+    assert(matrice.row_major_begin() == matrice.row_major_end());
+    assert(matrice.row(3).size() == 0);
+    for(int k = 0; k < 250; ++k){
+        matrice.set((k * 7) % 30, (k * 13 + k / 4) % 20, k);
+    }
+
+    long visitati = 0;
+    SparseMatrix<int>::ordered_iterator it = matrice.row_major_begin(), precedente = it;
+    for(; it != matrice.row_major_end(); precedente = it++, ++visitati){
+        assert(matrice(it->row(), it->column()) == it->value());
+        if(visitati > 0){
+            assert(precedente->row() < it->row() ||
+                   (precedente->row() == it->row() && precedente->column() < it->column()));
+        }
+    }
+    assert(visitati == matrice.inserted_items());
+
+    visitati = 0;
+    for(it = matrice.column_major_begin(); it != matrice.column_major_end(); precedente = it++, ++visitati){
+        if(visitati > 0){
+            assert(precedente->column() < it->column() ||
+                   (precedente->column() == it->column() && precedente->row() < it->row()));
+        }
+    }
+    assert(visitati == matrice.inserted_items());
+
+    long totale = 0;
+    for(long i = 0; i < matrice.rows(); ++i){
+        SparseMatrix<int>::ordered_range riga = matrice.row(i);
+        long contati = 0, colonna = -1;
+        for(SparseMatrix<int>::ordered_iterator e = riga.begin(); e != riga.end(); ++e, ++contati){
+            assert(e->row() == i && e->column() > colonna);
+            colonna = e->column();
+        }
+        assert(contati == riga.size());
+        totale += contati;
+    }
+    assert(totale == matrice.inserted_items());
+
+    // Un nuovo inserimento deve comparire nelle visite successive
+    // L'unico valore nullo memorizzato è in (0, 0), quindi nella colonna 19 conta chi è diverso da 0
+    long attesi = matrice.column(19).size() + (matrice(29, 19) == 0) + (matrice(0, 19) == 0);
+    matrice.set(29, 19, -1);
+    matrice.set(0, 19, -2);
+    SparseMatrix<int>::ordered_range colonna = matrice.column(19);
+    assert(colonna.size() == attesi);
+    assert(colonna.begin()->row() == 0 && colonna.begin()->value() == -2);
+
+    SparseMatrix<int> copia(matrice);
+    assert(copia.row(0).size() == matrice.row(0).size());
+
+    try{
+        matrice.row(30);
+        assert(false);
+    } catch (const matrix_out_of_bounds_exception &e){}
+    try{
+        matrice.column(-1);
+        assert(false);
+    } catch (const matrix_out_of_bounds_exception &e){}
+    std::cout << "passato" << std::endl;
+}
+
+
+/**
+ * @brief Predicato per erase_if: elementi della diagonale
+ */
+struct sulla_diagonale {
+    bool operator()(const SparseMatrix<int>::element &e) const {
+        return e.row() == e.column();
+    }
+};
+
+/**
+ * @brief Test di erase, erase_if, della rimozione automatica dei valori di default e di compact
+ *
+ * Una lunga sequenza di inserimenti e rimozioni viene confrontata con una matrice densa di riferimento, per
+ * controllare che la tabella hash resti coerente dopo le rimozioni.
+ */
+void test_rimozione(){
+    std::cout << "Test rimozione: ";
+    const long n = 40, m = 30;
+    SparseMatrix<int> matrice(n, m, -1);
+    std::vector<int> densa(n * m, -1);
+    for(long k = 0; k < 20000; ++k){
+        long i = (k * 7919) % n, j = (k * 104729 + k / 3) % m;
+        if(k % 3 == 0){
+            assert(matrice.erase(i, j) == (densa[i * m + j] != -1));
+            densa[i * m + j] = -1;
+        } else {
+            matrice.set(i, j, static_cast<int>(k));
+            densa[i * m + j] = static_cast<int>(k);
+        }
+    }
+    long memorizzati = 0;
+    for(long i = 0; i < n; ++i){
+        for(long j = 0; j < m; ++j){
+            assert(matrice(i, j) == densa[i * m + j]);
+            memorizzati += densa[i * m + j] != -1;
+        }
+    }
+    assert(matrice.inserted_items() == memorizzati);
+    long visitati = 0;
+    for(SparseMatrix<int>::const_iterator it = matrice.begin(); it != matrice.end(); ++it, ++visitati){
+        assert(densa[it->row() * m + it->column()] == it->value());
+    }
+    assert(visitati == memorizzati);
+
+    long diagonale = 0;
+    for(long i = 0; i < m; ++i){
+        diagonale += densa[i * m + i] != -1;
+    }
+    assert(matrice.erase_if(sulla_diagonale()) == diagonale);
+    assert(matrice.inserted_items() == memorizzati - diagonale);
+    for(long i = 0; i < m; ++i){
+        assert(matrice(i, i) == -1);
+    }
+
+    // compact: stessi valori, visita in ordine di riga
+    SparseMatrix<int> copia(matrice);
+    matrice.compact();
+    assert(matrice.inserted_items() == copia.inserted_items());
+    SparseMatrix<int>::const_iterator it = matrice.begin(), precedente = it;
+    for(++it; it != matrice.end(); ++it, ++precedente){
+        assert(precedente->row() < it->row() ||
+               (precedente->row() == it->row() && precedente->column() < it->column()));
+    }
+    for(it = copia.begin(); it != copia.end(); ++it){
+        assert(matrice(it->row(), it->column()) == it->value());
+    }
+
+    // Abbastanza elementi da riempire anche i blocchi di dimensione massima
+    SparseMatrix<int> grande(30000, 3, 0);
+    for(long k = 0; k < 30000; ++k){
+        grande.set(k, k % 3, static_cast<int>(k + 1));
+    }
+    for(long k = 0; k < 30000; k += 2){
+        assert(grande.erase(k, k % 3));
+    }
+    assert(grande.erase_if(sulla_diagonale()) == 1 && grande.inserted_items() == 14999);
+    long somma = 0;
+    visitati = 0;
+    for(SparseMatrix<int>::const_iterator g = grande.begin(); g != grande.end(); ++g, ++visitati){
+        assert(g->row() % 2 == 1 && g->value() == g->row() + 1);
+        somma += g->value();
+    }
+    assert(visitati == 14999 && somma == 15000L * 15001L - 2 && grande(29999, 2) == 30000 && grande(29998, 1) == 0);
+
+    // Rimozione automatica dei valori di default
+    SparseMatrix<int> potata(5, 5, 0);
+    potata.set(1, 1, 0);
+    potata.set(2, 2, 3);
+    assert(potata.inserted_items() == 2);
+    potata.set_prune_defaults(true);
+    assert(potata.prune_defaults() && potata.inserted_items() == 1);
+    potata.set(2, 2, 0);
+    potata.set(3, 3, 0);
+    potata.emplace(4, 4, 0);
+    assert(potata.inserted_items() == 0 && potata(2, 2) == 0);
+    std::vector<std::tuple<long, long, int> > triple;
+    triple.push_back(std::make_tuple(0L, 0L, 2));
+    triple.push_back(std::make_tuple(0L, 0L, -2));
+    triple.push_back(std::make_tuple(1L, 0L, 5));
+    potata.assign(triple.begin(), triple.end(), sum_duplicates());
+    assert(potata.inserted_items() == 1 && potata(1, 0) == 5);
+    SparseMatrix<int> copia_potata(potata);
+    copia_potata.set(1, 0, 0);
+    assert(copia_potata.prune_defaults() && copia_potata.inserted_items() == 0);
+
+    try{
+        potata.erase(5, 0);
+        assert(false);
+    } catch (const matrix_out_of_bounds_exception &e){}
+    std::cout << "passato" << std::endl;
+}
+
+
+/**
+ * @brief Sostituisce un offset di riga in un file salvato con save
+ * @param ricalcola se true aggiorna anche i checksum, come farebbe chi costruisce un file ad arte
+ */
+void altera_offset_di_riga(const char *percorso, long riga, long valore, bool ricalcola){
+    std::vector<char> contenuto;
+    {
+        std::ifstream in(percorso, std::ios::binary);
+        contenuto.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    matrix_file_header header;
+    std::memcpy(&header, &contenuto[0], sizeof(header));
+    std::memcpy(&contenuto[header.pointers_offset + riga * sizeof(long)], &valore, sizeof(valore));
+    if(ricalcola){
+        header.data_checksum = matrix_checksum(&contenuto[sizeof(header)], contenuto.size() - sizeof(header));
+        header.header_checksum = header_checksum(header);
+        std::memcpy(&contenuto[0], &header, sizeof(header));
+    }
+    std::ofstream out(percorso, std::ios::binary | std::ios::trunc);
+    out.write(&contenuto[0], contenuto.size());
+}
+
+/**
+ * @brief Test del formato binario: salvataggio, apertura tramite mappatura in memoria e controlli sull'header
+ */
+void test_file_mappato(){
+    std::cout << "Test file mappato: ";
+    const char *percorso = "test_matrice.spm";
+    SparseMatrix<double> matrice(50, 70, 0.5);
+    for(long k = 0; k < 900; ++k){
+        matrice.set((k * 17) % 50, (k * 29 + k / 7) % 70, static_cast<double>(k) / 4);
+    }
+    matrice.save(percorso);
+
+    {
+        MappedCSRMatrix<double> mappata = open_mapped<double>(percorso);
+        assert(mappata.verify());
+        assert(mappata.rows() == 50 && mappata.columns() == 70 && mappata.default_value() == 0.5);
+        assert(mappata.inserted_items() == matrice.inserted_items());
+        for(long i = 0; i < 50; ++i){
+            for(long j = 0; j < 70; ++j){
+                assert(mappata(i, j) == matrice(i, j));
+            }
+        }
+        long visitati = 0;
+        for(MappedCSRMatrix<double>::const_iterator it = mappata.begin(); it != mappata.end(); ++it, ++visitati){
+            assert(matrice(it->row(), it->column()) == it->value());
+        }
+        assert(visitati == matrice.inserted_items());
+        nell_intervallo<double> intervallo(10.0, 100.0);
+        assert(evaluate(mappata, intervallo) == evaluate(matrice, intervallo));
+        // Gli array sono allineati nel file, e quindi in memoria
+        assert(reinterpret_cast<std::size_t>(mappata.values()) % 64 == 0);
+
+        // Lo spostamento mantiene valida la mappatura
+        MappedCSRMatrix<double> spostata(std::move(mappata));
+        assert(spostata(0, 0) == matrice(0, 0));
+    }
+
+    try{
+        open_mapped<float>(percorso);
+        assert(false);
+    } catch (const matrix_file_exception &e){}
+    try{
+        open_mapped<std::int64_t>(percorso);
+        assert(false);
+    } catch (const matrix_file_exception &e){}
+    try{
+        open_mapped<double>("file_inesistente.spm");
+        assert(false);
+    } catch (const matrix_file_exception &e){}
+
+    // Un byte alterato nei dati viene rilevato da verify, uno nell'header già all'apertura
+    {
+        std::fstream file(percorso, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-1, std::ios::end);
+        file.put('\x7f');
+    }
+    assert(!open_mapped<double>(percorso).verify());
+    {
+        std::fstream file(percorso, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(40);
+        file.put('\x7f');
+    }
+    try{
+        open_mapped<double>(percorso);
+        assert(false);
+    } catch (const matrix_file_exception &e){}
+
+    // Un ultimo offset di riga incoerente viene rifiutato all'apertura, uno intermedio da verify anche se i
+    // checksum sono stati ricalcolati
+    matrice.save(percorso);
+    altera_offset_di_riga(percorso, 50, matrice.inserted_items() + 1000, true);
+    try{
+        open_mapped<double>(percorso);
+        assert(false);
+    } catch (const matrix_file_exception &e){}
+    matrice.save(percorso);
+    altera_offset_di_riga(percorso, 1, 1L << 40, true);
+    assert(!open_mapped<double>(percorso).verify());
+    std::remove(percorso);
+
+    // Matrice vuota
+    SparseMatrix<int> vuota(3, 4, 9);
+    vuota.save(percorso);
+    MappedCSRMatrix<int> mappata_vuota(percorso);
+    assert(mappata_vuota.inserted_items() == 0 && mappata_vuota(2, 3) == 9);
+    assert(mappata_vuota.begin() == mappata_vuota.end());
+    std::remove(percorso);
+    std::cout << "passato" << std::endl;
+}
+
+
+/**
+ * @brief Scrive un file di testo, usato per preparare gli input dei test di lettura
+ */
+void scrivi_file(const char *percorso, const std::string &contenuto){
+    std::ofstream file(percorso, std::ios::binary);
+    file << contenuto;
+}
+
+/**
+ * @brief Controlla che la lettura del file indicato lanci matrix_file_exception
+ */
+template<typename T>
+void controlla_file_non_valido(const char *percorso, const std::string &contenuto){
+    scrivi_file(percorso, contenuto);
+    try{
+        read_matrix_market<T>(percorso);
+        assert(false);
+    } catch (const matrix_file_exception &e){}
+}
+
+/**
+ * @brief Test della lettura e scrittura nel formato Matrix Market
+ *
+ * Verifica il giro completo scrittura - lettura nei due formati, la lettura parallela di un file abbastanza grande
+ * da essere diviso in blocchi, le varianti symmetric, skew-symmetric e pattern e il rifiuto dei file non validi.
+ */
+void test_matrix_market(){
+    std::cout << "Test Matrix Market: ";
+    const char *percorso = "test_matrice.mtx";
+
+    SparseMatrix<double> matrice(300, 200, 0.0);
+    for(long k = 0; k < 20000; ++k){
+        matrice.set((k * 37) % 300, (k * 11 + k / 13) % 200, static_cast<double>(k) / 7 - 1000);
+    }
+    write_matrix_market(matrice, percorso);
+    unsigned threads[] = {1, 4};
+    for(int t = 0; t < 2; ++t){
+        SparseMatrix<double> letta = read_matrix_market<double>(percorso, threads[t]);
+        assert(letta.rows() == 300 && letta.columns() == 200);
+        assert(letta.inserted_items() == matrice.inserted_items());
+        for(SparseMatrix<double>::const_iterator it = matrice.begin(); it != matrice.end(); ++it){
+            assert(letta(it->row(), it->column()) == it->value());
+        }
+    }
+
+    // Lettura e scrittura con indici compatti
+    typedef SparseMatrix<double, std::allocator<double>, std::uint32_t> matrice_compatta;
+    matrice_compatta compatta = read_matrix_market<double, std::allocator<double>, std::uint32_t>(percorso);
+    assert(compatta.inserted_items() == matrice.inserted_items() && compatta(7, 11) == matrice(7, 11));
+    compatta.set(299, 199, 0.25);
+    write_matrix_market(compatta, percorso);
+    assert(read_matrix_market<double>(percorso)(299, 199) == 0.25);
+
+    // Formato array, con valore di default non nullo
+    SparseMatrix<int> interi(4, 3, 7);
+    interi.set(0, 0, -1);
+    interi.set(3, 2, 0);
+    interi.set(2, 1, 12);
+    write_matrix_market(interi, percorso, market_array);
+    SparseMatrix<int> letti = read_matrix_market<int>(percorso);
+    for(long i = 0; i < 4; ++i){
+        for(long j = 0; j < 3; ++j){
+            assert(letti(i, j) == interi(i, j));
+        }
+    }
+    assert(letti.inserted_items() == 11);
+    try{
+        write_matrix_market(interi, percorso);
+        assert(false);
+    } catch (const unsupported_default_value_exception &e){}
+
+    scrivi_file(percorso, "%%MatrixMarket matrix coordinate real symmetric\n% commento\n\n3 3 3\n"
+                          "1 1 2.5\n3 1 -1e-2\n  2 3\t4  \r\n");
+    SparseMatrix<float> simmetrica = read_matrix_market<float>(percorso);
+    assert(simmetrica.inserted_items() == 5 && simmetrica(0, 2) == -1e-2f && simmetrica(2, 0) == -1e-2f);
+    assert(simmetrica(1, 2) == 4 && simmetrica(2, 1) == 4 && simmetrica(0, 0) == 2.5f);
+
+    controlla_file_non_valido<int>(percorso, "%%MatrixMarket matrix coordinate pattern general\n2 2 2\n1 2\n");
+    scrivi_file(percorso, "%%MatrixMarket matrix coordinate pattern general\n2 2 3\n1 2\n2 1\n2 1\n");
+    SparseMatrix<int> pattern = read_matrix_market<int>(percorso);
+    assert(pattern(0, 1) == 1 && pattern(1, 0) == 2 && pattern(0, 0) == 0);
+
+    scrivi_file(percorso, "%%MatrixMarket matrix array integer skew-symmetric\n3 3\n4\n0\n-6\n");
+    SparseMatrix<long> antisimmetrica = read_matrix_market<long>(percorso);
+    assert(antisimmetrica(1, 0) == 4 && antisimmetrica(0, 1) == -4 && antisimmetrica(2, 1) == -6);
+    assert(antisimmetrica(1, 2) == 6 && antisimmetrica.inserted_items() == 4);
+
+    controlla_file_non_valido<double>(percorso, "%%MatrixMarket matrix coordinate complex general\n1 1 0\n");
+    controlla_file_non_valido<double>(percorso, "%%MatrixMarket matrix coordinate real general\n2 2 1\n3 1 1.0\n");
+    controlla_file_non_valido<double>(percorso, "%%MatrixMarket matrix coordinate real general\n2 2 1\n1 1 x\n");
+    controlla_file_non_valido<int>(percorso, "%%MatrixMarket matrix coordinate real general\n2 2 1\n1 1 1.5\n");
+    controlla_file_non_valido<int>(percorso, "matrice\n2 2 0\n");
+    // Dimensioni il cui prodotto non è rappresentabile con long
+    controlla_file_non_valido<int>(percorso, "%%MatrixMarket matrix array integer general\n"
+                                             "4000000000 4000000000\n1\n");
+    controlla_file_non_valido<int>(percorso, "%%MatrixMarket matrix array integer symmetric\n"
+                                             "4294967296 4294967296\n1\n");
+    controlla_file_non_valido<int>(percorso, "%%MatrixMarket matrix array integer skew-symmetric\n"
+                                             "5000000000 5000000000\n1\n");
+    std::remove(percorso);
+    std::cout << "passato" << std::endl;
+}
+
+
+/**
+ * @brief Controlla BSRMatrix con blocchi di lato B su una matrice a blocchi densi con dimensioni non multiple di B
+ *
+ * @tparam T il tipo aritmetico della matrice
+ * @tparam B il lato dei blocchi
+ * @param default_value il valore di default della matrice
+ */
+template<typename T, int B>
+void controlla_bsr(T default_value){
+    const long n = 4 * B + 1, m = 3 * B + 2;
+    SparseMatrix<T> matrice(n, m, default_value);
+    // Blocchi densi sulla diagonale di blocchi e qualche elemento isolato, anche nei blocchi di bordo
+    for(long b = 0; b * B < n && b * B < m; ++b){
+        for(long i = b * B; i < (b + 1) * B && i < n; ++i){
+            for(long j = b * B; j < (b + 1) * B && j < m; ++j){
+                matrice.set(i, j, static_cast<T>((i + 2 * j) % 7 - 3));
+            }
+        }
+    }
+    matrice.set(n - 1, m - 1, static_cast<T>(5));
+    matrice.set(0, m - 1, static_cast<T>(-2));
+
+    BSRMatrix<T, B> bsr(matrice);
+    assert(bsr.rows() == n && bsr.columns() == m && bsr.inserted_items() == matrice.inserted_items());
+    assert(bsr.block_rows() == (n + B - 1) / B && bsr.block_columns() == (m + B - 1) / B);
+    for(long i = 0; i < n; ++i){
+        for(long j = 0; j < m; ++j){
+            assert(bsr(i, j) == matrice(i, j));
+        }
+    }
+
+    std::vector<T> x(m), y(n), y_parallelo(n), atteso(n);
+    for(long j = 0; j < m; ++j){
+        x[j] = static_cast<T>(j % 5 - 2);
+    }
+    for(long i = 0; i < n; ++i){
+        atteso[i] = T();
+        for(long j = 0; j < m; ++j){
+            atteso[i] += matrice(i, j) * x[j];
+        }
+    }
+    multiply(bsr, &x[0], &y[0]);
+    multiply(bsr, &x[0], &y_parallelo[0], 3);
+    for(long i = 0; i < n; ++i){
+        assert(std::fabs(static_cast<double>(y[i] - atteso[i])) < 1e-3);
+        assert(y_parallelo[i] == y[i]);
+    }
+}
+
+/**
+ * @brief Test di BSRMatrix
+ *
+ * Verifica i valori e il prodotto per un vettore con diversi lati dei blocchi, anche con valore di default diverso
+ * da zero, e che un'intera riga di blocchi vuota non venga memorizzata.
+ */
+void test_bsr(){
+    std::cout << "Test BSR: ";
+    controlla_bsr<double, 3>(0.0);
+    controlla_bsr<double, 4>(1.5);
+    controlla_bsr<float, 2>(-1.0f);
+    controlla_bsr<int, 3>(2);
+    controlla_bsr<long, 1>(0);
+
+    SparseMatrix<double> matrice(8, 8, 0.0);
+    matrice.set(0, 0, 1.0);
+    matrice.set(1, 1, 2.0);
+    matrice.set(7, 4, 3.0);
+    BSRMatrix<double, 4> bsr(matrice);
+    assert(bsr.stored_blocks() == 2 && bsr.row_pointers()[1] == 1 && bsr.column_indices()[1] == 1);
+    assert(bsr(1, 1) == 2.0 && bsr(1, 0) == 0.0 && bsr(7, 4) == 3.0 && bsr(4, 0) == 0.0);
+    try{
+        bsr(8, 0);
+        assert(false);
+    } catch(matrix_out_of_bounds_exception &){}
+
+    BSRMatrix<double, 4> vuota;
+    assert(vuota.rows() == 0 && vuota.stored_blocks() == 0);
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Test di StaticSparseMatrix
+ *
+ * Verifica i tipi degli indici scelti in base alle dimensioni, gli accessi con indici controllati a tempo di
+ * compilazione, a runtime e senza controllo, la rimozione con la tabella piena di collisioni e evaluate.
+ */
+void test_matrice_statica(){
+    std::cout << "Test matrice statica: ";
+    static_assert(sizeof(StaticSparseMatrix<double, 16, 16>::key_type) == 2, "chiave di 2 byte");
+    static_assert(sizeof(StaticSparseMatrix<double, 15, 17>::key_type) == 1, "chiave di 1 byte");
+    static_assert(sizeof(StaticSparseMatrix<double, 1024, 1024>::key_type) == 4, "chiave di 4 byte");
+    static_assert(sizeof(StaticSparseMatrix<double, 1024, 1024>::index_type) == 2, "indici di 2 byte");
+    static_assert(StaticSparseMatrix<int, 4, 3>::in_bounds(3, 2) && !StaticSparseMatrix<int, 4, 3>::in_bounds(3, 3),
+                  "in_bounds deve essere valutabile a tempo di compilazione");
+
+    const long n = 1024;
+    StaticSparseMatrix<double, n, n> matrice(-1.0);
+    assert(matrice.rows() == n && matrice.columns() == n && matrice.inserted_items() == 0);
+    assert((matrice.get<5, 7>()) == -1.0);
+    matrice.set<5, 7>(3.5);
+    matrice.set<n - 1, n - 1>(4.0);
+    assert((matrice.get<5, 7>()) == 3.5 && matrice(n - 1, n - 1) == 4.0);
+
+    for(long k = 0; k < 5000; ++k){
+        matrice.set_unchecked(k % n, (k / n * 37 + k * 101) % n, static_cast<double>(k));
+    }
+    for(long k = 0; k < 5000; ++k){
+        assert(matrice.get_unchecked(k % n, (k / n * 37 + k * 101) % n) == static_cast<double>(k));
+    }
+    long inseriti = matrice.inserted_items();
+    long visitati = 0;
+    for(StaticSparseMatrix<double, n, n>::const_iterator it = matrice.begin(); it != matrice.end(); ++it){
+        assert(matrice(it->row(), it->column()) == it->value());
+        ++visitati;
+    }
+    assert(visitati == inseriti);
+
+    // Rimuove metà degli elementi: gli altri devono restare raggiungibili
+    for(long k = 0; k < 5000; k += 2){
+        matrice.erase(k % n, (k / n * 37 + k * 101) % n);
+    }
+    for(long k = 1; k < 5000; k += 2){
+        assert(matrice(k % n, (k / n * 37 + k * 101) % n) == static_cast<double>(k));
+    }
+    assert(matrice(0, 0) == -1.0 && !matrice.erase(0, 0));
+
+    StaticSparseMatrix<double, n, n> copia = matrice;
+    copia.set(1, 1, 9.0);
+    assert(copia(1, 1) == 9.0 && matrice(1, 1) == -1.0);
+    assert(evaluate(matrice, nell_intervallo<double>(-1.0, -0.5)) == n * n - matrice.inserted_items());
+
+    // L'ingrandimento della tabella sposta i valori memorizzati invece di copiarli
+    StaticSparseMatrix<test_class, 8, 8> oggetti(test_class(0));
+    for(long k = 0; k < 8; ++k){
+        oggetti.set(k, k, test_class(static_cast<int>(k)));
+    }
+    test_class::reset_counters();
+    oggetti.set(0, 1, test_class(100));
+    assert(test_class::move_count() == 8);
+    for(long k = 0; k < 8; ++k){
+        assert(oggetti(k, k).value() == k);
+    }
+
+    try{
+        matrice.set(n, 0, 1.0);
+        assert(false);
+    } catch(matrix_out_of_bounds_exception &){}
+    try{
+        matrice(0, -1);
+        assert(false);
+    } catch(matrix_out_of_bounds_exception &){}
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Funtore eseguito da un thread produttore in test_matrice_concorrente
+ *
+ * Il produttore p scrive le righe p, p + producers, p + 2 * producers, ..., metà con set e metà con un'unica
+ * chiamata a insert_or_assign su un buffer locale.
+ */
+template<typename Matrice>
+struct produttore_generico {
+    Matrice *matrice;
+    long p;
+    long producers;
+
+    produttore_generico(Matrice *matrice, long p, long producers) : matrice(matrice), p(p), producers(producers) {}
+
+    void operator()() const {
+        std::vector<std::tuple<long, long, long> > buffer;
+        for(long i = p; i < matrice->rows(); i += producers){
+            for(long j = 0; j < matrice->columns(); j += 3){
+                if(j % 2 == 0){
+                    matrice->set(i, j, i * 1000 + j);
+                } else {
+                    buffer.push_back(std::make_tuple(i, j, i * 1000 + j));
+                }
+            }
+        }
+        matrice->insert_or_assign(buffer.begin(), buffer.end());
+    }
+};
+
+typedef produttore_generico<ConcurrentSparseMatrix<long> > produttore;
+typedef produttore_generico<ConcurrentSparseMatrix<long, std::allocator<long>, std::uint32_t> > produttore_compatto;
+
+/**
+ * @brief Test di ConcurrentSparseMatrix
+ *
+ * Più produttori scrivono contemporaneamente righe diverse; la copia ottenuta con snapshot deve contenere
+ * esattamente tutti gli elementi scritti.
+ */
+void test_matrice_concorrente(){
+    std::cout << "Test matrice concorrente: ";
+    const long n = 200, m = 90, producers = 4;
+    ConcurrentSparseMatrix<long> matrice(n, m, -1, 16);
+    assert(matrice.shard_count() == 16);
+
+    std::vector<std::thread> threads;
+    for(long p = 1; p < producers; ++p){
+        threads.push_back(std::thread(produttore(&matrice, p, producers)));
+    }
+    produttore(&matrice, 0, producers)();
+    for(std::vector<std::thread>::size_type k = 0; k < threads.size(); ++k){
+        threads[k].join();
+    }
+
+    assert(matrice.inserted_items() == n * (m / 3));
+    SparseMatrix<long> copia = matrice.snapshot();
+    assert(copia.rows() == n && copia.columns() == m && copia.default_value() == -1);
+    assert(copia.inserted_items() == n * (m / 3));
+    for(long i = 0; i < n; ++i){
+        for(long j = 0; j < m; ++j){
+            assert(copia(i, j) == (j % 3 == 0 ? i * 1000 + j : -1));
+        }
+    }
+
+    // Gli shard possono usare indici compatti
+    ConcurrentSparseMatrix<long, std::allocator<long>, std::uint32_t> compatta(n, m, -1, 4);
+    produttore_compatto(&compatta, 0, 1)();
+    SparseMatrix<long, std::allocator<long>, std::uint32_t> copia_compatta = compatta.snapshot();
+    assert(copia_compatta.inserted_items() == copia.inserted_items() && copia_compatta(n - 1, 0) == copia(n - 1, 0));
+
+    assert(!matrice.insert_or_assign(0, 0, 7) && matrice.get(0, 0) == 7);
+    assert(matrice.insert_or_assign(0, 1, 8) && matrice.get(0, 1) == 8);
+    assert(matrice.erase(0, 1) && matrice.get(0, 1) == -1);
+    assert(copia(0, 0) == 0);
+
+    std::vector<std::tuple<long, long, long> > fuori;
+    fuori.push_back(std::make_tuple(1L, 1L, 5L));
+    fuori.push_back(std::make_tuple(n, 0L, 5L));
+    try{
+        matrice.insert_or_assign(fuori.begin(), fuori.end());
+        assert(false);
+    } catch(matrix_out_of_bounds_exception &){}
+    assert(matrice.get(1, 1) == -1);
+    try{
+        matrice.set(-1, 0, 1);
+        assert(false);
+    } catch(matrix_out_of_bounds_exception &){}
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Test della vista trasposta
+ *
+ * Controlla dimensioni, valori, iteratori e visite ordinate della vista, che non deve copiare la matrice, e i
+ * prodotti A^T x, A^T A e A A^T confrontati con quelli calcolati cella per cella.
+ */
+void test_trasposta(){
+    std::cout << "Test trasposta: ";
+    const long n = 23, m = 17;
+    SparseMatrix<long> matrice(n, m, 2);
+    for(long k = 0; k < 120; ++k){
+        matrice.set((k * 7) % n, (k * 5 + k / 9) % m, k % 13 - 6);
+    }
+
+    TransposedView<long> trasposta = transpose(matrice);
+    assert(trasposta.rows() == m && trasposta.columns() == n);
+    assert(trasposta.inserted_items() == matrice.inserted_items() && trasposta.default_value() == 2);
+    for(long i = 0; i < m; ++i){
+        for(long j = 0; j < n; ++j){
+            assert(&trasposta(i, j) == &matrice(j, i));
+        }
+    }
+
+    long visitati = 0;
+    for(TransposedView<long>::const_iterator it = trasposta.begin(); it != trasposta.end(); ++it){
+        assert(&it->value() == &matrice(it->column(), it->row()));
+        ++visitati;
+    }
+    assert(visitati == matrice.inserted_items());
+
+    long ultima_riga = -1, ultima_colonna = -1;
+    for(TransposedView<long>::ordered_iterator it = trasposta.row_major_begin(); it != trasposta.row_major_end();
+        ++it){
+        assert(it->row() > ultima_riga || (it->row() == ultima_riga && it->column() > ultima_colonna));
+        ultima_riga = it->row();
+        ultima_colonna = it->column();
+    }
+    assert(evaluate(trasposta, nell_intervallo<long>(2, 3)) == evaluate(matrice, nell_intervallo<long>(2, 3)));
+
+    std::vector<long> x(n), y(m);
+    for(long i = 0; i < n; ++i){
+        x[i] = i % 4 - 1;
+    }
+    multiply(trasposta, &x[0], &y[0]);
+    for(long j = 0; j < m; ++j){
+        long atteso = 0;
+        for(long i = 0; i < n; ++i){
+            atteso += matrice(i, j) * x[i];
+        }
+        assert(y[j] == atteso);
+    }
+
+    CSRMatrix<long> csr = trasposta.freeze();
+    assert(csr.rows() == m && csr.columns() == n && csr.inserted_items() == matrice.inserted_items());
+    for(long i = 0; i < m; ++i){
+        for(long j = 0; j < n; ++j){
+            assert(csr(i, j) == matrice(j, i));
+        }
+    }
+
+    SparseMatrix<long> a(n, m, 0);
+    for(long k = 0; k < 60; ++k){
+        a.set((k * 3) % n, (k * 11) % m, k % 7 - 3);
+    }
+    SparseMatrix<long> ata = multiply(transpose(a), a);
+    SparseMatrix<long> aat = multiply(a, transpose(a));
+    assert(ata.rows() == m && ata.columns() == m && aat.rows() == n && aat.columns() == n);
+    for(long i = 0; i < m; ++i){
+        for(long j = 0; j < m; ++j){
+            long atteso = 0;
+            for(long h = 0; h < n; ++h){
+                atteso += a(h, i) * a(h, j);
+            }
+            assert(ata(i, j) == atteso);
+        }
+    }
+    for(long i = 0; i < n; ++i){
+        for(long j = 0; j < n; ++j){
+            long atteso = 0;
+            for(long h = 0; h < m; ++h){
+                atteso += a(i, h) * a(j, h);
+            }
+            assert(aat(i, j) == atteso);
+        }
+    }
+
+    // Le stesse operazioni con indici compatti
+    typedef SparseMatrix<long, std::allocator<long>, std::uint32_t> matrice_compatta;
+    matrice_compatta compatta(n, m, 0);
+    for(long k = 0; k < 60; ++k){
+        compatta.set((k * 3) % n, (k * 11) % m, k % 7 - 3);
+    }
+    TransposedView<long, std::allocator<long>, std::uint32_t> trasposta_compatta = transpose(compatta);
+    assert(trasposta_compatta(2, 5) == a(5, 2) && trasposta_compatta.freeze().inserted_items() == a.inserted_items());
+    std::vector<long> y_compatta(m);
+    multiply(trasposta_compatta, &x[0], &y_compatta[0]);
+    multiply(transpose(a), &x[0], &y[0]);
+    assert(y_compatta == y);
+    SparseMatrix<long> ata_compatta = multiply(trasposta_compatta, compatta);
+    SparseMatrix<long> aat_compatta = multiply(compatta, trasposta_compatta);
+    for(SparseMatrix<long>::const_iterator it = ata.begin(); it != ata.end(); ++it){
+        assert(ata_compatta(it->row(), it->column()) == it->value());
+    }
+    assert(ata_compatta.inserted_items() == ata.inserted_items());
+    assert(aat_compatta.inserted_items() == aat.inserted_items());
+    assert(evaluate(trasposta_compatta, nell_intervallo<long>(1, 3)) == evaluate(a, nell_intervallo<long>(1, 3)));
+
+    try{
+        multiply(transpose(a), SparseMatrix<long>(m, 3, 0));
+        assert(false);
+    } catch(matrix_dimension_mismatch_exception &){}
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Test delle operazioni elemento per elemento
+ *
+ * Confronta somma, differenza, prodotto di Hadamard e prodotto per scalare con i valori calcolati cella per cella,
+ * con valori di default diversi da zero, e controlla che le posizioni uguali al default non vengano memorizzate.
+ */
+void test_aritmetica(){
+    std::cout << "Test aritmetica: ";
+    const long n = 19, m = 27;
+    SparseMatrix<long> a(n, m, 1), b(n, m, -2);
+    for(long k = 0; k < 150; ++k){
+        a.set((k * 5) % n, (k * 7 + k / 11) % m, k % 9 - 4);
+        b.set((k * 3 + 1) % n, (k * 13) % m, k % 5 - 2);
+    }
+
+    SparseMatrix<long> somma = a + b, differenza = a - b, hadamard_ab = hadamard(a, b);
+    SparseMatrix<long> destra = a * 3L, sinistra = -2L * b;
+    assert(somma.default_value() == -1 && differenza.default_value() == 3 && hadamard_ab.default_value() == -2);
+    assert(destra.default_value() == 3 && sinistra.default_value() == 4);
+    for(long i = 0; i < n; ++i){
+        for(long j = 0; j < m; ++j){
+            assert(somma(i, j) == a(i, j) + b(i, j));
+            assert(differenza(i, j) == a(i, j) - b(i, j));
+            assert(hadamard_ab(i, j) == a(i, j) * b(i, j));
+            assert(destra(i, j) == a(i, j) * 3);
+            assert(sinistra(i, j) == -2 * b(i, j));
+        }
+    }
+    SparseMatrix<long>::const_iterator it;
+    for(it = somma.begin(); it != somma.end(); ++it){
+        assert(it->value() != somma.default_value());
+    }
+
+    // I due operandi possono essere la stessa matrice; il risultato non memorizza nulla
+    SparseMatrix<long> zero = a - a;
+    assert(zero.inserted_items() == 0 && zero.default_value() == 0);
+    assert((a * 0L).inserted_items() == 0);
+
+    SparseMatrix<double> c(4, 4, 0.0), d(4, 4, 0.0);
+    c.set(0, 0, 2.0);
+    c.set(1, 2, 3.0);
+    d.set(1, 2, 0.5);
+    d.set(3, 3, 4.0);
+    SparseMatrix<double> prodotto = hadamard(c, d);
+    assert(prodotto.inserted_items() == 1 && prodotto(1, 2) == 1.5);
+    assert((c + d).inserted_items() == 3 && (c * 2.0)(1, 2) == 6.0);
+
+    try{
+        a + SparseMatrix<long>(n, m + 1, 0);
+        assert(false);
+    } catch(matrix_dimension_mismatch_exception &){}
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Predicato che lancia un'eccezione quando *armato è true, usato per controllare la sicurezza rispetto alle
+ * eccezioni di AggregatedSparseMatrix
+ */
+struct predicato_esplosivo {
+    const bool *armato;
+
+    explicit predicato_esplosivo(const bool *armato) : armato(armato) {}
+
+    bool operator()(const long &v) const {
+        if(*armato){
+            throw std::runtime_error("predicato esploso");
+        }
+        return v > 0;
+    }
+};
+
+/**
+ * @brief Controlla che conteggi, somme e predicati di matrice coincidano con quelli ricalcolati da capo
+ */
+void controlla_aggregati(const AggregatedSparseMatrix<long> &matrice, AggregatedSparseMatrix<long>::predicate_id id,
+                         long lo, long hi){
+    AggregatedSparseMatrix<long> ricalcolata(matrice.matrix());
+    AggregatedSparseMatrix<long>::predicate_id nuovo = ricalcolata.register_predicate(nell_intervallo<long>(lo, hi));
+    for(long i = 0; i < matrice.rows(); ++i){
+        assert(matrice.row_nnz(i) == ricalcolata.row_nnz(i) && matrice.row_sum(i) == ricalcolata.row_sum(i));
+    }
+    for(long j = 0; j < matrice.columns(); ++j){
+        assert(matrice.column_nnz(j) == ricalcolata.column_nnz(j));
+        assert(matrice.column_sum(j) == ricalcolata.column_sum(j));
+    }
+    assert(matrice.evaluate(id) == ricalcolata.evaluate(nuovo));
+}
+
+/**
+ * @brief Predicato per erase_if di AggregatedSparseMatrix: elementi nelle righe pari
+ */
+struct riga_pari {
+    bool operator()(const AggregatedSparseMatrix<long>::element &e) const {
+        return e.row() % 2 == 0;
+    }
+};
+
+/**
+ * @brief Test degli aggregati mantenuti da AggregatedSparseMatrix
+ *
+ * Dopo una serie di inserimenti, sovrascritture e rimozioni confronta conteggi, somme e predicati registrati con
+ * quelli calcolati visitando la matrice.
+ */
+void test_aggregati(){
+    std::cout << "Test aggregati: ";
+    const long n = 13, m = 21;
+    SparseMatrix<long> iniziale(n, m, 2);
+    iniziale.set(0, 0, 5);
+    iniziale.set(4, 7, -3);
+
+    AggregatedSparseMatrix<long> matrice(iniziale);
+    AggregatedSparseMatrix<long>::predicate_id positivi = matrice.register_predicate(nell_intervallo<long>(1, 100));
+    for(long k = 0; k < 300; ++k){
+        matrice.set((k * 7) % n, (k * 11 + k / 5) % m, k % 17 - 8);
+        if(k % 4 == 0){
+            matrice.erase((k * 3) % n, (k * 5) % m);
+        }
+    }
+    AggregatedSparseMatrix<long>::predicate_id negativi = matrice.register_predicate(nell_intervallo<long>(-100, 0));
+    matrice.set(1, 1, -7);
+    matrice.erase(0, 0);
+    assert(matrice.predicate_count() == 2);
+
+    for(long i = 0; i < n; ++i){
+        long nnz = 0, somma = 0;
+        for(long j = 0; j < m; ++j){
+            somma += matrice(i, j);
+        }
+        SparseMatrix<long>::ordered_range riga = matrice.matrix().row(i);
+        for(SparseMatrix<long>::ordered_iterator it = riga.begin(); it != riga.end(); ++it){
+            ++nnz;
+        }
+        assert(matrice.row_nnz(i) == nnz && matrice.row_sum(i) == somma);
+    }
+    for(long j = 0; j < m; ++j){
+        long nnz = 0, somma = 0;
+        for(long i = 0; i < n; ++i){
+            somma += matrice(i, j);
+        }
+        SparseMatrix<long>::ordered_range colonna = matrice.matrix().column(j);
+        for(SparseMatrix<long>::ordered_iterator it = colonna.begin(); it != colonna.end(); ++it){
+            ++nnz;
+        }
+        assert(matrice.column_nnz(j) == nnz && matrice.column_sum(j) == somma);
+    }
+    assert(matrice.evaluate(positivi) == evaluate(matrice.matrix(), nell_intervallo<long>(1, 100)));
+    assert(matrice.evaluate(negativi) == evaluate(matrice.matrix(), nell_intervallo<long>(-100, 0)));
+
+    // Un predicato che lancia un'eccezione non deve lasciare né la matrice né gli aggregati a metà
+    bool armato = false;
+    matrice.register_predicate(predicato_esplosivo(&armato));
+    matrice.set(2, 3, 9);
+    armato = true;
+    try{
+        matrice.set(2, 3, 4);
+        assert(false);
+    } catch(std::runtime_error &){}
+    try{
+        matrice.set(5, 6, 4);
+        assert(false);
+    } catch(std::runtime_error &){}
+    try{
+        matrice.erase(2, 3);
+        assert(false);
+    } catch(std::runtime_error &){}
+    assert(matrice(2, 3) == 9 && &matrice(5, 6) == &matrice.default_value());
+    controlla_aggregati(matrice, positivi, 1, 100);
+    armato = false;
+    matrice.erase(2, 3);
+    controlla_aggregati(matrice, positivi, 1, 100);
+
+    // erase_if e assign aggiornano gli aggregati; assign fallito li lascia invariati
+    long rimossi = matrice.erase_if(riga_pari());
+    assert(rimossi > 0 && matrice.row_nnz(0) == 0 && matrice.row_nnz(2) == 0);
+    controlla_aggregati(matrice, positivi, 1, 100);
+    typedef std::tuple<long, long, long> tripla;
+    std::vector<tripla> triple;
+    triple.push_back(tripla(3, 4, 6));
+    triple.push_back(tripla(7, 2, -5));
+    triple.push_back(tripla(3, 4, 8));
+    matrice.assign(triple.begin(), triple.end(), sum_duplicates());
+    assert(matrice.inserted_items() == 2 && matrice(3, 4) == 14 && matrice.row_sum(3) == 14 + 2 * (m - 1));
+    controlla_aggregati(matrice, positivi, 1, 100);
+    triple.push_back(tripla(n, 0, 1));
+    try{
+        matrice.assign(triple.begin(), triple.end());
+        assert(false);
+    } catch(matrix_out_of_bounds_exception &){}
+    assert(matrice.inserted_items() == 2 && matrice(3, 4) == 14);
+    controlla_aggregati(matrice, positivi, 1, 100);
+    matrice.reserve(100);
+    long visitati = 0;
+    for(AggregatedSparseMatrix<long>::const_iterator it = matrice.begin(); it != matrice.end(); ++it){
+        visitati += it->value();
+    }
+    assert(visitati == 14 - 5);
+
+    // Anche le matrici con indici compatti possono essere aggregate
+    SparseMatrix<long, std::allocator<long>, std::int32_t> compatta(n, m, 0);
+    compatta.set(1, 2, 3);
+    AggregatedSparseMatrix<long, std::allocator<long>, std::int32_t> compatta_aggregata(compatta);
+    compatta_aggregata.set(1, 5, 4);
+    assert(compatta_aggregata.row_nnz(1) == 2 && compatta_aggregata.row_sum(1) == 7);
+
+    // Con T non aritmetico vengono mantenuti solo conteggi e predicati
+    AggregatedSparseMatrix<std::string> stringhe(3, 3, "");
+    stringhe.set(0, 1, "a");
+    stringhe.set(2, 1, "b");
+    stringhe.set(2, 1, "c");
+    assert(stringhe.column_nnz(1) == 2 && stringhe.row_nnz(2) == 1 && stringhe.row_nnz(1) == 0);
+
+    try{
+        matrice.row_nnz(n);
+        assert(false);
+    } catch(matrix_out_of_bounds_exception &){}
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Test di memory_usage e dei contatori di statistics
+ *
+ * I contatori vengono controllati solo compilando con SPARSE_MATRIX_STATISTICS; altrimenti devono restare a zero.
+ */
+void test_memoria_statistiche(){
+    std::cout << "Test memoria e statistiche: ";
+    SparseMatrix<double> matrice(1000, 1000, 0.0);
+    sparse_matrix_memory vuota = matrice.memory_usage();
+    assert(vuota.index == 0 && vuota.values == 0 && vuota.total() == sizeof(matrice));
+
+    for(long k = 0; k < 500; ++k){
+        matrice.set(k, (k * 7) % 1000, 1.0 + k);
+    }
+    sparse_matrix_memory piena = matrice.memory_usage();
+    assert(piena.values == 500 * sizeof(double));
+    assert(piena.index >= static_cast<std::size_t>(matrice.bucket_count()) * sizeof(std::size_t));
+    assert(piena.overhead > 0 && piena.total() > vuota.total());
+
+    // L'indice ordinato viene contato dopo la prima visita ordinata
+    long visitati = 0;
+    for(SparseMatrix<double>::ordered_iterator it = matrice.row_major_begin(); it != matrice.row_major_end(); ++it){
+        ++visitati;
+    }
+    assert(visitati == 500 && matrice.memory_usage().index == piena.index + 500 * sizeof(void*));
+
+    // reserve usa i nodi liberati da erase e la parte inutilizzata dei blocchi precedenti
+    SparseMatrix<double> diretta(1000, 1000, 0.0), a_passi(1000, 1000, 0.0);
+    diretta.reserve(200);
+    a_passi.reserve(100);
+    for(long k = 0; k < 200; ++k){
+        diretta.set(k, k, 1.0);
+        a_passi.set(k, k, 1.0);
+        if(k == 9){
+            a_passi.reserve(200);
+        }
+    }
+    assert(diretta.memory_usage().total() == a_passi.memory_usage().total());
+    for(long k = 0; k < 100; ++k){
+        diretta.erase(k, k);
+    }
+    std::size_t prima = diretta.memory_usage().total();
+    diretta.reserve(200);
+    assert(diretta.memory_usage().total() == prima);
+
+    matrice.reset_statistics();
+    for(long k = 0; k < 500; ++k){
+        assert(matrice(k, (k * 7) % 1000) == 1.0 + k);
+    }
+    // Anche i post-incrementi vengono contati
+    long passi = 0;
+    SparseMatrix<double>::const_iterator it;
+    for(it = matrice.begin(); it != matrice.end(); it++){
+        ++passi;
+    }
+    for(SparseMatrix<double>::ordered_iterator ot = matrice.row_major_begin(); ot != matrice.row_major_end(); ot++){
+        ++passi;
+    }
+    assert(passi == 1000);
+    evaluate(matrice, nell_intervallo<double>(0.0, 100.0));
+    sparse_matrix_statistics statistiche = matrice.statistics();
+#ifdef SPARSE_MATRIX_STATISTICS
+    assert(statistiche.lookups == 500 && statistiche.probes >= 500);
+    assert(statistiche.max_probe >= 1 && statistiche.max_probe <= statistiche.probes);
+    assert(statistiche.iterator_steps == 1500 && statistiche.evaluate_calls == 1);
+    assert(statistiche.allocations == 0);
+    SparseMatrix<double> copia(matrice);
+    assert(copia.statistics().lookups == 0);
+#else
+    assert(statistiche.lookups == 0 && statistiche.iterator_steps == 0 && statistiche.evaluate_calls == 0);
+#endif
+    std::cout << "passato" << std::endl;
+}
+
+/**
+ * @brief Test delle matrici con indici compatti
+ *
+ * Una matrice con indici a 32 bit deve comportarsi come quella con indici long, occupare meno memoria per
+ * elemento e rifiutare le dimensioni che il tipo degli indici non può rappresentare.
+ */
+void test_indici_compatti(){
+    std::cout << "Test indici compatti: ";
+    typedef SparseMatrix<double, std::allocator<double>, std::uint32_t> matrice_compatta;
+    const long n = 70000, m = 50;
+    matrice_compatta compatta(n, m, -1.0);
+    SparseMatrix<double> normale(n, m, -1.0);
+    for(long k = 0; k < 2000; ++k){
+        compatta.set((k * 7919) % n, k % m, 0.5 * k);
+        normale.set((k * 7919) % n, k % m, 0.5 * k);
+    }
+    assert(compatta.inserted_items() == normale.inserted_items());
+    for(long k = 0; k < 2000; ++k){
+        assert(compatta((k * 7919) % n, k % m) == normale((k * 7919) % n, k % m));
+    }
+    assert(compatta(n - 1, m - 1) == -1.0 && &compatta(n - 1, m - 1) == &compatta.default_value());
+    // Nodo da 16 byte e al più 4 celle da 4 byte della tabella hash per elemento, più i blocchi non ancora pieni
+    assert(compatta.memory_usage().total() < 28 * static_cast<std::size_t>(compatta.inserted_items()));
+    // Le celle della tabella hash sono a 32 bit solo con gli indici compatti
+    assert(compatta.bucket_count() == normale.bucket_count() &&
+           compatta.memory_usage().index * 2 == normale.memory_usage().index);
+
+    matrice_compatta::ordered_range riga = compatta.row(7919);
+    for(matrice_compatta::ordered_iterator it = riga.begin(); it != riga.end(); ++it){
+        assert(it->row() == 7919 && it->value() == normale(it->row(), it->column()));
+    }
+    assert(evaluate(compatta, nell_intervallo<double>(0.0, 100.0)) ==
+           evaluate(normale, nell_intervallo<double>(0.0, 100.0)));
+
+    CSRMatrix<double> csr_compatta = compatta.freeze(), csr_normale = normale.freeze();
+    assert(csr_compatta.inserted_items() == csr_normale.inserted_items());
+    for(long k = 0; k < csr_normale.inserted_items(); ++k){
+        assert(csr_compatta.column_indices()[k] == csr_normale.column_indices()[k]);
+        assert(csr_compatta.values()[k] == csr_normale.values()[k]);
+    }
+
+    matrice_compatta copia(compatta);
+    copia.set(0, 0, 42.0);
+    assert(copia(0, 0) == 42.0 && compatta(0, 0) == normale(0, 0));
+
+    // I kernel accettano direttamente le matrici con indici compatti
+    matrice_compatta somma = compatta + copia, differenza = copia - compatta, prodotto = hadamard(compatta, copia);
+    matrice_compatta doppia = 2.0 * compatta, scalata = compatta * 0.5;
+    assert(somma(0, 0) == 42.0 + compatta(0, 0) && differenza(0, 0) == 42.0 - compatta(0, 0));
+    assert(prodotto(0, 0) == 42.0 * compatta(0, 0) && doppia(0, 0) == 2.0 * compatta(0, 0));
+    assert(scalata(0, 0) == 0.5 * compatta(0, 0));
+    std::vector<double> x(m, 1.0), y_compatta(n), y_normale(n);
+    multiply(compatta, &x[0], &y_compatta[0]);
+    multiply(normale, &x[0], &y_normale[0], 2);
+    assert(y_compatta == y_normale);
+    matrice_compatta sinistra(3, 4, 0.0), destra(4, 2, 0.0);
+    sinistra.set(0, 1, 2.0);
+    sinistra.set(2, 3, 3.0);
+    destra.set(1, 0, 5.0);
+    destra.set(3, 1, 7.0);
+    SparseMatrix<double> prodotto_matrici = multiply(sinistra, destra);
+    assert(prodotto_matrici(0, 0) == 10.0 && prodotto_matrici(2, 1) == 21.0 && prodotto_matrici.inserted_items() == 2);
+
+    // Stessi blocchi di nodi, ma ogni nodo occupa 8 byte in meno
+    assert(compatta.memory_usage().overhead < normale.memory_usage().overhead);
+
+    try{
+        SparseMatrix<int, std::allocator<int>, std::uint16_t> troppo_grande(65537, 2, 0);
+        assert(false);
+    } catch(invalid_matrix_dimension_exception &){}
+    SparseMatrix<int, std::allocator<int>, std::uint16_t> al_limite(65536, 2, 0);
+    al_limite.set(65535, 1, 3);
+    assert(al_limite(65535, 1) == 3 && al_limite.begin()->row() == 65535);
+    std::cout << "passato" << std::endl;
+}
 
 int main(int argc, char* argv[]) {
     test_default();
@@ -280,6 +2085,29 @@ int main(int argc, char* argv[]) {
     test_dimensione_massima();
     test_iteratori();
     test_element();
+    test_accesso_indicizzato();
+    test_freeze();
+    test_csc();
+    test_spmv();
+    test_spmv_parallelo();
+    test_spgemm();
+    test_allocatore();
+    test_spostamento();
+    test_costruzione_da_triple();
+    test_evaluate_parallelo();
+    test_conteggi_vettorizzati();
+    test_visite_ordinate();
+    test_rimozione();
+    test_file_mappato();
+    test_matrix_market();
+    test_bsr();
+    test_matrice_statica();
+    test_matrice_concorrente();
+    test_trasposta();
+    test_aritmetica();
+    test_aggregati();
+    test_memoria_statistiche();
+    test_indici_compatti();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,207 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ * @file mapped_file.cpp
+ * @author Gabriele Canesi
+ * @brief File che contiene le implementazioni dichiarate in mapped_file.h
+ *
+ * La mappatura usa le chiamate POSIX (open, fstat, mmap); sugli altri sistemi il costruttore di mapped_file lancia
+ * sempre un'eccezione.
+ */
+
+#include "mapped_file.h"
+#include "sparse_matrix_exceptions.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+std::uint64_t matrix_checksum(const void *data, std::size_t size, std::uint64_t seed){
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t hash = seed;
+    for(std::size_t k = 0; k < size; ++k){
+        hash ^= bytes[k];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+std::uint64_t header_checksum(const matrix_file_header &header){
+    return matrix_checksum(&header, offsetof(matrix_file_header, header_checksum));
+}
+
+/**
+ * @brief vero se la sezione [offset, offset + length) è allineata e contenuta in un file di dimensione size
+ */
+static bool section_fits(std::uint64_t offset, std::uint64_t length, std::uint64_t size){
+    return offset % matrix_file_alignment == 0 && offset <= size && length <= size - offset;
+}
+
+const matrix_file_header& check_matrix_header(const void *data, std::size_t size){
+    if(size < sizeof(matrix_file_header)){
+        throw matrix_file_exception("File troppo piccolo per contenere una matrice");
+    }
+    const matrix_file_header &header = *static_cast<const matrix_file_header*>(data);
+    if(std::memcmp(header.magic, "SPMATRIX", sizeof(header.magic)) != 0){
+        throw matrix_file_exception("Il file non contiene una matrice sparsa");
+    }
+    if(header.version != matrix_file_version){
+        throw matrix_file_exception("Versione del formato non supportata");
+    }
+    if(header.header_checksum != header_checksum(header)){
+        throw matrix_file_exception("Header della matrice danneggiato");
+    }
+    if(header.file_size != size){
+        throw matrix_file_exception("Dimensione del file diversa da quella dichiarata nell'header");
+    }
+    if(header.rows < 0 || header.columns < 0 || header.nnz < 0 || header.index_size == 0){
+        throw matrix_file_exception("Dimensioni della matrice non valide");
+    }
+
+    const std::uint64_t rows = static_cast<std::uint64_t>(header.rows);
+    const std::uint64_t nnz = static_cast<std::uint64_t>(header.nnz);
+    const std::uint64_t limit = size;
+    if(rows + 1 > limit / header.index_size || nnz > limit / header.index_size ||
+       (header.value_size != 0 && nnz > limit / header.value_size)){
+        throw matrix_file_exception("Dimensioni della matrice non compatibili con il file");
+    }
+    if(!section_fits(header.default_offset, header.value_size, limit) ||
+       !section_fits(header.pointers_offset, (rows + 1) * header.index_size, limit) ||
+       !section_fits(header.indices_offset, nnz * header.index_size, limit) ||
+       !section_fits(header.values_offset, nnz * header.value_size, limit)){
+        throw matrix_file_exception("Sezioni della matrice fuori dal file");
+    }
+    return header;
+}
+
+
+matrix_file_writer::matrix_file_writer(const std::string &path) : m_path(path), m_temp_path(path + ".tmp"),
+                                                                  m_out(m_temp_path.c_str(),
+                                                                        std::ios::binary | std::ios::trunc),
+                                                                  m_position(0),
+                                                                  m_checksum(matrix_checksum(nullptr, 0)),
+                                                                  m_finished(false) {
+    if(!m_out){
+        throw matrix_file_exception("Impossibile creare il file " + m_temp_path);
+    }
+    matrix_file_header empty;
+    std::memset(&empty, 0, sizeof(empty));
+    m_out.write(reinterpret_cast<const char*>(&empty), sizeof(empty));
+    m_position = sizeof(empty);
+}
+
+void matrix_file_writer::write_section(std::uint64_t offset, const void *data, std::size_t size){
+    static const char zeros[matrix_file_alignment] = {};
+    while(m_position < offset){
+        std::size_t padding = static_cast<std::size_t>(std::min<std::uint64_t>(offset - m_position,
+                                                                               matrix_file_alignment));
+        m_out.write(zeros, padding);
+        m_checksum = matrix_checksum(zeros, padding, m_checksum);
+        m_position += padding;
+    }
+    if(size != 0){
+        m_out.write(static_cast<const char*>(data), size);
+        m_checksum = matrix_checksum(data, size, m_checksum);
+        m_position += size;
+    }
+}
+
+void matrix_file_writer::finish(matrix_file_header &header){
+    header.file_size = m_position;
+    header.data_checksum = m_checksum;
+    header.header_checksum = header_checksum(header);
+    m_out.seekp(0);
+    m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_out.close();
+    if(!m_out){
+        std::remove(m_temp_path.c_str());
+        throw matrix_file_exception("Errore durante la scrittura del file " + m_temp_path);
+    }
+    if(std::rename(m_temp_path.c_str(), m_path.c_str()) != 0){
+        std::remove(m_temp_path.c_str());
+        throw matrix_file_exception("Impossibile sostituire il file " + m_path);
+    }
+    m_finished = true;
+}
+
+matrix_file_writer::~matrix_file_writer(){
+    if(!m_finished){
+        m_out.close();
+        std::remove(m_temp_path.c_str());
+    }
+}
+
+
+mapped_file::mapped_file() : m_data(nullptr), m_size(0) {}
+
+#ifdef MAPPED_FILE_POSIX
+
+mapped_file::mapped_file(const std::string &path) : m_data(nullptr), m_size(0) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        throw matrix_file_exception("Impossibile aprire il file " + path);
+    }
+    struct stat info;
+    if(::fstat(fd, &info) != 0 || info.st_size <= 0){
+        ::close(fd);
+        throw matrix_file_exception("Impossibile leggere la dimensione del file " + path);
+    }
+    void *address = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // Il descrittore non serve più: la mappatura resta valida fino a munmap
+    ::close(fd);
+    if(address == MAP_FAILED){
+        throw matrix_file_exception("Impossibile mappare in memoria il file " + path);
+    }
+    m_data = static_cast<const unsigned char*>(address);
+    m_size = static_cast<std::size_t>(info.st_size);
+}
+
+void mapped_file::unmap(){
+    if(m_data != nullptr){
+        ::munmap(const_cast<unsigned char*>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+
+#else
+
+mapped_file::mapped_file(const std::string &path) : m_data(nullptr), m_size(0) {
+    throw matrix_file_exception("Mappatura in memoria non supportata su questo sistema: " + path);
+}
+
+void mapped_file::unmap(){
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#endif
+
+mapped_file::mapped_file(mapped_file &&other) noexcept : m_data(other.m_data), m_size(other.m_size) {
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+mapped_file& mapped_file::operator=(mapped_file &&other) noexcept {
+    if(this != &other){
+        unmap();
+        m_data = other.m_data;
+        m_size = other.m_size;
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+    return *this;
+}
+
+mapped_file::~mapped_file(){
+    unmap();
+}
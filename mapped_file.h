@@ -0,0 +1,206 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ * @file mapped_file.h
+ * @author Gabriele Canesi
+ * @brief File che contiene gli strumenti non generici per il formato binario delle matrici: la mappatura in memoria
+ * di un file in sola lettura, il checksum e la descrizione dell'header
+ */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+/**
+ * @brief Header del formato binario di una matrice sparsa
+ *
+ * Il file contiene, nell'ordine, l'header, il valore di default e gli array della rappresentazione indicata da
+ * layout; ogni sezione inizia a un offset multiplo di
+ * matrix_file_alignment. Gli interi sono scritti nell'ordine dei
+ * byte della macchina.
+ */
+struct matrix_file_header {
+    char magic[8]; ///< Sempre "SPMATRIX"
+    std::uint32_t version; ///< Versione del formato, attualmente 1
+    std::uint32_t layout; ///< Rappresentazione degli array, vedi matrix_file_layout
+    std::uint32_t value_size; ///< sizeof(T)
+    std::uint32_t value_kind; ///< Famiglia del tipo T, vedi matrix_value_kind
+    std::uint32_t index_size; ///< Dimensione in byte di un indice
+    std::uint32_t reserved; ///< Sempre 0
+    std::int64_t rows; ///< Numero di righe
+    std::int64_t columns; ///< Numero di colonne
+    std::int64_t nnz; ///< Numero di elementi memorizzati
+    std::uint64_t default_offset; ///< Posizione del valore di default
+    std::uint64_t pointers_offset; ///< Posizione dell'array degli offset di riga (rows + 1 indici)
+    std::uint64_t indices_offset; ///< Posizione dell'array delle colonne (nnz indici)
+    std::uint64_t values_offset; ///< Posizione dell'array dei valori (nnz valori)
+    std::uint64_t file_size; ///< Dimensione totale del file
+    std::uint64_t data_checksum; ///< Checksum di tutto ciò che segue l'header
+    std::uint64_t header_checksum; ///< Checksum dei campi precedenti dell'header
+};
+
+/**
+ * @brief Rappresentazioni supportate dal formato binario
+ */
+enum matrix_file_layout {
+    layout_csr = 1 ///< Compressed sparse row
+};
+
+/**
+ * @brief Famiglie di tipi dei valori, per evitare di reinterpretare un file con un tipo sbagliato della stessa
+ * dimensione
+ */
+enum matrix_value_kind {
+    value_unsigned = 0, ///< Intero senza segno o tipo non aritmetico
+    value_signed = 1, ///< Intero con segno
+    value_floating = 2 ///< Virgola mobile
+};
+
+/**
+ * @brief Versione corrente del formato binario
+ */
+const std::uint32_t matrix_file_version = 1;
+
+/**
+ * @brief Allineamento in byte delle sezioni del file
+ */
+const std::uint64_t matrix_file_alignment = 64;
+
+/**
+ * @brief Checksum FNV-1a a 64 bit
+ * @param data i byte da includere
+ * @param size numero di byte
+ * @param seed checksum dei byte precedenti, per calcolarlo a pezzi
+ * @return il checksum aggiornato
+ */
+std::uint64_t matrix_checksum(const void *data, std::size_t size, std::uint64_t seed = 0xCBF29CE484222325ULL);
+
+/**
+ * @brief Checksum dei campi dell'header che precedono header_checksum
+ */
+std::uint64_t header_checksum(const matrix_file_header &header);
+
+/**
+ * @brief Controlla che un file mappato contenga un header valido, coerente con la sua dimensione
+ *
+ * Non verifica data_checksum, che richiederebbe di leggere l'intero file.
+ * @param data inizio del file
+ * @param size dimensione del file
+ * @return l'header
+ * @throws matrix_file_exception se il file non è nel formato atteso
+ */
+const matrix_file_header& check_matrix_header(const void *data, std::size_t size);
+
+/**
+ * @brief Scrittura sequenziale di un file nel formato binario
+ *
+ * Le sezioni vengono scritte in un file temporaneo (path seguito da ".tmp") aggiornando il checksum, compresi i
+ * byte di riempimento; finish scrive l'header e rinomina il file, così un salvataggio interrotto non sostituisce
+ * mai un file valido con uno incompleto.
+ */
+class matrix_file_writer {
+public:
+    /**
+     * @brief Crea il file temporaneo, lasciando lo spazio per l'header
+     * @param path il percorso del file finale
+     * @throws matrix_file_exception se il file non può essere creato
+     */
+    explicit matrix_file_writer(const std::string &path);
+
+    /**
+     * @brief Scrive una sezione, preceduta da zeri fino a offset
+     * @param offset posizione della sezione, non inferiore alla fine della sezione precedente
+     * @param data i byte da scrivere
+     * @param size numero di byte
+     */
+    void write_section(std::uint64_t offset, const void *data, std::size_t size);
+
+    /**
+     * @brief Completa l'header con i checksum, lo scrive e sostituisce il file finale
+     * @param header l'header, con tutti i campi tranne i checksum
+     * @throws matrix_file_exception se la scrittura non è andata a buon fine
+     */
+    void finish(matrix_file_header &header);
+
+    /**
+     * @brief Distruttore: se finish non è stata chiamata, ad esempio per un'eccezione, elimina il file temporaneo
+     */
+    ~matrix_file_writer();
+
+private:
+    std::string m_path; ///< Percorso del file finale
+    std::string m_temp_path; ///< Percorso del file temporaneo
+    std::ofstream m_out; ///< Stream sul file temporaneo
+    std::uint64_t m_position; ///< Byte scritti finora
+    std::uint64_t m_checksum; ///< Checksum dei byte che seguono l'header
+    bool m_finished; ///< true dopo una chiamata a finish riuscita
+};
+
+/**
+ * @brief File mappato in memoria in sola lettura
+ *
+ * La mappatura dura quanto l'oggetto, che può essere spostato ma non copiato. Le pagine vengono lette dal disco
+ * solo quando vengono toccate.
+ */
+class mapped_file {
+public:
+    /**
+     * @brief Costruttore di default: nessun file mappato
+     */
+    mapped_file();
+
+    /**
+     * @brief Mappa in memoria l'intero file indicato
+     * @param path il percorso del file
+     * @throws matrix_file_exception se il file non può essere aperto o mappato
+     */
+    explicit mapped_file(const std::string &path);
+
+    /**
+     * @brief Costruttore di spostamento
+     */
+    mapped_file(mapped_file &&other) noexcept;
+
+    /**
+     * @brief Assegnamento per spostamento
+     */
+    mapped_file& operator=(mapped_file &&other) noexcept;
+
+    /**
+     * @brief Distruttore, rimuove la mappatura
+     */
+    ~mapped_file();
+
+    /**
+     * @return puntatore all'inizio del file, nullptr se nessun file è mappato
+     */
+    const unsigned char* data() const {
+        return m_data;
+    }
+
+    /**
+     * @return la dimensione del file in byte
+     */
+    std::size_t size() const {
+        return m_size;
+    }
+
+private:
+    const unsigned char *m_data; ///< Inizio della mappatura
+    std::size_t m_size; ///< Dimensione della mappatura
+
+    mapped_file(const mapped_file &);
+    mapped_file& operator=(const mapped_file &);
+
+    /**
+     * @brief rimuove la mappatura, se presente
+     */
+    void unmap();
+};
+
+#endif
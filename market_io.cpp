@@ -0,0 +1,241 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ * @file market_io.cpp
+ * @author Gabriele Canesi
+ * @brief File che contiene le implementazioni dichiarate in market_io.h
+ */
+
+#include "market_io.h"
+#include "sparse_matrix_exceptions.h"
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <limits>
+
+
+/**
+ * @brief Confronta una parola dell'intestazione con quella attesa, senza distinguere maiuscole e minuscole
+ */
+static bool same_word(const std::string &word, const char *expected){
+    if(word.size() != std::strlen(expected)){
+        return false;
+    }
+    for(std::string::size_type k = 0; k < word.size(); ++k){
+        if(std::tolower(static_cast<unsigned char>(word[k])) != expected[k]){
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Restituisce la riga che inizia in position e sposta position all'inizio della successiva
+ */
+static std::string next_line(const char *data, std::size_t size, std::size_t &position){
+    std::size_t begin = position;
+    while(position < size && data[position] != '\n'){
+        ++position;
+    }
+    std::string line(data + begin, data + position);
+    if(position < size){
+        ++position;
+    }
+    return line;
+}
+
+/**
+ * @brief Calcola a * b per a e b non negativi
+ * @throws matrix_file_exception se il prodotto non è rappresentabile con long
+ */
+static long checked_product(long a, long b){
+    if(b != 0 && a > std::numeric_limits<long>::max() / b){
+        throw matrix_file_exception("Dimensioni troppo grandi nel file Matrix Market");
+    }
+    return a * b;
+}
+
+market_header parse_market_header(const char *data, std::size_t size){
+    std::size_t position = 0;
+    std::string banner = next_line(data, size, position);
+
+    std::vector<std::string> words;
+    std::string::size_type k = 0;
+    while(k < banner.size()){
+        while(k < banner.size() && std::isspace(static_cast<unsigned char>(banner[k]))){
+            ++k;
+        }
+        std::string::size_type start = k;
+        while(k < banner.size() && !std::isspace(static_cast<unsigned char>(banner[k]))){
+            ++k;
+        }
+        if(k > start){
+            words.push_back(banner.substr(start, k - start));
+        }
+    }
+    if(words.size() != 5 || words[0] != "%%MatrixMarket" || !same_word(words[1], "matrix")){
+        throw matrix_file_exception("Il file non inizia con un banner Matrix Market valido");
+    }
+
+    market_header header;
+    if(same_word(words[2], "coordinate")){
+        header.format = market_coordinate;
+    } else if(same_word(words[2], "array")){
+        header.format = market_array;
+    } else {
+        throw matrix_file_exception("Formato Matrix Market non supportato: " + words[2]);
+    }
+
+    if(same_word(words[3], "real") || same_word(words[3], "double")){
+        header.field = market_real;
+    } else if(same_word(words[3], "integer")){
+        header.field = market_integer;
+    } else if(same_word(words[3], "pattern") && header.format == market_coordinate){
+        header.field = market_pattern;
+    } else {
+        throw matrix_file_exception("Tipo dei valori Matrix Market non supportato: " + words[3]);
+    }
+
+    if(same_word(words[4], "general")){
+        header.symmetry = market_general;
+    } else if(same_word(words[4], "symmetric")){
+        header.symmetry = market_symmetric;
+    } else if(same_word(words[4], "skew-symmetric")){
+        header.symmetry = market_skew_symmetric;
+    } else {
+        throw matrix_file_exception("Simmetria Matrix Market non supportata: " + words[4]);
+    }
+
+    // Commenti e righe vuote fino alla riga delle dimensioni
+    std::string sizes;
+    do{
+        if(position >= size){
+            throw matrix_file_exception("Riga delle dimensioni mancante nel file Matrix Market");
+        }
+        sizes = next_line(data, size, position);
+    } while(sizes.empty() || sizes[0] == '%' || sizes.find_first_not_of(" \t\r") == std::string::npos);
+
+    const char *p = sizes.c_str(), *end = p + sizes.size();
+    if(!parse_market_long(p, end, header.rows) || !parse_market_long(p, end, header.columns)){
+        throw matrix_file_exception("Riga delle dimensioni non valida nel file Matrix Market");
+    }
+    if(header.format == market_coordinate && !parse_market_long(p, end, header.entries)){
+        throw matrix_file_exception("Numero di elementi mancante nel file Matrix Market");
+    }
+    skip_market_blanks(p, end);
+    if(p != end || header.rows < 0 || header.columns < 0 ||
+       (header.format == market_coordinate && header.entries < 0)){
+        throw matrix_file_exception("Riga delle dimensioni non valida nel file Matrix Market");
+    }
+    if(header.symmetry != market_general && header.rows != header.columns){
+        throw matrix_file_exception("Una matrice simmetrica deve essere quadrata");
+    }
+    // Le dimensioni vengono dal file: i prodotti sono controllati prima di essere calcolati
+    if(header.format == market_array){
+        if(header.symmetry == market_general){
+            header.entries = checked_product(header.rows, header.columns);
+        } else if(header.rows == std::numeric_limits<long>::max()){
+            throw matrix_file_exception("Dimensioni troppo grandi nel file Matrix Market");
+        } else {
+            // Triangolo inferiore, diagonale esclusa per le matrici antisimmetriche
+            header.entries = header.symmetry == market_symmetric ? checked_product(header.rows, header.rows + 1) / 2
+                                                                 : checked_product(header.rows, header.rows - 1) / 2;
+        }
+    }
+    header.body = position;
+    return header;
+}
+
+std::vector<std::size_t> split_market_lines(const char *data, std::size_t begin, std::size_t end, unsigned parts){
+    std::vector<std::size_t> bounds(parts + 1, end);
+    bounds[0] = begin;
+    for(unsigned p = 1; p < parts; ++p){
+        std::size_t position = begin + (end - begin) / parts * p;
+        if(position < bounds[p - 1]){
+            position = bounds[p - 1];
+        }
+        // Il confine si sposta all'inizio della riga successiva
+        while(position < end && position > begin && data[position - 1] != '\n'){
+            ++position;
+        }
+        bounds[p] = position;
+    }
+    return bounds;
+}
+
+bool parse_market_double_slow(const char *&p, const char *end, double &out){
+    skip_market_blanks(p, end);
+    char token[128];
+    std::size_t length = 0;
+    while(p + length != end && length + 1 < sizeof(token) && !std::isspace(static_cast<unsigned char>(p[length]))){
+        token[length] = p[length];
+        ++length;
+    }
+    token[length] = '\0';
+    char *stop = nullptr;
+    out = std::strtod(token, &stop);
+    if(length == 0 || stop != token + length){
+        return false;
+    }
+    p += length;
+    return true;
+}
+
+
+market_writer::market_writer(const std::string &path) : m_file(std::fopen(path.c_str(), "wb")),
+                                                        m_buffer(1 << 20), m_used(0), m_path(path) {
+    if(m_file == nullptr){
+        throw matrix_file_exception("Impossibile creare il file " + path);
+    }
+}
+
+market_writer::~market_writer(){
+    if(m_file != nullptr){
+        std::fclose(m_file);
+    }
+}
+
+void market_writer::write(const char *text){
+    for(; *text != '\0'; ++text){
+        put(*text);
+    }
+}
+
+void market_writer::write(long value){
+    char digits[24];
+    int length = 0;
+    unsigned long magnitude = value < 0 ? 0UL - static_cast<unsigned long>(value) : static_cast<unsigned long>(value);
+    do{
+        digits[length++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while(magnitude != 0);
+    if(value < 0){
+        put('-');
+    }
+    while(length > 0){
+        put(digits[--length]);
+    }
+}
+
+void market_writer::write(double value, int digits){
+    char text[40];
+    std::snprintf(text, sizeof(text), "%.*g", digits, value);
+    write(text);
+}
+
+void market_writer::flush(){
+    if(m_used != 0 && std::fwrite(&m_buffer[0], 1, m_used, m_file) != m_used){
+        throw matrix_file_exception("Errore durante la scrittura del file " + m_path);
+    }
+    m_used = 0;
+}
+
+void market_writer::finish(){
+    flush();
+    int result = std::fclose(m_file);
+    m_file = nullptr;
+    if(result != 0){
+        throw matrix_file_exception("Errore durante la chiusura del file " + m_path);
+    }
+}
@@ -0,0 +1,245 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ * @file market_io.h
+ * @author Gabriele Canesi
+ * @brief File che contiene gli strumenti non generici per il formato Matrix Market: la lettura dell'header, la
+ * divisione del file in blocchi di righe, il parsing veloce dei numeri e la scrittura bufferizzata
+ */
+
+#ifndef MARKET_IO_H
+#define MARKET_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Formato del corpo di un file Matrix Market
+ */
+enum market_format {
+    market_coordinate, ///< Una riga "i j [valore]" per ogni elemento memorizzato
+    market_array ///< Tutti i valori, uno per riga, in ordine di colonna
+};
+
+/**
+ * @brief Tipo dei valori di un file Matrix Market
+ */
+enum market_field {
+    market_real, ///< Valori in virgola mobile
+    market_integer, ///< Valori interi
+    market_pattern ///< Solo le posizioni, senza valori (solo nel formato coordinate)
+};
+
+/**
+ * @brief Simmetria dichiarata da un file Matrix Market
+ */
+enum market_symmetry {
+    market_general, ///< Tutti gli elementi sono presenti nel file
+    market_symmetric, ///< Solo il triangolo inferiore: a(j, i) = a(i, j)
+    market_skew_symmetric ///< Solo il triangolo strettamente inferiore: a(j, i) = -a(i, j)
+};
+
+/**
+ * @brief Informazioni lette dall'intestazione di un file Matrix Market
+ */
+struct market_header {
+    market_format format; ///< Formato del corpo
+    market_field field; ///< Tipo dei valori
+    market_symmetry symmetry; ///< Simmetria
+    long rows; ///< Numero di righe
+    long columns; ///< Numero di colonne
+    long entries; ///< Numero di righe di dati attese nel corpo
+    std::size_t body; ///< Posizione nel file della prima riga di dati
+};
+
+/**
+ * @brief Legge la riga di banner, i commenti e la riga delle dimensioni
+ * @param data contenuto del file
+ * @param size dimensione del file
+ * @throws matrix_file_exception se l'intestazione non è valida o descrive un tipo non supportato (complex,
+ * hermitian)
+ */
+market_header parse_market_header(const char *data, std::size_t size);
+
+/**
+ * @brief Divide [begin, end) in parts blocchi di dimensione simile, con i confini all'inizio di una riga
+ * @return parts + 1 confini crescenti
+ */
+std::vector<std::size_t> split_market_lines(const char *data, std::size_t begin, std::size_t end, unsigned parts);
+
+/**
+ * @brief Salta spazi e tabulazioni
+ */
+inline void skip_market_blanks(const char *&p, const char *end){
+    while(p != end && (*p == ' ' || *p == '\t' || *p == '\r')){
+        ++p;
+    }
+}
+
+/**
+ * @brief Legge un intero con segno in base 10
+ * @param p posizione corrente, avanzata oltre il numero
+ * @param end fine del buffer
+ * @param out il valore letto
+ * @return false se non c'è un numero intero valido
+ */
+inline bool parse_market_long(const char *&p, const char *end, long &out){
+    skip_market_blanks(p, end);
+    bool negative = false;
+    if(p != end && (*p == '-' || *p == '+')){
+        negative = *p == '-';
+        ++p;
+    }
+    const char *start = p;
+    unsigned long value = 0;
+    while(p != end && *p >= '0' && *p <= '9'){
+        value = value * 10 + static_cast<unsigned long>(*p - '0');
+        ++p;
+    }
+    if(p == start || p - start > 18){
+        return false;
+    }
+    out = negative ? -static_cast<long>(value) : static_cast<long>(value);
+    return true;
+}
+
+/**
+ * @brief Versione lenta di parse_market_double, basata su strtod, per i numeri che la versione veloce non gestisce
+ */
+bool parse_market_double_slow(const char *&p, const char *end, double &out);
+
+/**
+ * @brief Legge un numero in virgola mobile
+ *
+ * Se la mantissa ha al più 15 cifre significative e l'esponente decimale è al più 22 in valore assoluto il
+ * risultato si ottiene con una sola moltiplicazione o divisione esatta, ed è arrotondato correttamente; negli
+ * altri casi (e per inf e nan) viene usata strtod.
+ * @param p posizione corrente, avanzata oltre il numero
+ * @param end fine del buffer
+ * @param out il valore letto
+ * @return false se non c'è un numero valido
+ */
+inline bool parse_market_double(const char *&p, const char *end, double &out){
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13,
+                                    1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    skip_market_blanks(p, end);
+    const char *start = p;
+    bool negative = false;
+    if(p != end && (*p == '-' || *p == '+')){
+        negative = *p == '-';
+        ++p;
+    }
+
+    std::uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any = false;
+    for(; p != end && *p >= '0' && *p <= '9'; ++p, any = true){
+        if(mantissa != 0 || *p != '0'){
+            ++digits;
+        }
+        mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+    }
+    if(p != end && *p == '.'){
+        for(++p; p != end && *p >= '0' && *p <= '9'; ++p, any = true){
+            if(mantissa != 0 || *p != '0'){
+                ++digits;
+            }
+            mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+            --exponent;
+        }
+    }
+    if(!any || digits > 15){
+        p = start;
+        return parse_market_double_slow(p, end, out);
+    }
+    if(p != end && (*p == 'e' || *p == 'E')){
+        long written = 0;
+        ++p;
+        if(!parse_market_long(p, end, written) || written > 1000 || written < -1000){
+            p = start;
+            return parse_market_double_slow(p, end, out);
+        }
+        exponent += static_cast<int>(written);
+    }
+    if(exponent > 22 || exponent < -22){
+        p = start;
+        return parse_market_double_slow(p, end, out);
+    }
+
+    double value = static_cast<double>(mantissa);
+    value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+    out = negative ? -value : value;
+    return true;
+}
+
+/**
+ * @brief Scrittura di un file di testo tramite un buffer grande, senza iostream
+ *
+ * I dati vengono scritti con fwrite solo quando il buffer è pieno e alla chiamata di finish.
+ */
+class market_writer {
+public:
+    /**
+     * @brief Crea (o sovrascrive) il file indicato
+     * @throws matrix_file_exception se il file non può essere creato
+     */
+    explicit market_writer(const std::string &path);
+
+    /**
+     * @brief Distruttore, chiude il file se finish non è stata chiamata
+     */
+    ~market_writer();
+
+    /**
+     * @brief Aggiunge una stringa terminata da zero
+     */
+    void write(const char *text);
+
+    /**
+     * @brief Aggiunge un intero in base 10
+     */
+    void write(long value);
+
+    /**
+     * @brief Aggiunge un numero in virgola mobile con le cifre necessarie a rileggerlo senza perdite
+     * @param value il numero
+     * @param digits cifre significative (17 per double, 9 per float)
+     */
+    void write(double value, int digits);
+
+    /**
+     * @brief Aggiunge un singolo carattere
+     */
+    void put(char c){
+        if(m_used == m_buffer.size()){
+            flush();
+        }
+        m_buffer[m_used++] = c;
+    }
+
+    /**
+     * @brief Svuota il buffer e chiude il file
+     * @throws matrix_file_exception se una scrittura non è andata a buon fine
+     */
+    void finish();
+
+private:
+    std::FILE *m_file; ///< Il file aperto
+    std::vector<char> m_buffer; ///< Buffer di scrittura
+    std::size_t m_used; ///< Caratteri presenti nel buffer
+    std::string m_path; ///< Percorso del file, per i messaggi di errore
+
+    market_writer(const market_writer &);
+    market_writer& operator=(const market_writer &);
+
+    /**
+     * @brief scrive su file il contenuto del buffer
+     */
+    void flush();
+};
+
+#endif
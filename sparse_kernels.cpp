@@ -0,0 +1,521 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ * @file sparse_kernels.cpp
+ * @author Gabriele Canesi
+ * @brief File che contiene le implementazioni scalari e vettorizzate dei kernel dichiarati in sparse_kernels.h
+ *
+ * Le versioni AVX2 e AVX-512 sono compilate con l'attributo target, quindi il file non richiede flag particolari:
+ * la scelta della versione avviene a runtime tramite __builtin_cpu_supports.
+ */
+
+#include "sparse_kernels.h"
+#include <atomic>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SPARSE_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+
+simd_level detected_simd_level(){
+#ifdef SPARSE_KERNELS_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")){
+        return simd_avx512;
+    }
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")){
+        return simd_avx2;
+    }
+#endif
+    return simd_scalar;
+}
+
+/**
+ * @brief Livello di vettorizzazione corrente, inizializzato al primo utilizzo con quello rilevato
+ *
+ * È atomico perché i thread di multiply lo leggono mentre set_simd_level può scriverlo; le letture sono relaxed,
+ * quindi un kernel già avviato può usare il livello precedente.
+ */
+static std::atomic<int>& current_simd_level(){
+    static std::atomic<int> level(detected_simd_level());
+    return level;
+}
+
+simd_level active_simd_level(){
+    return static_cast<simd_level>(current_simd_level().load(std::memory_order_relaxed));
+}
+
+void set_simd_level(simd_level level){
+    simd_level detected = detected_simd_level();
+    current_simd_level().store(level > detected ? detected : level, std::memory_order_relaxed);
+}
+
+
+#ifdef SPARSE_KERNELS_X86
+
+__attribute__((target("avx2,fma")))
+static void spmv_avx2(const long *row_ptr, const long *col_idx, const double *values, long row_begin, long row_end,
+                      const double *x, double shift, double base, double *y){
+    const __m256d vshift = _mm256_set1_pd(shift);
+    for(long i = row_begin; i < row_end; ++i){
+        long k = row_ptr[i];
+        const long end = row_ptr[i + 1];
+        __m256d acc = _mm256_setzero_pd();
+        for(; k + 4 <= end; k += 4){
+            __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col_idx + k));
+            __m256d xv = _mm256_i64gather_pd(x, idx, 8);
+            __m256d v = _mm256_sub_pd(_mm256_loadu_pd(values + k), vshift);
+            acc = _mm256_fmadd_pd(v, xv, acc);
+        }
+        __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+        double sum = base + _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+        for(; k < end; ++k){
+            sum += (values[k] - shift) * x[col_idx[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void spmv_avx2(const long *row_ptr, const long *col_idx, const float *values, long row_begin, long row_end,
+                      const float *x, float shift, float base, float *y){
+    const __m128 vshift = _mm_set1_ps(shift);
+    for(long i = row_begin; i < row_end; ++i){
+        long k = row_ptr[i];
+        const long end = row_ptr[i + 1];
+        __m128 acc = _mm_setzero_ps();
+        for(; k + 4 <= end; k += 4){
+            __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col_idx + k));
+            __m128 xv = _mm256_i64gather_ps(x, idx, 4);
+            __m128 v = _mm_sub_ps(_mm_loadu_ps(values + k), vshift);
+            acc = _mm_fmadd_ps(v, xv, acc);
+        }
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+        float sum = base + _mm_cvtss_f32(acc);
+        for(; k < end; ++k){
+            sum += (values[k] - shift) * x[col_idx[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void spmv_avx2(const long *row_ptr, const long *col_idx, const std::int32_t *values, long row_begin,
+                      long row_end, const std::int32_t *x, std::int32_t shift, std::int32_t base, std::int32_t *y){
+    const __m128i vshift = _mm_set1_epi32(shift);
+    for(long i = row_begin; i < row_end; ++i){
+        long k = row_ptr[i];
+        const long end = row_ptr[i + 1];
+        __m128i acc = _mm_setzero_si128();
+        for(; k + 4 <= end; k += 4){
+            __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col_idx + k));
+            __m128i xv = _mm256_i64gather_epi32(reinterpret_cast<const int*>(x), idx, 4);
+            __m128i v = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + k)), vshift);
+            acc = _mm_add_epi32(acc, _mm_mullo_epi32(v, xv));
+        }
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+        std::int32_t sum = base + _mm_cvtsi128_si32(acc);
+        for(; k < end; ++k){
+            sum += (values[k] - shift) * x[col_idx[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+__attribute__((target("avx512f,avx512dq,avx2,fma")))
+static void spmv_avx512(const long *row_ptr, const long *col_idx, const double *values, long row_begin,
+                        long row_end, const double *x, double shift, double base, double *y){
+    const __m512d vshift = _mm512_set1_pd(shift);
+    for(long i = row_begin; i < row_end; ++i){
+        long k = row_ptr[i];
+        const long end = row_ptr[i + 1];
+        __m512d acc = _mm512_setzero_pd();
+        for(; k + 8 <= end; k += 8){
+            __m512i idx = _mm512_loadu_si512(col_idx + k);
+            __m512d xv = _mm512_i64gather_pd(idx, x, 8);
+            __m512d v = _mm512_sub_pd(_mm512_loadu_pd(values + k), vshift);
+            acc = _mm512_fmadd_pd(v, xv, acc);
+        }
+        double sum = base + _mm512_reduce_add_pd(acc);
+        for(; k < end; ++k){
+            sum += (values[k] - shift) * x[col_idx[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+__attribute__((target("avx512f,avx512dq,avx2,fma")))
+static void spmv_avx512(const long *row_ptr, const long *col_idx, const float *values, long row_begin,
+                        long row_end, const float *x, float shift, float base, float *y){
+    const __m256 vshift = _mm256_set1_ps(shift);
+    for(long i = row_begin; i < row_end; ++i){
+        long k = row_ptr[i];
+        const long end = row_ptr[i + 1];
+        __m256 acc = _mm256_setzero_ps();
+        for(; k + 8 <= end; k += 8){
+            __m512i idx = _mm512_loadu_si512(col_idx + k);
+            __m256 xv = _mm512_i64gather_ps(idx, x, 4);
+            __m256 v = _mm256_sub_ps(_mm256_loadu_ps(values + k), vshift);
+            acc = _mm256_fmadd_ps(v, xv, acc);
+        }
+        __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+        half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+        float sum = base + _mm_cvtss_f32(half);
+        for(; k < end; ++k){
+            sum += (values[k] - shift) * x[col_idx[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+__attribute__((target("avx512f,avx512dq,avx2,fma")))
+static void spmv_avx512(const long *row_ptr, const long *col_idx, const std::int32_t *values, long row_begin,
+                        long row_end, const std::int32_t *x, std::int32_t shift, std::int32_t base, std::int32_t *y){
+    const __m256i vshift = _mm256_set1_epi32(shift);
+    for(long i = row_begin; i < row_end; ++i){
+        long k = row_ptr[i];
+        const long end = row_ptr[i + 1];
+        __m256i acc = _mm256_setzero_si256();
+        for(; k + 8 <= end; k += 8){
+            __m512i idx = _mm512_loadu_si512(col_idx + k);
+            __m256i xv = _mm512_i64gather_epi32(idx, x, 4);
+            __m256i v = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + k)), vshift);
+            acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(v, xv));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+        std::int32_t sum = base + _mm_cvtsi128_si32(half);
+        for(; k < end; ++k){
+            sum += (values[k] - shift) * x[col_idx[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+__attribute__((target("avx512f,avx512dq,avx2,fma")))
+static void spmv_avx512(const long *row_ptr, const long *col_idx, const std::int64_t *values, long row_begin,
+                        long row_end, const std::int64_t *x, std::int64_t shift, std::int64_t base, std::int64_t *y){
+    const __m512i vshift = _mm512_set1_epi64(shift);
+    for(long i = row_begin; i < row_end; ++i){
+        long k = row_ptr[i];
+        const long end = row_ptr[i + 1];
+        __m512i acc = _mm512_setzero_si512();
+        for(; k + 8 <= end; k += 8){
+            __m512i idx = _mm512_loadu_si512(col_idx + k);
+            __m512i xv = _mm512_i64gather_epi64(idx, x, 8);
+            __m512i v = _mm512_sub_epi64(_mm512_loadu_si512(values + k), vshift);
+            acc = _mm512_add_epi64(acc, _mm512_mullo_epi64(v, xv));
+        }
+        std::int64_t sum = base + _mm512_reduce_add_epi64(acc);
+        for(; k < end; ++k){
+            sum += (values[k] - shift) * x[col_idx[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+#endif
+
+
+void spmv_rows(const long *row_ptr, const long *col_idx, const double *values, long row_begin, long row_end,
+               const double *x, double shift, double base, double *y){
+#ifdef SPARSE_KERNELS_X86
+    switch (active_simd_level()) {
+        case simd_avx512:
+            spmv_avx512(row_ptr, col_idx, values, row_begin, row_end, x, shift, base, y);
+            return;
+        case simd_avx2:
+            spmv_avx2(row_ptr, col_idx, values, row_begin, row_end, x, shift, base, y);
+            return;
+        default:
+            break;
+    }
+#endif
+    spmv_rows<double>(row_ptr, col_idx, values, row_begin, row_end, x, shift, base, y);
+}
+
+void spmv_rows(const long *row_ptr, const long *col_idx, const float *values, long row_begin, long row_end,
+               const float *x, float shift, float base, float *y){
+#ifdef SPARSE_KERNELS_X86
+    switch (active_simd_level()) {
+        case simd_avx512:
+            spmv_avx512(row_ptr, col_idx, values, row_begin, row_end, x, shift, base, y);
+            return;
+        case simd_avx2:
+            spmv_avx2(row_ptr, col_idx, values, row_begin, row_end, x, shift, base, y);
+            return;
+        default:
+            break;
+    }
+#endif
+    spmv_rows<float>(row_ptr, col_idx, values, row_begin, row_end, x, shift, base, y);
+}
+
+void spmv_rows(const long *row_ptr, const long *col_idx, const std::int32_t *values, long row_begin, long row_end,
+               const std::int32_t *x, std::int32_t shift, std::int32_t base, std::int32_t *y){
+#ifdef SPARSE_KERNELS_X86
+    switch (active_simd_level()) {
+        case simd_avx512:
+            spmv_avx512(row_ptr, col_idx, values, row_begin, row_end, x, shift, base, y);
+            return;
+        case simd_avx2:
+            spmv_avx2(row_ptr, col_idx, values, row_begin, row_end, x, shift, base, y);
+            return;
+        default:
+            break;
+    }
+#endif
+    spmv_rows<std::int32_t>(row_ptr, col_idx, values, row_begin, row_end, x, shift, base, y);
+}
+
+void spmv_rows(const long *row_ptr, const long *col_idx, const std::int64_t *values, long row_begin, long row_end,
+               const std::int64_t *x, std::int64_t shift, std::int64_t base, std::int64_t *y){
+#ifdef SPARSE_KERNELS_X86
+    // AVX2 non ha la moltiplicazione a 64 bit: in quel caso la versione scalare è altrettanto veloce
+    if(active_simd_level() == simd_avx512){
+        spmv_avx512(row_ptr, col_idx, values, row_begin, row_end, x, shift, base, y);
+        return;
+    }
+#endif
+    spmv_rows<std::int64_t>(row_ptr, col_idx, values, row_begin, row_end, x, shift, base, y);
+}
+
+
+std::vector<long> balanced_row_partition(const long *row_ptr, long rows, unsigned parts){
+    std::vector<long> bounds(parts + 1, rows);
+    bounds[0] = 0;
+
+    // Il costo delle prime i righe è row_ptr[i] + i, crescente in i: ogni confine si trova con una ricerca binaria
+    const long total = row_ptr[rows] + rows;
+    for(unsigned p = 1; p < parts; ++p){
+        long target = static_cast<long>(static_cast<double>(total) * p / parts);
+        long low = bounds[p - 1], high = rows;
+        while(low < high){
+            long middle = low + (high - low) / 2;
+            if(row_ptr[middle] + middle < target){
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        bounds[p] = low;
+    }
+    return bounds;
+}
+
+
+/**
+ * @brief Test scalare di appartenenza a un intervallo, con gli estremi inclusi o esclusi a tempo di compilazione
+ */
+template<bool LoInclusive, bool HiInclusive, typename T>
+static inline bool in_range(T v, T lo, T hi){
+    return (LoInclusive ? lo <= v : lo < v) && (HiInclusive ? v <= hi : v < hi);
+}
+
+template<bool LoInclusive, bool HiInclusive, typename T>
+static long between_scalar(const T *values, long n, T lo, T hi){
+    long count = 0;
+    for(long k = 0; k < n; ++k){
+        count += in_range<LoInclusive, HiInclusive>(values[k], lo, hi);
+    }
+    return count;
+}
+
+#ifdef SPARSE_KERNELS_X86
+
+// Per i tipi in virgola mobile i predicati ordinati (_OQ) sono falsi sui NaN, come i confronti scalari
+
+template<bool LoInclusive, bool HiInclusive>
+__attribute__((target("avx2,popcnt")))
+static long between_avx2(const double *values, long n, double lo, double hi){
+    const __m256d vlo = _mm256_set1_pd(lo), vhi = _mm256_set1_pd(hi);
+    long count = 0, k = 0;
+    for(; k + 4 <= n; k += 4){
+        __m256d v = _mm256_loadu_pd(values + k);
+        __m256d inside = _mm256_and_pd(_mm256_cmp_pd(v, vlo, LoInclusive ? _CMP_GE_OQ : _CMP_GT_OQ),
+                                       _mm256_cmp_pd(v, vhi, HiInclusive ? _CMP_LE_OQ : _CMP_LT_OQ));
+        count += __builtin_popcount(_mm256_movemask_pd(inside));
+    }
+    return count + between_scalar<LoInclusive, HiInclusive>(values + k, n - k, lo, hi);
+}
+
+template<bool LoInclusive, bool HiInclusive>
+__attribute__((target("avx2,popcnt")))
+static long between_avx2(const float *values, long n, float lo, float hi){
+    const __m256 vlo = _mm256_set1_ps(lo), vhi = _mm256_set1_ps(hi);
+    long count = 0, k = 0;
+    for(; k + 8 <= n; k += 8){
+        __m256 v = _mm256_loadu_ps(values + k);
+        __m256 inside = _mm256_and_ps(_mm256_cmp_ps(v, vlo, LoInclusive ? _CMP_GE_OQ : _CMP_GT_OQ),
+                                      _mm256_cmp_ps(v, vhi, HiInclusive ? _CMP_LE_OQ : _CMP_LT_OQ));
+        count += __builtin_popcount(_mm256_movemask_ps(inside));
+    }
+    return count + between_scalar<LoInclusive, HiInclusive>(values + k, n - k, lo, hi);
+}
+
+// AVX2 ha solo il confronto "maggiore" sugli interi: le versioni intere contano gli elementi fuori da [lo, hi]
+
+__attribute__((target("avx2,popcnt")))
+static long between_avx2(const std::int32_t *values, long n, std::int32_t lo, std::int32_t hi){
+    const __m256i vlo = _mm256_set1_epi32(lo), vhi = _mm256_set1_epi32(hi);
+    long outside = 0, k = 0;
+    for(; k + 8 <= n; k += 8){
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + k));
+        __m256i out = _mm256_or_si256(_mm256_cmpgt_epi32(vlo, v), _mm256_cmpgt_epi32(v, vhi));
+        outside += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(out)));
+    }
+    return k - outside + between_scalar<true, true>(values + k, n - k, lo, hi);
+}
+
+__attribute__((target("avx2,popcnt")))
+static long between_avx2(const std::int64_t *values, long n, std::int64_t lo, std::int64_t hi){
+    const __m256i vlo = _mm256_set1_epi64x(lo), vhi = _mm256_set1_epi64x(hi);
+    long outside = 0, k = 0;
+    for(; k + 4 <= n; k += 4){
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + k));
+        __m256i out = _mm256_or_si256(_mm256_cmpgt_epi64(vlo, v), _mm256_cmpgt_epi64(v, vhi));
+        outside += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(out)));
+    }
+    return k - outside + between_scalar<true, true>(values + k, n - k, lo, hi);
+}
+
+template<bool LoInclusive, bool HiInclusive>
+__attribute__((target("avx512f,avx512dq,avx2,popcnt")))
+static long between_avx512(const double *values, long n, double lo, double hi){
+    const __m512d vlo = _mm512_set1_pd(lo), vhi = _mm512_set1_pd(hi);
+    long count = 0, k = 0;
+    for(; k + 8 <= n; k += 8){
+        __m512d v = _mm512_loadu_pd(values + k);
+        __mmask8 inside = _mm512_cmp_pd_mask(v, vlo, LoInclusive ? _CMP_GE_OQ : _CMP_GT_OQ);
+        inside = _mm512_mask_cmp_pd_mask(inside, v, vhi, HiInclusive ? _CMP_LE_OQ : _CMP_LT_OQ);
+        count += __builtin_popcount(inside);
+    }
+    return count + between_scalar<LoInclusive, HiInclusive>(values + k, n - k, lo, hi);
+}
+
+template<bool LoInclusive, bool HiInclusive>
+__attribute__((target("avx512f,avx512dq,avx2,popcnt")))
+static long between_avx512(const float *values, long n, float lo, float hi){
+    const __m512 vlo = _mm512_set1_ps(lo), vhi = _mm512_set1_ps(hi);
+    long count = 0, k = 0;
+    for(; k + 16 <= n; k += 16){
+        __m512 v = _mm512_loadu_ps(values + k);
+        __mmask16 inside = _mm512_cmp_ps_mask(v, vlo, LoInclusive ? _CMP_GE_OQ : _CMP_GT_OQ);
+        inside = _mm512_mask_cmp_ps_mask(inside, v, vhi, HiInclusive ? _CMP_LE_OQ : _CMP_LT_OQ);
+        count += __builtin_popcount(inside);
+    }
+    return count + between_scalar<LoInclusive, HiInclusive>(values + k, n - k, lo, hi);
+}
+
+__attribute__((target("avx512f,avx512dq,avx2,popcnt")))
+static long between_avx512(const std::int32_t *values, long n, std::int32_t lo, std::int32_t hi){
+    const __m512i vlo = _mm512_set1_epi32(lo), vhi = _mm512_set1_epi32(hi);
+    long count = 0, k = 0;
+    for(; k + 16 <= n; k += 16){
+        __m512i v = _mm512_loadu_si512(values + k);
+        __mmask16 inside = _mm512_cmp_epi32_mask(v, vlo, _MM_CMPINT_NLT);
+        inside = _mm512_mask_cmp_epi32_mask(inside, v, vhi, _MM_CMPINT_LE);
+        count += __builtin_popcount(inside);
+    }
+    return count + between_scalar<true, true>(values + k, n - k, lo, hi);
+}
+
+__attribute__((target("avx512f,avx512dq,avx2,popcnt")))
+static long between_avx512(const std::int64_t *values, long n, std::int64_t lo, std::int64_t hi){
+    const __m512i vlo = _mm512_set1_epi64(lo), vhi = _mm512_set1_epi64(hi);
+    long count = 0, k = 0;
+    for(; k + 8 <= n; k += 8){
+        __m512i v = _mm512_loadu_si512(values + k);
+        __mmask8 inside = _mm512_cmp_epi64_mask(v, vlo, _MM_CMPINT_NLT);
+        inside = _mm512_mask_cmp_epi64_mask(inside, v, vhi, _MM_CMPINT_LE);
+        count += __builtin_popcount(inside);
+    }
+    return count + between_scalar<true, true>(values + k, n - k, lo, hi);
+}
+
+#endif
+
+/**
+ * @brief Sceglie il kernel in virgola mobile in base al livello di vettorizzazione corrente
+ */
+template<bool LoInclusive, bool HiInclusive, typename T>
+static long between_floating(const T *values, long n, T lo, T hi){
+#ifdef SPARSE_KERNELS_X86
+    switch (active_simd_level()) {
+        case simd_avx512:
+            return between_avx512<LoInclusive, HiInclusive>(values, n, lo, hi);
+        case simd_avx2:
+            return between_avx2<LoInclusive, HiInclusive>(values, n, lo, hi);
+        default:
+            break;
+    }
+#endif
+    return between_scalar<LoInclusive, HiInclusive>(values, n, lo, hi);
+}
+
+template<typename T>
+static long floating_between(const T *values, long n, T lo, T hi, bool lo_inclusive, bool hi_inclusive){
+    if(lo_inclusive){
+        return hi_inclusive ? between_floating<true, true>(values, n, lo, hi)
+                            : between_floating<true, false>(values, n, lo, hi);
+    }
+    return hi_inclusive ? between_floating<false, true>(values, n, lo, hi)
+                        : between_floating<false, false>(values, n, lo, hi);
+}
+
+/**
+ * @brief Per gli interi un estremo escluso equivale a quello successivo incluso: i kernel lavorano solo su [lo, hi]
+ */
+template<typename T>
+static long integer_between(const T *values, long n, T lo, T hi, bool lo_inclusive, bool hi_inclusive){
+    if(!lo_inclusive){
+        if(lo == std::numeric_limits<T>::max()){
+            return 0;
+        }
+        ++lo;
+    }
+    if(!hi_inclusive){
+        if(hi == std::numeric_limits<T>::min()){
+            return 0;
+        }
+        --hi;
+    }
+    if(hi < lo){
+        return 0;
+    }
+#ifdef SPARSE_KERNELS_X86
+    switch (active_simd_level()) {
+        case simd_avx512:
+            return between_avx512(values, n, lo, hi);
+        case simd_avx2:
+            return between_avx2(values, n, lo, hi);
+        default:
+            break;
+    }
+#endif
+    return between_scalar<true, true>(values, n, lo, hi);
+}
+
+long count_between(const double *values, long n, double lo, double hi, bool lo_inclusive, bool hi_inclusive){
+    return floating_between(values, n, lo, hi, lo_inclusive, hi_inclusive);
+}
+
+long count_between(const float *values, long n, float lo, float hi, bool lo_inclusive, bool hi_inclusive){
+    return floating_between(values, n, lo, hi, lo_inclusive, hi_inclusive);
+}
+
+long count_between(const std::int32_t *values, long n, std::int32_t lo, std::int32_t hi, bool lo_inclusive,
+                   bool hi_inclusive){
+    return integer_between(values, n, lo, hi, lo_inclusive, hi_inclusive);
+}
+
+long count_between(const std::int64_t *values, long n, std::int64_t lo, std::int64_t hi, bool lo_inclusive,
+                   bool hi_inclusive){
+    return integer_between(values, n, lo, hi, lo_inclusive, hi_inclusive);
+}
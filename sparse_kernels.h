@@ -0,0 +1,921 @@
+// Gabriele Canesi
+// Matricola 851637
+
+/**
+ * @file sparse_kernels.h
+ * @author Gabriele Canesi
+ * @brief File che contiene i kernel numerici sulle matrici sparse: prodotto matrice sparsa - vettore denso (SpMV),
+ * prodotto a blocchi per BSRMatrix, prodotto tra matrici sparse (SpGEMM), operazioni elemento per elemento e
+ * conteggio vettorizzato dei valori che soddisfano un confronto
+ *
+ * I kernel lavorano sul layout compresso di CSRMatrix. Per float, double, int32 e int64 esistono versioni
+ * vettorizzate (AVX2 e AVX-512, con gather sugli indici di colonna) scelte a runtime in base alla CPU; per gli
+ * altri tipi viene usata la versione scalare generica.
+ */
+
+#ifndef SPARSE_KERNELS_H
+#define SPARSE_KERNELS_H
+
+#include "CSRMatrix.h"
+#include "CSCMatrix.h"
+#include "BSRMatrix.h"
+#include "TransposedView.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Livelli di vettorizzazione disponibili per i kernel
+ */
+enum simd_level {
+    simd_scalar, ///< Nessuna istruzione vettoriale
+    simd_avx2, ///< AVX2 + FMA
+    simd_avx512 ///< AVX-512 (F e DQ)
+};
+
+/**
+ * @brief Il livello di vettorizzazione più alto supportato dalla CPU corrente
+ */
+simd_level detected_simd_level();
+
+/**
+ * @brief Il livello di vettorizzazione usato attualmente dai kernel
+ */
+simd_level active_simd_level();
+
+/**
+ * @brief Imposta il livello di vettorizzazione usato dai kernel
+ *
+ * Serve soprattutto per confrontare le implementazioni. Se il livello richiesto non è supportato dalla CPU viene
+ * usato quello rilevato. Può essere chiamata anche mentre altri thread eseguono i kernel: quelli già avviati
+ * possono terminare con il livello precedente.
+ * @param level il livello desiderato
+ */
+void set_simd_level(simd_level level);
+
+/**
+ * @name Kernel SpMV sulle righe [row_begin, row_end)
+ *
+ * Per ogni riga i calcola y[i] = base + somma su k di (values[k] - shift) * x[col_idx[k]].
+ * Con shift e base uguali a zero è il normale prodotto sugli elementi memorizzati; gli altri valori servono a
+ * tenere conto di un valore di default diverso da zero.
+ */
+///@{
+void spmv_rows(const long *row_ptr, const long *col_idx, const double *values, long row_begin, long row_end,
+               const double *x, double shift, double base, double *y);
+void spmv_rows(const long *row_ptr, const long *col_idx, const float *values, long row_begin, long row_end,
+               const float *x, float shift, float base, float *y);
+void spmv_rows(const long *row_ptr, const long *col_idx, const std::int32_t *values, long row_begin, long row_end,
+               const std::int32_t *x, std::int32_t shift, std::int32_t base, std::int32_t *y);
+void spmv_rows(const long *row_ptr, const long *col_idx, const std::int64_t *values, long row_begin, long row_end,
+               const std::int64_t *x, std::int64_t shift, std::int64_t base, std::int64_t *y);
+///@}
+
+/**
+ * @name Conteggio dei valori in un intervallo
+ *
+ * Restituiscono quanti tra values[0], ..., values[n - 1] stanno tra lo e hi; ciascun estremo è incluso o escluso a
+ * seconda di lo_inclusive e hi_inclusive. I confronti sono eseguiti a blocchi con istruzioni vettoriali e le
+ * maschere risultanti vengono sommate con popcount. Un NaN non appartiene a nessun intervallo.
+ */
+///@{
+long count_between(const double *values, long n, double lo, double hi, bool lo_inclusive, bool hi_inclusive);
+long count_between(const float *values, long n, float lo, float hi, bool lo_inclusive, bool hi_inclusive);
+long count_between(const std::int32_t *values, long n, std::int32_t lo, std::int32_t hi, bool lo_inclusive,
+                   bool hi_inclusive);
+long count_between(const std::int64_t *values, long n, std::int64_t lo, std::int64_t hi, bool lo_inclusive,
+                   bool hi_inclusive);
+///@}
+
+/**
+ * @brief Divide le righe di una matrice CSR in intervalli di costo simile
+ *
+ * Il costo di un intervallo di righe è il numero di elementi memorizzati più il numero di righe, così da bilanciare
+ * matrici con righe di lunghezza molto variabile e non lasciare scoperte quelle con molte righe vuote.
+ * @param row_ptr array degli offset di riga (rows + 1 elementi)
+ * @param rows numero di righe
+ * @param parts numero di intervalli richiesti, almeno 1
+ * @return parts + 1 confini crescenti: l'intervallo p è [result[p], result[p + 1]). Alcuni intervalli possono
+ * essere vuoti.
+ */
+std::vector<long> balanced_row_partition(const long *row_ptr, long rows, unsigned parts);
+
+/**
+ * @brief Versione scalare generica del kernel SpMV, usata per i tipi senza una versione vettorizzata
+ */
+template<typename T>
+void spmv_rows(const long *row_ptr, const long *col_idx, const T *values, long row_begin, long row_end,
+               const T *x, T shift, T base, T *y){
+    for(long i = row_begin; i < row_end; ++i){
+        T sum = base;
+        for(long k = row_ptr[i]; k < row_ptr[i + 1]; ++k){
+            sum += (values[k] - shift) * x[col_idx[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+/**
+ * @brief Versione scalare generica di count_between, usata per i tipi senza una versione vettorizzata
+ */
+template<typename T>
+long count_between(const T *values, long n, T lo, T hi, bool lo_inclusive, bool hi_inclusive){
+    long count = 0;
+    for(long k = 0; k < n; ++k){
+        if((lo_inclusive ? lo <= values[k] : lo < values[k]) && (hi_inclusive ? values[k] <= hi : values[k] < hi)){
+            ++count;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Contributo del valore di default a ogni riga del prodotto, cioè default * somma(x)
+ */
+template<typename Matrix, typename T>
+T spmv_default_base(const Matrix &A, const T *x){
+    T base = T();
+    if(A.default_value() != T()){
+        for(long j = 0; j < A.columns(); ++j){
+            base += x[j];
+        }
+        base *= A.default_value();
+    }
+    return base;
+}
+
+/**
+ * @brief Prodotto matrice sparsa - vettore denso: y = A x
+ *
+ * Le posizioni non memorizzate valgono A.default_value(): se è diverso da zero ogni riga riceve il contributo
+ * default * somma(x), da cui viene tolto quello delle posizioni memorizzate.
+ *
+ * @tparam T un tipo aritmetico
+ * @param A la matrice
+ * @param x vettore di A.columns() elementi
+ * @param y vettore di A.rows() elementi in cui scrivere il risultato
+ */
+template<typename T>
+void multiply(const CSRMatrix<T> &A, const T *x, T *y){
+    T shift = A.default_value();
+    T base = spmv_default_base(A, x);
+    spmv_rows(A.row_pointers(), A.column_indices(), A.values(), 0, A.rows(), x, shift, base, y);
+}
+
+/**
+ * @brief Esegue f(row_begin, row_end) su ogni intervallo di bounds, un thread per intervallo
+ *
+ * Il primo intervallo è eseguito dal thread chiamante.
+ */
+template<typename F>
+void run_row_blocks(const std::vector<long> &bounds, F f){
+    std::vector<std::thread> workers;
+    try{
+        for(std::vector<long>::size_type p = 1; p + 1 < bounds.size(); ++p){
+            if(bounds[p] != bounds[p + 1]){
+                workers.push_back(std::thread(f, bounds[p], bounds[p + 1]));
+            }
+        }
+    } catch(...){
+        for(std::vector<std::thread>::size_type k = 0; k < workers.size(); ++k){
+            workers[k].join();
+        }
+        throw;
+    }
+    f(bounds[0], bounds[1]);
+    for(std::vector<std::thread>::size_type k = 0; k < workers.size(); ++k){
+        workers[k].join();
+    }
+}
+
+/**
+ * @brief Funtore che esegue il kernel SpMV su un intervallo di righe, da passare a run_row_blocks
+ */
+template<typename T>
+struct spmv_block {
+    const CSRMatrix<T> &A;
+    const T *x;
+    T shift;
+    T base;
+    T *y;
+
+    spmv_block(const CSRMatrix<T> &A, const T *x, T shift, T base, T *y) : A(A), x(x), shift(shift), base(base),
+                                                                           y(y) {}
+
+    void operator()(long row_begin, long row_end) const {
+        spmv_rows(A.row_pointers(), A.column_indices(), A.values(), row_begin, row_end, x, shift, base, y);
+    }
+};
+
+/**
+ * @brief Prodotto matrice sparsa - vettore denso parallelo: y = A x
+ *
+ * Le righe vengono divise con balanced_row_partition e ogni intervallo è calcolato da un thread con lo stesso
+ * kernel della versione seriale. Ogni riga è sommata nello stesso ordine, quindi il risultato coincide con quello
+ * di multiply(A, x, y).
+ *
+ * @param threads numero di thread da usare, compreso il chiamante. Con 0 viene usato
+ * std::thread::hardware_concurrency()
+ */
+template<typename T>
+void multiply(const CSRMatrix<T> &A, const T *x, T *y, unsigned threads){
+    if(threads == 0){
+        threads = std::thread::hardware_concurrency();
+    }
+    if(threads <= 1){
+        multiply(A, x, y);
+        return;
+    }
+
+    run_row_blocks(balanced_row_partition(A.row_pointers(), A.rows(), threads),
+                   spmv_block<T>(A, x, A.default_value(), spmv_default_base(A, x), y));
+}
+
+/**
+ * @brief Prodotto matrice sparsa - vettore denso: y = A x
+ *
+ * La matrice viene prima convertita in formato CSR: se il prodotto va ripetuto conviene chiamare freeze() una
+ * volta sola e usare la versione per CSRMatrix.
+ */
+template<typename T, typename Alloc, typename Index>
+void multiply(const SparseMatrix<T, Alloc, Index> &A, const T *x, T *y){
+    multiply(A.freeze(), x, y);
+}
+
+/**
+ * @brief Prodotto matrice sparsa - vettore denso parallelo, con conversione in formato CSR
+ */
+template<typename T, typename Alloc, typename Index>
+void multiply(const SparseMatrix<T, Alloc, Index> &A, const T *x, T *y, unsigned threads){
+    multiply(A.freeze(), x, y, threads);
+}
+
+/**
+ * @brief Prodotto della trasposta di una matrice per un vettore denso: y = A^T x
+ *
+ * Visita una volta gli elementi della matrice di partenza: l'elemento (i, j) contribuisce a y[j] con A(i, j) * x[i].
+ * Non viene costruita né la trasposta né una copia compressa della matrice. Le posizioni non memorizzate valgono
+ * il valore di default, con lo stesso trattamento della versione per CSRMatrix.
+ *
+ * @param A la vista sulla trasposta
+ * @param x vettore di A.columns() elementi
+ * @param y vettore di A.rows() elementi in cui scrivere il risultato
+ */
+template<typename T, typename Alloc, typename Index>
+void multiply(const TransposedView<T, Alloc, Index> &A, const T *x, T *y){
+    const T shift = A.default_value();
+    std::fill(y, y + A.rows(), spmv_default_base(A, x));
+    typename SparseMatrix<T, Alloc, Index>::const_iterator it, end = A.source().end();
+    for(it = A.source().begin(); it != end; ++it){
+        y[it->column()] += (it->value() - shift) * x[it->row()];
+    }
+}
+
+/**
+ * @brief Prodotto di un blocco B x B per un segmento di x, sommato in acc: acc += (block - shift) x
+ *
+ * I due cicli hanno un numero di iterazioni noto a tempo di compilazione, quindi con l'ottimizzazione attiva il
+ * compilatore li srotola completamente e tiene acc nei registri.
+ */
+template<typename T, int B>
+inline void bsr_block_multiply(const T *block, const T *x, T shift, T *acc){
+    for(int r = 0; r < B; ++r){
+        T sum = T();
+        for(int c = 0; c < B; ++c){
+            sum += (block[r * B + c] - shift) * x[c];
+        }
+        acc[r] += sum;
+    }
+}
+
+/**
+ * @brief Kernel SpMV per BSRMatrix sulle righe di blocchi [block_begin, block_end)
+ *
+ * L'ultima colonna e l'ultima riga di blocchi possono uscire dalla matrice: il segmento di x corrispondente viene
+ * copiato in un buffer completato con zeri e le righe in eccesso del risultato non vengono scritte.
+ */
+template<typename T, int B>
+void bsr_spmv_rows(const BSRMatrix<T, B> &A, long block_begin, long block_end, const T *x, T shift, T base, T *y){
+    const long *row_ptr = A.row_pointers();
+    const long *col_idx = A.column_indices();
+    const T *values = A.values();
+    const long full_columns = A.columns() / B;
+
+    T tail[B];
+    for(int c = 0; c < B; ++c){
+        tail[c] = full_columns * B + c < A.columns() ? x[full_columns * B + c] : T();
+    }
+
+    for(long bi = block_begin; bi < block_end; ++bi){
+        T acc[B];
+        for(int r = 0; r < B; ++r){
+            acc[r] = base;
+        }
+        for(long k = row_ptr[bi]; k < row_ptr[bi + 1]; ++k){
+            const T *segment = col_idx[k] < full_columns ? x + col_idx[k] * B : tail;
+            bsr_block_multiply<T, B>(values + k * B * B, segment, shift, acc);
+        }
+        const long first = bi * B;
+        for(int r = 0; r < B && first + r < A.rows(); ++r){
+            y[first + r] = acc[r];
+        }
+    }
+}
+
+/**
+ * @brief Prodotto matrice sparsa a blocchi - vettore denso: y = A x
+ *
+ * Le posizioni non memorizzate valgono A.default_value(), con lo stesso trattamento della versione per CSRMatrix.
+ *
+ * @tparam T un tipo aritmetico
+ * @tparam B il lato dei blocchi
+ * @param A la matrice
+ * @param x vettore di A.columns() elementi
+ * @param y vettore di A.rows() elementi in cui scrivere il risultato
+ */
+template<typename T, int B>
+void multiply(const BSRMatrix<T, B> &A, const T *x, T *y){
+    bsr_spmv_rows(A, 0, A.block_rows(), x, A.default_value(), spmv_default_base(A, x), y);
+}
+
+/**
+ * @brief Funtore che esegue il kernel SpMV a blocchi su un intervallo di righe di blocchi, da passare a
+ * run_row_blocks
+ */
+template<typename T, int B>
+struct bsr_spmv_block {
+    const BSRMatrix<T, B> &A;
+    const T *x;
+    T shift;
+    T base;
+    T *y;
+
+    bsr_spmv_block(const BSRMatrix<T, B> &A, const T *x, T shift, T base, T *y) : A(A), x(x), shift(shift),
+                                                                                  base(base), y(y) {}
+
+    void operator()(long block_begin, long block_end) const {
+        bsr_spmv_rows(A, block_begin, block_end, x, shift, base, y);
+    }
+};
+
+/**
+ * @brief Prodotto matrice sparsa a blocchi - vettore denso parallelo: y = A x
+ *
+ * Le righe di blocchi vengono divise con balanced_row_partition in base al numero di blocchi; il risultato
+ * coincide con quello di multiply(A, x, y).
+ *
+ * @param threads numero di thread da usare, compreso il chiamante. Con 0 viene usato
+ * std::thread::hardware_concurrency()
+ */
+template<typename T, int B>
+void multiply(const BSRMatrix<T, B> &A, const T *x, T *y, unsigned threads){
+    if(threads == 0){
+        threads = std::thread::hardware_concurrency();
+    }
+    if(threads <= 1){
+        multiply(A, x, y);
+        return;
+    }
+
+    run_row_blocks(balanced_row_partition(A.row_pointers(), A.block_rows(), threads),
+                   bsr_spmv_block<T, B>(A, x, A.default_value(), spmv_default_base(A, x), y));
+}
+
+/**
+ * @brief Passo simbolico del prodotto tra matrici sparse sulle righe [row_begin, row_end)
+ *
+ * Conta, per ogni riga di A * B, il numero di colonne distinte del risultato, senza calcolare i valori.
+ * @param row_nnz array di A.rows() elementi in cui scrivere i conteggi
+ */
+template<typename T>
+void spgemm_symbolic(const CSRMatrix<T> &A, const CSRMatrix<T> &B, long row_begin, long row_end, long *row_nnz){
+    const long *a_ptr = A.row_pointers(), *a_col = A.column_indices();
+    const long *b_ptr = B.row_pointers(), *b_col = B.column_indices();
+    std::vector<long> marker(B.columns(), -1);
+
+    for(long i = row_begin; i < row_end; ++i){
+        long count = 0;
+        for(long ka = a_ptr[i]; ka < a_ptr[i + 1]; ++ka){
+            long k = a_col[ka];
+            for(long kb = b_ptr[k]; kb < b_ptr[k + 1]; ++kb){
+                if(marker[b_col[kb]] != i){
+                    marker[b_col[kb]] = i;
+                    ++count;
+                }
+            }
+        }
+        row_nnz[i] = count;
+    }
+}
+
+/**
+ * @brief Passo numerico del prodotto tra matrici sparse sulle righe [row_begin, row_end), algoritmo di Gustavson
+ *
+ * Ogni riga del risultato è la combinazione delle righe di B indicate dagli elementi della riga di A. I contributi
+ * vengono sommati in un accumulatore denso (un array lungo B.columns()) se la riga è abbastanza piena, altrimenti
+ * in una piccola tabella hash dimensionata con il risultato del passo simbolico.
+ *
+ * @param out_ptr offset di ogni riga del risultato, calcolati dal passo simbolico
+ * @param out_col colonne del risultato, scritte nelle posizioni [out_ptr[i], out_ptr[i + 1])
+ * @param out_val valori del risultato, nelle stesse posizioni di out_col
+ */
+template<typename T>
+void spgemm_numeric(const CSRMatrix<T> &A, const CSRMatrix<T> &B, long row_begin, long row_end,
+                    const long *out_ptr, long *out_col, T *out_val){
+    const long *a_ptr = A.row_pointers(), *a_col = A.column_indices();
+    const long *b_ptr = B.row_pointers(), *b_col = B.column_indices();
+    const T *a_val = A.values(), *b_val = B.values();
+    const long m = B.columns();
+
+    std::vector<T> dense_values;
+    std::vector<long> dense_marker;
+    std::vector<long> hash_keys;
+    std::vector<T> hash_values;
+
+    for(long i = row_begin; i < row_end; ++i){
+        const long row_size = out_ptr[i + 1] - out_ptr[i];
+        long *columns = out_col + out_ptr[i];
+        long count = 0;
+        if(row_size == 0){
+            continue;
+        }
+
+        if(row_size * 16 >= m){
+            // Accumulatore denso, allocato solo alla prima riga che ne ha bisogno
+            if(dense_values.empty()){
+                dense_values.resize(m);
+                dense_marker.assign(m, -1);
+            }
+            for(long ka = a_ptr[i]; ka < a_ptr[i + 1]; ++ka){
+                long k = a_col[ka];
+                for(long kb = b_ptr[k]; kb < b_ptr[k + 1]; ++kb){
+                    long j = b_col[kb];
+                    if(dense_marker[j] != i){
+                        dense_marker[j] = i;
+                        dense_values[j] = a_val[ka] * b_val[kb];
+                        columns[count++] = j;
+                    } else {
+                        dense_values[j] += a_val[ka] * b_val[kb];
+                    }
+                }
+            }
+            for(long c = 0; c < count; ++c){
+                out_val[out_ptr[i] + c] = dense_values[columns[c]];
+            }
+        } else {
+            // Accumulatore hash ad indirizzamento aperto, con almeno il doppio delle celle necessarie
+            long size = 16;
+            while(size < row_size * 2){
+                size *= 2;
+            }
+            if(static_cast<long>(hash_keys.size()) < size){
+                hash_keys.assign(size, -1);
+                hash_values.resize(size);
+            }
+            const long mask = size - 1;
+            for(long ka = a_ptr[i]; ka < a_ptr[i + 1]; ++ka){
+                long k = a_col[ka];
+                for(long kb = b_ptr[k]; kb < b_ptr[k + 1]; ++kb){
+                    long j = b_col[kb];
+                    long slot = static_cast<long>((static_cast<unsigned long long>(j) * 0x9E3779B97F4A7C15ULL) >> 40) & mask;
+                    while(hash_keys[slot] != -1 && hash_keys[slot] != j){
+                        slot = (slot + 1) & mask;
+                    }
+                    if(hash_keys[slot] == -1){
+                        hash_keys[slot] = j;
+                        hash_values[slot] = a_val[ka] * b_val[kb];
+                        columns[count++] = slot;
+                    } else {
+                        hash_values[slot] += a_val[ka] * b_val[kb];
+                    }
+                }
+            }
+            // columns contiene temporaneamente le celle usate: le converto in colonne e svuoto la tabella
+            for(long c = 0; c < count; ++c){
+                long slot = columns[c];
+                columns[c] = hash_keys[slot];
+                out_val[out_ptr[i] + c] = hash_values[slot];
+                hash_keys[slot] = -1;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Funtore che esegue spgemm_symbolic su un intervallo di righe, da passare a run_row_blocks
+ */
+template<typename T>
+struct spgemm_symbolic_block {
+    const CSRMatrix<T> &A;
+    const CSRMatrix<T> &B;
+    long *row_nnz;
+
+    spgemm_symbolic_block(const CSRMatrix<T> &A, const CSRMatrix<T> &B, long *row_nnz) : A(A), B(B),
+                                                                                          row_nnz(row_nnz) {}
+
+    void operator()(long row_begin, long row_end) const {
+        spgemm_symbolic(A, B, row_begin, row_end, row_nnz);
+    }
+};
+
+/**
+ * @brief Funtore che esegue spgemm_numeric su un intervallo di righe, da passare a run_row_blocks
+ */
+template<typename T>
+struct spgemm_numeric_block {
+    const CSRMatrix<T> &A;
+    const CSRMatrix<T> &B;
+    const long *out_ptr;
+    long *out_col;
+    T *out_val;
+
+    spgemm_numeric_block(const CSRMatrix<T> &A, const CSRMatrix<T> &B, const long *out_ptr, long *out_col,
+                         T *out_val) : A(A), B(B), out_ptr(out_ptr), out_col(out_col), out_val(out_val) {}
+
+    void operator()(long row_begin, long row_end) const {
+        spgemm_numeric(A, B, row_begin, row_end, out_ptr, out_col, out_val);
+    }
+};
+
+/**
+ * @brief Prodotto tra matrici sparse: C = A * B
+ *
+ * Usa l'algoritmo di Gustavson riga per riga, con un passo simbolico che dimensiona il risultato prima del passo
+ * numerico. Gli elementi del risultato sono solo quelli strutturalmente non nulli; il valore di default del
+ * risultato è T().
+ *
+ * Con valori di default diversi da T() quasi ogni cella del prodotto riceverebbe un contributo, quindi il caso non
+ * è supportato e viene segnalato con un'eccezione.
+ *
+ * @tparam T un tipo con operatori + e *, il cui valore T() sia l'elemento neutro della somma
+ * @param threads numero di thread da usare, compreso il chiamante. Con 0 viene usato
+ * std::thread::hardware_concurrency()
+ * @throw matrix_dimension_mismatch_exception se A.columns() != B.rows()
+ * @throw unsupported_default_value_exception se una delle due matrici ha un valore di default diverso da T()
+ */
+template<typename T>
+SparseMatrix<T> multiply(const CSRMatrix<T> &A, const CSRMatrix<T> &B, unsigned threads = 1){
+    if(A.columns() != B.rows()){
+        throw matrix_dimension_mismatch_exception("Il numero di colonne di A deve coincidere con le righe di B");
+    }
+    if(!(A.default_value() == T()) || !(B.default_value() == T())){
+        throw unsupported_default_value_exception("Il prodotto tra matrici richiede valori di default pari a T()");
+    }
+    if(threads == 0){
+        threads = std::thread::hardware_concurrency();
+    }
+    if(threads == 0){
+        threads = 1;
+    }
+
+    const long n = A.rows();
+    const long *a_ptr = A.row_pointers(), *a_col = A.column_indices(), *b_ptr = B.row_pointers();
+
+    // Lavoro di ogni riga, in forma cumulativa, per dividere le righe tra i thread
+    std::vector<long> work(n + 1, 0);
+    for(long i = 0; i < n; ++i){
+        work[i + 1] = work[i];
+        for(long ka = a_ptr[i]; ka < a_ptr[i + 1]; ++ka){
+            work[i + 1] += b_ptr[a_col[ka] + 1] - b_ptr[a_col[ka]];
+        }
+    }
+    std::vector<long> bounds = balanced_row_partition(&work[0], n, threads);
+
+    std::vector<long> out_ptr(n + 1, 0);
+    run_row_blocks(bounds, spgemm_symbolic_block<T>(A, B, &out_ptr[0] + 1));
+    for(long i = 0; i < n; ++i){
+        out_ptr[i + 1] += out_ptr[i];
+    }
+
+    std::vector<long> out_col(out_ptr[n]);
+    std::vector<T> out_val(out_ptr[n]);
+    if(out_ptr[n] > 0){
+        run_row_blocks(bounds, spgemm_numeric_block<T>(A, B, &out_ptr[0], &out_col[0], &out_val[0]));
+    }
+
+    SparseMatrix<T> result(n, B.columns(), T());
+    result.reserve(out_ptr[n]);
+    for(long i = 0; i < n; ++i){
+        for(long k = out_ptr[i]; k < out_ptr[i + 1]; ++k){
+            result.set(i, out_col[k], out_val[k]);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Prodotto tra matrici sparse: C = A * B
+ *
+ * Le due matrici vengono convertite in formato CSR prima del prodotto.
+ * @see multiply(const CSRMatrix<T>&, const CSRMatrix<T>&, unsigned)
+ */
+template<typename T, typename Alloc, typename Index>
+SparseMatrix<T> multiply(const SparseMatrix<T, Alloc, Index> &A, const SparseMatrix<T, Alloc, Index> &B,
+                         unsigned threads = 1){
+    if(A.columns() != B.rows()){
+        throw matrix_dimension_mismatch_exception("Il numero di colonne di A deve coincidere con le righe di B");
+    }
+    return multiply(A.freeze(), B.freeze(), threads);
+}
+
+/**
+ * @brief Prodotto tra matrici sparse con il primo fattore trasposto: C = A^T B
+ *
+ * La trasposta viene compressa direttamente nel layout CSR, che coincide con quello CSC della matrice di partenza,
+ * senza costruirla come SparseMatrix; la memoria usata è la stessa di multiply(A, B). Con A = B si ottiene A^T A.
+ * @see multiply(const CSRMatrix<T>&, const CSRMatrix<T>&, unsigned)
+ */
+template<typename T, typename Alloc, typename Index>
+SparseMatrix<T> multiply(const TransposedView<T, Alloc, Index> &A, const SparseMatrix<T, Alloc, Index> &B,
+                         unsigned threads = 1){
+    if(A.columns() != B.rows()){
+        throw matrix_dimension_mismatch_exception("Il numero di colonne di A deve coincidere con le righe di B");
+    }
+    return multiply(A.freeze(), B.freeze(), threads);
+}
+
+/**
+ * @brief Prodotto tra matrici sparse con il secondo fattore trasposto: C = A B^T
+ * @see multiply(const TransposedView<T, Alloc, Index>&, const SparseMatrix<T, Alloc, Index>&, unsigned)
+ */
+template<typename T, typename Alloc, typename Index>
+SparseMatrix<T> multiply(const SparseMatrix<T, Alloc, Index> &A, const TransposedView<T, Alloc, Index> &B,
+                         unsigned threads = 1){
+    if(A.columns() != B.rows()){
+        throw matrix_dimension_mismatch_exception("Il numero di colonne di A deve coincidere con le righe di B");
+    }
+    return multiply(A.freeze(), B.freeze(), threads);
+}
+
+/**
+ * @brief true se value coincide con il valore di default del risultato; sempre false se T non ha l'operatore ==
+ */
+template<typename T>
+bool elementwise_is_default(const T &value, const T &default_value, std::true_type){
+    return value == default_value;
+}
+
+template<typename T>
+bool elementwise_is_default(const T &, const T &, std::false_type){
+    return false;
+}
+
+/**
+ * @brief Combina elemento per elemento due matrici con le stesse dimensioni: C(i, j) = op(A(i, j), B(i, j))
+ *
+ * Gli elementi memorizzati di A e B vengono visitati in ordine di riga e fusi in un'unica passata lineare, come due
+ * liste ordinate: una posizione presente in una sola delle matrici viene combinata con il valore di default
+ * dell'altra, senza mai cercarla con operator(). Il valore di default del risultato è op(default di A, default di
+ * B) e le posizioni in cui il risultato vale il default non vengono memorizzate. Gli indici ordinati di A e B
+ * vengono costruiti alla prima visita e riusati finché le matrici non cambiano.
+ * @param op funtore (const T&, const T&) -> T
+ * @throws matrix_dimension_mismatch_exception se le dimensioni non coincidono
+ */
+template<typename T, typename Alloc, typename Index, typename Op>
+SparseMatrix<T, Alloc, Index> elementwise(const SparseMatrix<T, Alloc, Index> &A,
+                                          const SparseMatrix<T, Alloc, Index> &B, Op op){
+    typedef typename SparseMatrix<T, Alloc, Index>::size_type size_type;
+    typedef typename SparseMatrix<T, Alloc, Index>::ordered_iterator ordered_iterator;
+    if(A.rows() != B.rows() || A.columns() != B.columns()){
+        throw matrix_dimension_mismatch_exception("Le due matrici devono avere le stesse dimensioni");
+    }
+
+    const T result_default = op(A.default_value(), B.default_value());
+    std::vector<size_type> out_row, out_col;
+    std::vector<T> out_val;
+    ordered_iterator a = A.row_major_begin(), a_end = A.row_major_end();
+    ordered_iterator b = B.row_major_begin(), b_end = B.row_major_end();
+    while(a != a_end || b != b_end){
+        // Avanzano entrambi gli iteratori se sono sulla stessa posizione
+        const bool take_a = b == b_end || (a != a_end && (a->row() < b->row() ||
+                                                          (a->row() == b->row() && a->column() <= b->column())));
+        const bool take_b = a == a_end || (b != b_end && (b->row() < a->row() ||
+                                                          (b->row() == a->row() && b->column() <= a->column())));
+        T value = op(take_a ? a->value() : A.default_value(), take_b ? b->value() : B.default_value());
+        if(!elementwise_is_default(value, result_default, typename equality_comparable<T>::type())){
+            out_row.push_back(take_a ? a->row() : b->row());
+            out_col.push_back(take_a ? a->column() : b->column());
+            out_val.push_back(std::move(value));
+        }
+        if(take_a){
+            ++a;
+        }
+        if(take_b){
+            ++b;
+        }
+    }
+
+    SparseMatrix<T, Alloc, Index> result(A.rows(), A.columns(), result_default, A.get_allocator());
+    result.reserve(static_cast<size_type>(out_val.size()));
+    // Inserisco a partire dall'ultima posizione, così il const_iterator visita il risultato in ordine di riga
+    for(typename std::vector<T>::size_type k = out_val.size(); k > 0; --k){
+        result.set(out_row[k - 1], out_col[k - 1], std::move(out_val[k - 1]));
+    }
+    return result;
+}
+
+/**
+ * @brief Applica op a ogni valore della matrice: C(i, j) = op(A(i, j))
+ *
+ * Visita solo gli elementi memorizzati; il valore di default del risultato è op(default di A) e le posizioni in cui
+ * il risultato vale il default non vengono memorizzate.
+ * @param op funtore (const T&) -> T
+ */
+template<typename T, typename Alloc, typename Index, typename Op>
+SparseMatrix<T, Alloc, Index> elementwise(const SparseMatrix<T, Alloc, Index> &A, Op op){
+    const T result_default = op(A.default_value());
+    SparseMatrix<T, Alloc, Index> result(A.rows(), A.columns(), result_default, A.get_allocator());
+    result.reserve(A.inserted_items());
+    typename SparseMatrix<T, Alloc, Index>::const_iterator it, end = A.end();
+    for(it = A.begin(); it != end; ++it){
+        T value = op(it->value());
+        if(!elementwise_is_default(value, result_default, typename equality_comparable<T>::type())){
+            result.set(it->row(), it->column(), std::move(value));
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Funtore che moltiplica un valore per uno scalare, a sinistra o a destra
+ */
+template<typename T, bool Left>
+struct scale_by {
+    T scalar; ///< Il fattore
+
+    explicit scale_by(const T &scalar) : scalar(scalar) {}
+
+    T operator()(const T &value) const {
+        return Left ? scalar * value : value * scalar;
+    }
+};
+
+/**
+ * @name Aritmetica elemento per elemento
+ *
+ * Tutte le operazioni tengono conto dei valori di default degli operandi e costano O(nnz(A) + nnz(B)) dopo la
+ * costruzione degli indici ordinati.
+ * @see elementwise
+ */
+///@{
+template<typename T, typename Alloc, typename Index>
+SparseMatrix<T, Alloc, Index> operator+(const SparseMatrix<T, Alloc, Index> &A, const SparseMatrix<T, Alloc, Index> &B){
+    return elementwise(A, B, std::plus<T>());
+}
+
+template<typename T, typename Alloc, typename Index>
+SparseMatrix<T, Alloc, Index> operator-(const SparseMatrix<T, Alloc, Index> &A, const SparseMatrix<T, Alloc, Index> &B){
+    return elementwise(A, B, std::minus<T>());
+}
+
+/**
+ * @brief Prodotto di Hadamard: C(i, j) = A(i, j) * B(i, j)
+ */
+template<typename T, typename Alloc, typename Index>
+SparseMatrix<T, Alloc, Index> hadamard(const SparseMatrix<T, Alloc, Index> &A, const SparseMatrix<T, Alloc, Index> &B){
+    return elementwise(A, B, std::multiplies<T>());
+}
+
+/**
+ * @brief Prodotto per uno scalare: C(i, j) = A(i, j) * s
+ */
+template<typename T, typename Alloc, typename Index>
+SparseMatrix<T, Alloc, Index> operator*(const SparseMatrix<T, Alloc, Index> &A,
+                                        const typename SparseMatrix<T, Alloc, Index>::value_type &s){
+    return elementwise(A, scale_by<T, false>(s));
+}
+
+/**
+ * @brief Prodotto per uno scalare: C(i, j) = s * A(i, j)
+ */
+template<typename T, typename Alloc, typename Index>
+SparseMatrix<T, Alloc, Index> operator*(const typename SparseMatrix<T, Alloc, Index>::value_type &s,
+                                        const SparseMatrix<T, Alloc, Index> &A){
+    return elementwise(A, scale_by<T, true>(s));
+}
+///@}
+
+/**
+ * @brief Operatori di confronto accettati da count_if_compare
+ */
+enum compare_op {
+    compare_equal, ///< v == x
+    compare_not_equal, ///< v != x
+    compare_less, ///< v < x
+    compare_less_equal, ///< v <= x
+    compare_greater, ///< v > x
+    compare_greater_equal ///< v >= x
+};
+
+/**
+ * @brief Valuta v op x su un singolo valore
+ */
+template<typename T>
+bool compare_holds(const T &v, compare_op op, const T &x){
+    switch (op) {
+        case compare_equal:
+            return v == x;
+        case compare_not_equal:
+            return v != x;
+        case compare_less:
+            return v < x;
+        case compare_less_equal:
+            return v <= x;
+        case compare_greater:
+            return v > x;
+        default:
+            return v >= x;
+    }
+}
+
+/**
+ * @brief Conta i valori di un array contiguo per cui vale values[k] op x
+ *
+ * Ogni operatore viene ricondotto a un intervallo di count_between: i confronti con un solo estremo usano come
+ * altro estremo l'infinito, se il tipo lo prevede, o il valore minimo o massimo rappresentabile. v != x è il
+ * complemento di v == x, quindi conta anche i NaN.
+ *
+ * @tparam T un tipo aritmetico
+ */
+template<typename T>
+long count_compare(const T *values, long n, compare_op op, T x){
+    static_assert(std::is_arithmetic<T>::value, "count_compare richiede un tipo aritmetico");
+    typedef std::numeric_limits<T> limits;
+    const T lowest = limits::has_infinity ? -limits::infinity() : limits::lowest();
+    const T highest = limits::has_infinity ? limits::infinity() : limits::max();
+
+    switch (op) {
+        case compare_equal:
+            return count_between(values, n, x, x, true, true);
+        case compare_not_equal:
+            return n - count_between(values, n, x, x, true, true);
+        case compare_less:
+            return count_between(values, n, lowest, x, true, false);
+        case compare_less_equal:
+            return count_between(values, n, lowest, x, true, true);
+        case compare_greater:
+            return count_between(values, n, x, highest, false, true);
+        default:
+            return count_between(values, n, x, highest, true, true);
+    }
+}
+
+/**
+ * @brief Versione specializzata di evaluate per il predicato lo <= v < hi.
+ *
+ * Scorre l'array contiguo dei valori con count_between; le posizioni non memorizzate vengono contate in forma
+ * chiusa, come in evaluate.
+ *
+ * @return il numero di elementi logici della matrice compresi in [lo, hi)
+ */
+template<typename T>
+typename CSRMatrix<T>::size_type evaluate_range(const CSRMatrix<T> &M, T lo, T hi){
+    typename CSRMatrix<T>::size_type result = count_between(M.values(), M.inserted_items(), lo, hi, true, false);
+    if(lo <= M.default_value() && M.default_value() < hi){
+        result += (M.rows() * M.columns() - M.inserted_items());
+    }
+    return result;
+}
+
+/**
+ * @brief Versione di evaluate_range per CSCMatrix
+ */
+template<typename T>
+typename CSCMatrix<T>::size_type evaluate_range(const CSCMatrix<T> &M, T lo, T hi){
+    typename CSCMatrix<T>::size_type result = count_between(M.values(), M.inserted_items(), lo, hi, true, false);
+    if(lo <= M.default_value() && M.default_value() < hi){
+        result += (M.rows() * M.columns() - M.inserted_items());
+    }
+    return result;
+}
+
+/**
+ * @brief Versione specializzata di evaluate per il predicato v op x, per i tipi aritmetici
+ *
+ * @return il numero di elementi logici della matrice per cui vale v op x
+ */
+template<typename T>
+typename CSRMatrix<T>::size_type count_if_compare(const CSRMatrix<T> &M, compare_op op, T x){
+    typename CSRMatrix<T>::size_type result = count_compare(M.values(), M.inserted_items(), op, x);
+    if(compare_holds(M.default_value(), op, x)){
+        result += (M.rows() * M.columns() - M.inserted_items());
+    }
+    return result;
+}
+
+/**
+ * @brief Versione di count_if_compare per CSCMatrix
+ */
+template<typename T>
+typename CSCMatrix<T>::size_type count_if_compare(const CSCMatrix<T> &M, compare_op op, T x){
+    typename CSCMatrix<T>::size_type result = count_compare(M.values(), M.inserted_items(), op, x);
+    if(compare_holds(M.default_value(), op, x)){
+        result += (M.rows() * M.columns() - M.inserted_items());
+    }
+    return result;
+}
+
+#endif
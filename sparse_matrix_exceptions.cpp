@@ -16,3 +16,11 @@ invalid_matrix_dimension_exception::invalid_matrix_dimension_exception(const std
 }
 
 matrix_out_of_bounds_exception::matrix_out_of_bounds_exception(const std::string &message) : std::out_of_range(message) {}
+
+matrix_dimension_mismatch_exception::matrix_dimension_mismatch_exception(const std::string &message)
+: std::invalid_argument(message) {}
+
+unsupported_default_value_exception::unsupported_default_value_exception(const std::string &message)
+: std::domain_error(message) {}
+
+matrix_file_exception::matrix_file_exception(const std::string &message) : std::runtime_error(message) {}
@@ -30,4 +30,28 @@ public:
     explicit matrix_out_of_bounds_exception(const std::string &message);
 };
 
+/**
+ * @brief Eccezione lanciata quando le dimensioni di due matrici non sono compatibili con l'operazione richiesta
+ */
+class matrix_dimension_mismatch_exception : public std::invalid_argument {
+public:
+    explicit matrix_dimension_mismatch_exception(const std::string &message);
+};
+
+/**
+ * @brief Eccezione lanciata quando un'operazione non supporta il valore di default di una delle matrici coinvolte
+ */
+class unsupported_default_value_exception : public std::domain_error {
+public:
+    explicit unsupported_default_value_exception(const std::string &message);
+};
+
+/**
+ * @brief Eccezione lanciata quando un file di matrice non può essere letto o scritto, o non è nel formato atteso
+ */
+class matrix_file_exception : public std::runtime_error {
+public:
+    explicit matrix_file_exception(const std::string &message);
+};
+
 #endif
@@ -11,12 +11,21 @@
 #include "test_class.h"
 
 
+long test_class::copies = 0;
+long test_class::moves = 0;
+
 test_class::test_class() : ptr(new int(0)) {}
 
-test_class::test_class(const test_class &other) {
+test_class::test_class(const test_class &other) : ptr(nullptr) {
     if(other.ptr != nullptr) {
         ptr = new int(other.value());
     }
+    ++copies;
+}
+
+test_class::test_class(test_class &&other) : ptr(other.ptr) {
+    other.ptr = nullptr;
+    ++moves;
 }
 
 test_class::~test_class() {
@@ -32,6 +41,14 @@ test_class &test_class::operator=(const test_class &other) {
     return *this;
 }
 
+test_class &test_class::operator=(test_class &&other) {
+    if(this != &other){
+        std::swap(ptr, other.ptr);
+        ++moves;
+    }
+    return *this;
+}
+
 test_class::test_class(int value) {
     this->ptr = new int(value);
 }
@@ -48,3 +65,16 @@ std::ostream& operator<<(std::ostream& stream, const test_class &test_instance){
     stream << test_instance.value();
     return stream;
 }
+
+long test_class::copy_count() {
+    return copies;
+}
+
+long test_class::move_count() {
+    return moves;
+}
+
+void test_class::reset_counters() {
+    copies = 0;
+    moves = 0;
+}
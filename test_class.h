@@ -16,17 +16,27 @@
 /**
  * @brief classe di test
  *
- * Classe di test utilizzata per verificare la correttezza di SparseMatrix.
+ * Classe di test utilizzata per verificare la correttezza di SparseMatrix. Conta le copie e gli spostamenti
+ * effettuati, per controllare che SparseMatrix non copi i valori quando non è necessario.
  */
 class test_class {
     int *ptr;
+
+    static long copies; ///< Numero di copie (costruzioni e assegnamenti) effettuate
+    static long moves; ///< Numero di spostamenti (costruzioni e assegnamenti) effettuati
 public:
     test_class();
     test_class(const test_class &other);
+    test_class(test_class &&other);
     ~test_class();
     test_class& operator=(const test_class &other);
+    test_class& operator=(test_class &&other);
     explicit test_class(int value);
     int value() const;
+
+    static long copy_count();
+    static long move_count();
+    static void reset_counters();
 };
 
 //Operatore utile per debug